@@ -38,11 +38,14 @@ SOFTWARE.
 #include <libopencm3/stm32/desig.h>
 #include <libopencm3/stm32/rcc.h>
 #include <libopencm3/stm32/gpio.h>
+#include <libopencm3/stm32/exti.h>
 #include <libopencm3/stm32/flash.h>
 #include <libopencm3/stm32/usart.h>
+#include <libopencm3/stm32/dma.h>
 #include <libopencm3/stm32/timer.h>
 #include <libopencm3/stm32/adc.h>
 #include <libopencm3/stm32/i2c.h>
+#include <libopencm3/stm32/spi.h>
 #include <libopencm3/usb/usbd.h>
 #include <libopencm3/usb/cdc.h>
 #include <libopencm3/usb/msc.h>
@@ -70,10 +73,12 @@ static inline void hw_release_instance(int instance, uint8_t *use_map) {
 #include "hw_usb.h"
 #include "hw_misc.h"
 
+#include "hw_dma.h"
 #include "hw_gpio.h"
 #include "hw_usart.h"
 #include "hw_adc.h"
 #include "hw_i2c.h"
+#include "hw_spi.h"
 #include "hw_timer.h"
 
 
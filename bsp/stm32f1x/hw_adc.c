@@ -29,21 +29,30 @@ SOFTWARE.
 #define ADC_IDLE        0
 #define ADC_READY       1
 #define ADC_BUSY        2      // work in process
+#define ADC_BLOCK       3      // scan by timer trigger, deliver by dma block
 #define ADC_INVALID     0xffff
 
+#define ADC_BLOCK_MAX   64     // samples pre block
+#define ADC_TICK_FREQ   1000000
+
 typedef struct hw_adc_t {
     uint8_t inused;
     uint8_t dev_id;
     uint8_t state;
     uint8_t current;
     uint8_t changed;
-    uint8_t reserved;
+    uint8_t next;               // block: dma half to deliver next
     uint16_t sleep;
     uint16_t data[HW_CHN_MAX_ADC];
+    cupkee_filter_t filter[HW_CHN_MAX_ADC];
+    uint16_t block_size;        // block: bytes
+    volatile uint8_t ready;     // block: dma half complete, set in isr
+    void    *rx_buff;           // block: delivered, wait read
     const hw_config_adc_t *config;
 } hw_adc_t;
 
 static hw_adc_t adc_controls[HW_INSTANCES_ADC];
+static uint16_t adc_dma_area[ADC_BLOCK_MAX * 2];
 const  uint8_t adc_chn_port[] = {
     0, 0, 0, 0,                     // channel 0 - 3
     0, 0, 0, 0,                     // channel 4 - 7
@@ -90,6 +99,15 @@ static inline void hw_adc_chn_reset(uint8_t chn) {
     }
 }
 
+static void channel_reset(uint8_t num, const uint8_t *seq)
+{
+    int i;
+
+    for (i = 0; i < num; i++) {
+        hw_adc_chn_reset(seq[i]);
+    }
+}
+
 static int channel_setup(uint8_t num, const uint8_t *seq)
 {
     int i, err;
@@ -97,17 +115,11 @@ static int channel_setup(uint8_t num, const uint8_t *seq)
     for (i = 0; i < num; i++) {
         err = hw_adc_chn_setup(seq[i]);
         if (err) {
-            num = i;
-            goto DO_ERROR;
+            channel_reset(i, seq);
+            return err;
         }
     }
     return CUPKEE_OK;
-
-DO_ERROR:
-    for (i = 0; i < num; i++) {
-        hw_adc_chn_reset(seq[i]);
-    }
-    return err;
 }
 
 static inline int hw_adc_ready(int instance) {
@@ -122,9 +134,148 @@ static inline int hw_adc_convert_ok(int instance) {
     return adc_eoc(ADC1);
 }
 
+static void adc_dma_isr(int instance)
+{
+    hw_adc_t *control = &adc_controls[instance];
+
+    if (dma_get_interrupt_flag(DMA1, DMA_CHANNEL1, DMA_HTIF)) {
+        control->ready |= 1;
+    }
+    if (dma_get_interrupt_flag(DMA1, DMA_CHANNEL1, DMA_TCIF)) {
+        control->ready |= 2;
+    }
+    dma_clear_interrupt_flags(DMA1, DMA_CHANNEL1, DMA_HTIF | DMA_TCIF);
+
+    cupkee_device_poll_request(control->dev_id);
+}
+
+static int adc_block_setup(hw_adc_t *control, const hw_config_adc_t *config)
+{
+    int samples = config->block * config->chn_num;
+    uint32_t period, div;
+
+    // a scan take about 4us pre channel
+    if (!config->block || samples > ADC_BLOCK_MAX ||
+        ADC_TICK_FREQ / config->rate < config->chn_num * 4u) {
+        return CUPKEE_EINVAL;
+    }
+
+    // two blocks to keep one for delivery while dma fill another
+    control->block_size = samples * sizeof(uint16_t);
+    control->rx_buff = cupkee_buffer_alloc(control->block_size * 2);
+    if (!control->rx_buff) {
+        return CUPKEE_ENOMEM;
+    }
+    control->ready = 0;
+    control->next = 0;
+
+    if (hw_dma_request(DMA_CHANNEL1, adc_dma_isr, 0)) {
+        cupkee_buffer_release(control->rx_buff);
+        control->rx_buff = NULL;
+        return CUPKEE_ERESOURCE;
+    }
+    dma_channel_reset(DMA1, DMA_CHANNEL1);
+    dma_set_peripheral_address(DMA1, DMA_CHANNEL1, (uint32_t) &ADC_DR(ADC1));
+    dma_set_memory_address(DMA1, DMA_CHANNEL1, (uint32_t) adc_dma_area);
+    dma_set_number_of_data(DMA1, DMA_CHANNEL1, samples * 2);
+    dma_set_read_from_peripheral(DMA1, DMA_CHANNEL1);
+    dma_set_peripheral_size(DMA1, DMA_CHANNEL1, DMA_CCR_PSIZE_16BIT);
+    dma_set_memory_size(DMA1, DMA_CHANNEL1, DMA_CCR_MSIZE_16BIT);
+    dma_enable_memory_increment_mode(DMA1, DMA_CHANNEL1);
+    dma_enable_circular_mode(DMA1, DMA_CHANNEL1);
+    dma_enable_half_transfer_interrupt(DMA1, DMA_CHANNEL1);
+    dma_enable_transfer_complete_interrupt(DMA1, DMA_CHANNEL1);
+    dma_enable_channel(DMA1, DMA_CHANNEL1);
+    nvic_enable_irq(NVIC_DMA1_CHANNEL1_IRQ);
+
+    // one scan of all channels on each TIM1 CC1 event
+    adc_enable_scan_mode(ADC1);
+    adc_enable_external_trigger_regular(ADC1, ADC_CR2_EXTSEL_TIM1_CC1);
+    adc_enable_dma(ADC1);
+    adc_set_regular_sequence(ADC1, config->chn_num, (uint8_t *)config->chn_seq);
+
+    // TIM1 not used by timer devices, 1us pre tick, coarser for low rate
+    // to keep period in 16 bits ARR
+    period = ADC_TICK_FREQ / config->rate;
+    div = (period + 0xffff) / 0x10000;
+    period /= div;
+    rcc_periph_clock_enable(RCC_TIM1);
+    TIM_CR1(TIM1) = TIM_CR1_CKD_CK_INT | TIM_CR1_CMS_EDGE | TIM_CR1_DIR_UP;
+    TIM_PSC(TIM1) = 72 * div - 1;
+    TIM_ARR(TIM1) = period - 1;
+    TIM_CCR1(TIM1) = period / 2;
+    TIM_CCMR1(TIM1) = TIM_CCMR1_OC1M_PWM1;
+    TIM_CCER(TIM1) = TIM_CCER_CC1E;
+    TIM_BDTR(TIM1) = TIM_BDTR_MOE;
+    TIM_EGR(TIM1) = TIM_EGR_UG;
+
+    control->state = ADC_BLOCK;
+
+    return CUPKEE_OK;
+}
+
+static void adc_block_reset(hw_adc_t *control)
+{
+    TIM_CR1(TIM1) = 0;
+    TIM_CCER(TIM1) = 0;
+    TIM_BDTR(TIM1) = 0;
+
+    nvic_disable_irq(NVIC_DMA1_CHANNEL1_IRQ);
+    hw_dma_release(DMA_CHANNEL1);
+    adc_disable_dma(ADC1);
+    adc_disable_external_trigger_regular(ADC1);
+    adc_disable_scan_mode(ADC1);
+
+    cupkee_buffer_release(control->rx_buff);
+    control->rx_buff = NULL;
+    control->state = ADC_IDLE;
+}
+
+static void adc_block_poll(hw_adc_t *control)
+{
+    uint32_t state;
+    uint8_t ready;
+
+    hw_enter_critical(&state);
+    ready = control->ready;
+    control->ready = 0;
+    hw_exit_critical(state);
+
+    if (ready == 3) {
+        // both halves complete since last poll: the older one is being overwritten, skip it
+        cupkee_event_post_device_error(control->dev_id);
+        ready &= ~(1 << control->next);
+        control->next ^= 1;
+    }
+
+    while (ready & (1 << control->next)) {
+        const uint8_t *block = (const uint8_t *)adc_dma_area + control->next * control->block_size;
+
+        ready &= ~(1 << control->next);
+        control->next ^= 1;
+
+        if (cupkee_buffer_space(control->rx_buff) < control->block_size) {
+            // reader too slow, drop whole block to keep the channel interleave
+            cupkee_event_post_device_error(control->dev_id);
+        } else {
+            cupkee_buffer_give(control->rx_buff, control->block_size, block);
+            cupkee_event_post_device_data(control->dev_id);
+        }
+    }
+}
+
 static void adc_reset(int instance)
 {
+    const hw_config_adc_t *config = adc_controls[instance].config;
+
     /* Do hardware reset here */
+    if (adc_controls[instance].state == ADC_BLOCK) {
+        adc_block_reset(&adc_controls[instance]);
+    }
+    if (config) {
+        adc_power_off(ADC1);
+        channel_reset(config->chn_num, config->chn_seq);
+    }
 
     adc_controls[instance].dev_id = DEVICE_ID_INVALID;
     adc_controls[instance].config = NULL;
@@ -149,6 +300,12 @@ static int adc_setup(int instance, uint8_t dev_id, const hw_config_t *conf)
             goto DO_END;
         }
         control->data[i] = ADC_INVALID;
+
+        err = cupkee_filter_init(&control->filter[i], config->oversample, config->decimate, config->deadband);
+        if (err) {
+            err = -err;
+            goto DO_END;
+        }
     }
     control->state = ADC_IDLE;
     control->sleep = config->interval;
@@ -177,6 +334,17 @@ static int adc_setup(int instance, uint8_t dev_id, const hw_config_t *conf)
     control->dev_id = dev_id;
     control->config = config;
 
+    if (config->rate) {
+        err = adc_block_setup(control, config);
+        if (err) {
+            adc_power_off(ADC1);
+            channel_reset(config->chn_num, config->chn_seq);
+            control->config = NULL;
+        } else {
+            TIM_CR1(TIM1) |= TIM_CR1_CEN;
+        }
+    }
+
 DO_END:
 
     return -err;
@@ -198,6 +366,9 @@ static void adc_poll(int instance)
     hw_adc_t *control = &adc_controls[instance];
 
     switch(control->state) {
+    case ADC_BLOCK:
+        adc_block_poll(control);
+        break;
     case ADC_IDLE:
         if (hw_adc_ready(instance)) {
             const hw_config_adc_t *config = control->config;
@@ -216,7 +387,6 @@ static void adc_poll(int instance)
         if (hw_adc_convert_ok(instance)) {
             uint8_t  curr = control->current;
             uint16_t data = adc_read_regular(ADC1);
-            uint16_t last = control->data[curr];
 
             if (curr + 1 >= control->config->chn_num) {
                 control->current = 0;
@@ -224,8 +394,9 @@ static void adc_poll(int instance)
                 control->current = curr + 1;
             }
 
-            if (data != last) {
-                control->data[curr] = data;
+            // report filtered value only
+            if (cupkee_filter_push(&control->filter[curr], data)) {
+                control->data[curr] = cupkee_filter_value(&control->filter[curr]);
                 control->changed = curr;
                 cupkee_event_post_device_data(control->dev_id);
             }
@@ -281,6 +452,33 @@ static int adc_size(int instance)
     return control->config->chn_num;
 }
 
+static int adc_read(int instance, size_t n, void *buf)
+{
+    hw_adc_t *control = &adc_controls[instance];
+
+    if (control->state != ADC_BLOCK) {
+        return -CUPKEE_EIMPLEMENT;
+    }
+    return cupkee_buffer_take(control->rx_buff, n, buf);
+}
+
+static int adc_io_cached(int instance, size_t *in, size_t *out)
+{
+    hw_adc_t *control = &adc_controls[instance];
+
+    if (control->state != ADC_BLOCK) {
+        return -CUPKEE_EIMPLEMENT;
+    }
+
+    if (in) {
+        *in = cupkee_buffer_length(control->rx_buff);
+    }
+    if (out) {
+        *out = 0;
+    }
+    return 0;
+}
+
 static const hw_driver_t adc_driver = {
     .release = adc_release,
     .reset   = adc_reset,
@@ -290,7 +488,10 @@ static const hw_driver_t adc_driver = {
 
     .get = adc_get,
     .set = adc_set,
-    .size = adc_size
+    .size = adc_size,
+
+    .read = adc_read,
+    .io_cached = adc_io_cached
 };
 
 const hw_driver_t *hw_request_adc(int instance)
@@ -301,6 +502,7 @@ const hw_driver_t *hw_request_adc(int instance)
 
     adc_controls[instance].inused = 1;
     adc_controls[instance].dev_id = DEVICE_ID_INVALID;
+    adc_controls[instance].state  = ADC_IDLE;
     adc_controls[instance].config = NULL;
 
     return &adc_driver;
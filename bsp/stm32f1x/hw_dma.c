@@ -0,0 +1,115 @@
+/*
+MIT License
+
+This file is part of cupkee project.
+
+Copyright (c) 2017 Lixing Ding <ding.lixing@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "hardware.h"
+
+typedef struct hw_dma_owner_t {
+    void (*isr)(int inst);
+    int inst;
+} hw_dma_owner_t;
+
+static hw_dma_owner_t dma_owners[HW_DMA_CHANNELS];
+
+static void hw_dma_isr(int chn)
+{
+    hw_dma_owner_t *owner = &dma_owners[chn - 1];
+
+    if (owner->isr) {
+        owner->isr(owner->inst);
+    } else {
+        dma_clear_interrupt_flags(DMA1, chn, DMA_GIF | DMA_TCIF | DMA_HTIF | DMA_TEIF);
+    }
+}
+
+void dma1_channel1_isr(void)
+{
+    hw_dma_isr(DMA_CHANNEL1);
+}
+
+void dma1_channel2_isr(void)
+{
+    hw_dma_isr(DMA_CHANNEL2);
+}
+
+void dma1_channel3_isr(void)
+{
+    hw_dma_isr(DMA_CHANNEL3);
+}
+
+void dma1_channel4_isr(void)
+{
+    hw_dma_isr(DMA_CHANNEL4);
+}
+
+void dma1_channel5_isr(void)
+{
+    hw_dma_isr(DMA_CHANNEL5);
+}
+
+void dma1_channel6_isr(void)
+{
+    hw_dma_isr(DMA_CHANNEL6);
+}
+
+void dma1_channel7_isr(void)
+{
+    hw_dma_isr(DMA_CHANNEL7);
+}
+
+int hw_dma_request(int chn, void (*isr)(int inst), int inst)
+{
+    hw_dma_owner_t *owner;
+
+    if (chn < DMA_CHANNEL1 || chn > DMA_CHANNEL7 || !isr) {
+        return -CUPKEE_EINVAL;
+    }
+
+    owner = &dma_owners[chn - 1];
+    if (owner->isr) {
+        return -CUPKEE_ERESOURCE;
+    }
+
+    rcc_periph_clock_enable(RCC_DMA1);
+
+    owner->isr  = isr;
+    owner->inst = inst;
+
+    return CUPKEE_OK;
+}
+
+void hw_dma_release(int chn)
+{
+    if (chn >= DMA_CHANNEL1 && chn <= DMA_CHANNEL7) {
+        dma_channel_reset(DMA1, chn);
+        dma_owners[chn - 1].isr = NULL;
+    }
+}
+
+void hw_setup_dma(void)
+{
+    memset(dma_owners, 0, sizeof(dma_owners));
+}
+
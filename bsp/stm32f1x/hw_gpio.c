@@ -34,10 +34,28 @@ SOFTWARE.
 
 #define PIN_MAP_MAX             16
 
+#define EXTI_IRQS               7
+
+// Bits of group value sit on pins (bit + shift) of a bank
+typedef struct hw_pin_run_t {
+    uint8_t  slot;      // index in group banks
+    int8_t   shift;
+    uint16_t mask;      // pins in the bank
+} hw_pin_run_t;
+
 typedef struct hw_pin_t {
     uint8_t inused;
     uint8_t dev_id;
     uint16_t  data;
+    uint16_t lines;             // exti lines of input pins, 0: polled in sync
+    volatile uint16_t edges;    // lines with edge since last report, set in isr
+    volatile uint32_t stamp;    // systicks of last edge
+    uint16_t edge_bits;         // group bits with edge in last report
+    uint32_t edge_stamp;        // systicks of last edge in last report
+    uint8_t bank_num;
+    uint8_t run_num;
+    uint8_t banks[BANK_MAX];
+    hw_pin_run_t runs[PIN_MAP_MAX];
     const hw_config_pin_t *config;
 } hw_pin_t;
 
@@ -45,6 +63,14 @@ static uint8_t  led_map;
 static uint8_t  pin_maps[PIN_MAP_MAX];
 static hw_pin_t pin_controls[HW_INSTANCES_PIN];
 static uint16_t hw_gpio_used[BANK_MAX];
+static uint16_t exti_used;
+static const uint8_t exti_irq[EXTI_IRQS] = {
+    NVIC_EXTI0_IRQ, NVIC_EXTI1_IRQ, NVIC_EXTI2_IRQ, NVIC_EXTI3_IRQ, NVIC_EXTI4_IRQ,
+    NVIC_EXTI9_5_IRQ, NVIC_EXTI15_10_IRQ
+};
+static const uint16_t exti_irq_lines[EXTI_IRQS] = {
+    0x0001, 0x0002, 0x0004, 0x0008, 0x0010, 0x03E0, 0xFC00
+};
 static const uint32_t hw_gpio_rcc[BANK_MAX] = {
     RCC_GPIOA, RCC_GPIOB, RCC_GPIOC, RCC_GPIOD, RCC_GPIOE, RCC_GPIOF, RCC_GPIOF
 };
@@ -94,24 +120,78 @@ static inline int map_read(uint8_t map) {
     return (GPIO_IDR(bank_base) & (1 << pin)) != 0;
 }
 
-static void maps_write(int start, int n, uint32_t v) {
-    int i;
+// Plan group access at setup: one register access per bank, whatever the mapping
+static void maps_plan(hw_pin_t *control, int start, int n)
+{
+    int i, slot, r;
 
-    for (i = 0; i < n && start + i < PIN_MAP_MAX; i++) {
+    control->bank_num = 0;
+    control->run_num = 0;
+
+    for (i = 0; i < n; i++) {
         uint8_t map = pin_maps[start + i];
+        int bank = map_bank(map);
+        int pin  = map_pin(map);
+        int shift = pin - i;
+
+        for (slot = 0; slot < control->bank_num && control->banks[slot] != bank; slot++)
+            ;
+        if (slot == control->bank_num) {
+            control->banks[control->bank_num++] = bank;
+        }
 
-        map_write(map, v & (1 << i));
+        // bits moved by same distance share one run, even not adjacent
+        for (r = 0; r < control->run_num; r++) {
+            if (control->runs[r].slot == slot && control->runs[r].shift == shift) {
+                break;
+            }
+        }
+        if (r == control->run_num) {
+            control->runs[r].slot  = slot;
+            control->runs[r].shift = shift;
+            control->runs[r].mask  = 0;
+            control->run_num++;
+        }
+        control->runs[r].mask |= 1 << pin;
     }
 }
 
-static uint32_t maps_read(int start, int n) {
+static void maps_write(hw_pin_t *control, uint32_t v) {
+    uint32_t bsrr[BANK_MAX];
     int i;
+
+    for (i = 0; i < control->bank_num; i++) {
+        bsrr[i] = 0;
+    }
+
+    for (i = 0; i < control->run_num; i++) {
+        const hw_pin_run_t *run = &control->runs[i];
+        uint32_t bits = run->shift >= 0 ? v << run->shift : v >> -run->shift;
+
+        bits &= run->mask;
+        bsrr[run->slot] |= bits | ((run->mask & ~bits) << 16);
+    }
+
+    // set & reset together, pins of a bank change at once
+    for (i = 0; i < control->bank_num; i++) {
+        GPIO_BSRR(hw_gpio_bank[control->banks[i]]) = bsrr[i];
+    }
+}
+
+static uint32_t maps_read(hw_pin_t *control) {
+    uint32_t idr[BANK_MAX];
     uint32_t v = 0;
+    int i;
 
-    for (i = 0; i < n && start + i < PIN_MAP_MAX; i++) {
-        uint8_t map = pin_maps[start + i];
+    for (i = 0; i < control->bank_num; i++) {
+        idr[i] = GPIO_IDR(hw_gpio_bank[control->banks[i]]);
+    }
+
+    for (i = 0; i < control->run_num; i++) {
+        const hw_pin_run_t *run = &control->runs[i];
+        uint32_t bits = idr[run->slot] & run->mask;
 
-        v |= map_read(map) << i;
+        v |= run->shift >= 0 ? bits >> run->shift : bits << -run->shift;
     }
     return v;
 }
@@ -133,6 +213,123 @@ static inline void map_release(uint8_t map) {
     }
 }
 
+/******************************************************************
+ * EXTI: edges of input pins
+ ******************************************************************/
+static void exti_isr(void)
+{
+    uint32_t pending = EXTI_PR & exti_used;
+    int i;
+
+    EXTI_PR = pending;
+
+    for (i = 0; i < HW_INSTANCES_PIN; i++) {
+        hw_pin_t *control = &pin_controls[i];
+        uint16_t edges = pending & control->lines;
+
+        if (!edges) {
+            continue;
+        }
+
+        control->edges |= edges;
+        control->stamp = _cupkee_systicks;
+        if (control->config->debounce) {
+            // line quiet until settle, bounces not interrupt anymore
+            EXTI_IMR &= ~edges;
+        } else {
+            cupkee_device_poll_request(control->dev_id);
+        }
+    }
+}
+
+void exti0_isr(void)
+{
+    exti_isr();
+}
+
+void exti1_isr(void)
+{
+    exti_isr();
+}
+
+void exti2_isr(void)
+{
+    exti_isr();
+}
+
+void exti3_isr(void)
+{
+    exti_isr();
+}
+
+void exti4_isr(void)
+{
+    exti_isr();
+}
+
+void exti9_5_isr(void)
+{
+    exti_isr();
+}
+
+void exti15_10_isr(void)
+{
+    exti_isr();
+}
+
+static void exti_irq_update(void)
+{
+    int i;
+
+    for (i = 0; i < EXTI_IRQS; i++) {
+        if (exti_used & exti_irq_lines[i]) {
+            nvic_enable_irq(exti_irq[i]);
+        } else {
+            nvic_disable_irq(exti_irq[i]);
+        }
+    }
+}
+
+// A line serve one pin of all banks, group not fit go back to sync polling
+static uint16_t exti_setup(int start, int n)
+{
+    uint16_t lines = 0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        uint16_t line = 1 << map_pin(pin_maps[start + i]);
+
+        if ((exti_used | lines) & line) {
+            return 0;
+        }
+        lines |= line;
+    }
+
+    rcc_periph_clock_enable(RCC_AFIO);
+    for (i = 0; i < n; i++) {
+        uint8_t map = pin_maps[start + i];
+
+        exti_select_source(1 << map_pin(map), hw_gpio_bank[map_bank(map)]);
+    }
+    exti_set_trigger(lines, EXTI_TRIGGER_BOTH);
+    EXTI_PR = lines;
+    exti_enable_request(lines);
+
+    exti_used |= lines;
+    exti_irq_update();
+
+    return lines;
+}
+
+static void exti_reset(uint16_t lines)
+{
+    exti_disable_request(lines);
+    EXTI_PR = lines;
+
+    exti_used &= ~lines;
+    exti_irq_update();
+}
+
 /******************************************************************
  * GPIO device: PIN
  ******************************************************************/
@@ -142,6 +339,11 @@ static void pin_reset(int instance)
     const hw_config_pin_t *config = control->config;
     int i;
 
+    if (control->lines) {
+        exti_reset(control->lines);
+        control->lines = 0;
+    }
+
     for (i = 0; i < config->num; i++) {
         uint8_t map = pin_maps[config->start + i];
         map_release(map);
@@ -201,12 +403,19 @@ static int pin_setup(int instance, uint8_t dev_id, const hw_config_t *conf)
         map_set_mode(map, mod, cnf);
     }
 
+    maps_plan(control, config->start, config->num);
+
     control->dev_id = dev_id;
     control->config = config;
+    control->edges = 0;
+    control->edge_bits = 0;
+    control->edge_stamp = 0;
     if (config->dir == DEVICE_OPT_DIR_OUT) {
         control->data = 0;
+        control->lines = 0;
     } else {
-        control->data = maps_read(config->start, config->num);
+        control->data = maps_read(control);
+        control->lines = exti_setup(config->start, config->num);
     }
     return CUPKEE_OK;
 
@@ -218,21 +427,75 @@ DO_ERROR:
     return -err;
 }
 
-static void pin_sync(int instance, uint32_t systicks)
+static void pin_update(hw_pin_t *control)
+{
+    uint16_t data = maps_read(control);
+
+    if (data != control->data) {
+        control->data = data;
+        cupkee_event_post_device_data(control->dev_id);
+    }
+}
+
+// Edge lines to bits of group value
+static uint16_t pin_edge_bits(hw_pin_t *control, uint16_t edges)
+{
+    const hw_config_pin_t *config = control->config;
+    uint16_t bits = 0;
+    int i;
+
+    for (i = 0; i < config->num; i++) {
+        if (edges & (1 << map_pin(pin_maps[config->start + i]))) {
+            bits |= 1 << i;
+        }
+    }
+    return bits;
+}
+
+static void pin_poll(int instance)
 {
     hw_pin_t *control = &pin_controls[instance];
-    uint16_t data;
+    uint8_t debounce = control->config->debounce;
+    uint32_t state, stamp;
+    uint16_t edges;
+
+    hw_enter_critical(&state);
+    edges = control->edges;
+    stamp = control->stamp;
+    if (debounce && _cupkee_systicks - control->stamp < debounce) {
+        edges = 0;
+    } else {
+        control->edges = 0;
+    }
+    if (edges && debounce) {
+        // settled, listen again
+        EXTI_PR = edges;
+        EXTI_IMR |= edges;
+    }
+    hw_exit_critical(state);
 
-    (void) systicks;
+    // all edges since last report come to one event, even value is back
+    if (edges) {
+        control->edge_bits = pin_edge_bits(control, edges);
+        control->edge_stamp = stamp;
+        control->data = maps_read(control);
+        cupkee_event_post_device_data(control->dev_id);
+    }
+}
+
+static void pin_sync(int instance, uint32_t systicks)
+{
+    hw_pin_t *control = &pin_controls[instance];
 
     if (control->config->dir == DEVICE_OPT_DIR_OUT) {
         return;
     }
 
-    data = maps_read(control->config->start, control->config->num);
-    if (data != control->data) {
-        control->data = data;
-        cupkee_event_post_device_data(control->dev_id);
+    if (!control->lines) {
+        pin_update(control);
+    } else
+    if (control->edges && systicks - control->stamp >= control->config->debounce) {
+        cupkee_device_poll_request(control->dev_id);
     }
 }
 
@@ -245,13 +508,23 @@ static int pin_get(int instance, int off, uint32_t *data)
     }
 
     if (off < 0) {
-        *data = maps_read(control->config->start, control->config->num);
+        *data = maps_read(control);
         return 1;
     } else
     if (off < control->config->num) {
         uint8_t map = pin_maps[control->config->start + off];
         *data = map_read(map);
         return 1;
+    } else
+    if (control->lines && off == control->config->num) {
+        // pins with edge in last data event
+        *data = control->edge_bits;
+        return 1;
+    } else
+    if (control->lines && off == control->config->num + 1) {
+        // systicks of last edge in last data event
+        *data = control->edge_stamp;
+        return 1;
     }
 
     return 0;
@@ -266,7 +539,7 @@ static int pin_set(int instance, int off, uint32_t data)
     }
 
     if (off < 0) {
-        maps_write(control->config->start, control->config->num, data);
+        maps_write(control, data);
         return 1;
     } else
     if (off < control->config->num) {
@@ -289,10 +562,13 @@ static const hw_driver_t pin_driver = {
     .reset   = pin_reset,
     .setup   = pin_setup,
     .sync    = pin_sync,
+    .poll    = pin_poll,
 
     .get = pin_get,
     .set = pin_set,
-    .size = pin_size
+    .size = pin_size,
+
+    .flags   = HW_DRIVER_FL_POLL_REQ
 };
 
 int hw_setup_gpio(void)
@@ -31,6 +31,7 @@ SOFTWARE.
 
 #define I2C_REG_BASE(inst)  ((inst) == 0 ? I2C1 : I2C2)
 #define I2C_TOUT_THRESHOLD  20 // 20ms
+#define I2C_STOP_SPIN       1000
 
 #define I2C_EVENT_MASTER_MODE_SELECT                ((uint32_t)0x00030001) //           SR2_BUSY | SR2_MASTER | SR1_SB
 #define I2C_EVENT_STOP                              ((uint32_t)0x00000010) //                                   SR1_STOPF
@@ -48,32 +49,51 @@ SOFTWARE.
 // EV8_2
 #define I2C_EVENT_MASTER_TRANSMITTED                ((uint32_t)0x00070084) // SR2_TRA | SR2_BUSY | SR2_MASTER | SR1_TxE | SR1_BTF
 
+#define I2C_CR2_IT_ALL      (I2C_CR2_ITEVTEN | I2C_CR2_ITBUFEN | I2C_CR2_ITERREN)
+#define I2C_SR1_ERR_ALL     (I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_AF | I2C_SR1_OVR | I2C_SR1_TIMEOUT)
+
+// Transaction queued in req_buf: head {slave, wlen, rlen}, then wlen bytes to write.
+// Both parts set: write, restart, read. e.g. register burst read
+#define I2C_TRANS_HEAD      3
+
+#define I2C_REG_NONE        0xFFFF
+
+#define I2C_DONE_READ       1
+#define I2C_DONE_WRITE      2
+
 enum {
     I2C_STATE_IDLE = 0,
-    I2C_STATE_ERROR,
-    I2C_STATE_WAIT_NBUSY,
-    I2C_STATE_WAIT_START,
-    I2C_STATE_WAIT_RADDR,
-    I2C_STATE_WAIT_WADDR,
-    I2C_STATE_SEND_DATA,
-    I2C_STATE_WAIT_DATA_1,
-    I2C_STATE_WAIT_DATA_2,
-    I2C_STATE_WAIT_DATA_N,
-    I2C_STATE_STOP,
+    I2C_STATE_START,
+    I2C_STATE_ADDR,
+    I2C_STATE_SEND,
+    I2C_STATE_RECV,
 };
 
 enum {
     I2C_PROP_SLAVE = 0,
+    I2C_PROP_REG,
 };
 
 typedef struct hw_i2c_t {
     uint8_t dev_id;
-    uint8_t state;
+    volatile uint8_t state;
 
     uint8_t slave_addr;
-    uint8_t trans_time;
-    uint8_t trans_size;
+    uint16_t reg;
+
+    // current transaction, owned by isr
+    uint8_t trans_addr;
+    uint8_t trans_wlen;
+    uint8_t trans_rlen;
     uint8_t trans_pos;
+    volatile uint8_t trans_time;
+
+    // bytes queued for read but not received yet
+    volatile uint16_t rcv_pend;
+
+    // reported by isr, consumed in poll
+    volatile uint8_t done;
+    volatile uint8_t error;
 
     void   *req_buf;
     void   *rcv_buf;
@@ -84,6 +104,9 @@ static uint8_t use_map;
 
 static hw_i2c_t i2c_controls[HW_INSTANCES_I2C];
 
+static const uint8_t device_ev_irq[HW_INSTANCES_I2C] = {NVIC_I2C1_EV_IRQ, NVIC_I2C2_EV_IRQ};
+static const uint8_t device_er_irq[HW_INSTANCES_I2C] = {NVIC_I2C1_ER_IRQ, NVIC_I2C2_ER_IRQ};
+
 static inline int hw_i2c_match_event(uint32_t i2c, uint32_t event)
 {
     uint32_t status = I2C_SR1(i2c);
@@ -132,233 +155,256 @@ static inline void hw_i2c_reset_pin(int instance)
     hw_gpio_release(1, pins);
 }
 
-static int request_read(hw_i2c_t *control, size_t n)
+static void i2c_trans_next(uint32_t i2c, hw_i2c_t *control)
 {
-    uint8_t req[2];
+    uint8_t head[I2C_TRANS_HEAD];
 
-    if (cupkee_buffer_space(control->req_buf) < 2 ||
-        cupkee_buffer_space(control->rcv_buf) < n) {
-        return 0;
+    if (I2C_TRANS_HEAD != cupkee_buffer_take(control->req_buf, I2C_TRANS_HEAD, head)) {
+        I2C_CR2(i2c) &= ~I2C_CR2_IT_ALL;
+        control->state = I2C_STATE_IDLE;
+        return;
     }
 
-    req[0] = 1;
-    req[1] = n;
+    control->trans_addr = head[1] ? head[0] & ~1 : head[0] | 1;
+    control->trans_wlen = head[1];
+    control->trans_rlen = head[2];
+    control->trans_pos  = 0;
+    control->trans_time = 0;
+    control->state = I2C_STATE_START;
 
-    return cupkee_buffer_give(control->req_buf, 2, req);
+    I2C_CR1(i2c) |= I2C_CR1_START;
+    I2C_CR2(i2c) = (I2C_CR2(i2c) & ~I2C_CR2_ITBUFEN) | I2C_CR2_ITEVTEN | I2C_CR2_ITERREN;
 }
 
-static int request_write(hw_i2c_t *control, size_t n, const void *data)
+static void i2c_trans_done(uint32_t i2c, hw_i2c_t *control, uint8_t done)
 {
-    uint8_t req[2];
+    int spin;
 
-    if (cupkee_buffer_space(control->req_buf) < 2 + n) {
-        return 0;
-    }
+    control->done |= done;
+    cupkee_device_poll_request(control->dev_id);
 
-    req[0] = 1;
-    req[1] = n;
+    // CR1 write before the stop go out would issue it again
+    for (spin = 0; (I2C_CR1(i2c) & I2C_CR1_STOP) && spin < I2C_STOP_SPIN; spin++)
+        ;
+    I2C_CR1(i2c) = (I2C_CR1(i2c) & ~I2C_CR1_POS) | I2C_CR1_ACK;
 
-    cupkee_buffer_give(control->req_buf, 2, req);
-    return cupkee_buffer_give(control->req_buf, n, data);
+    // next slave right away, main loop not involved
+    i2c_trans_next(i2c, control);
 }
 
-static int request_go_trans(hw_i2c_t *control)
+static void i2c_trans_abort(uint32_t i2c, hw_i2c_t *control, uint8_t err)
 {
-    uint8_t req[2];
-    int ret = cupkee_buffer_take(control->req_buf, 2, req);
+    unsigned lost;
 
-    if (ret == 2) {
-        if (req[0]) {
-            control->slave_addr |= 1;  // read
-        } else {
-            control->slave_addr &= ~1; // write
-        }
-        control->trans_size = req[1];
-        control->trans_time = 0;
-        control->trans_pos = 0;
-
-        return 1;
+    if (control->trans_addr & 1) {
+        lost = control->trans_rlen - control->trans_pos;
     } else {
-        return 0;
+        cupkee_buffer_skip(control->req_buf, control->trans_wlen - control->trans_pos);
+        lost = control->trans_rlen;
     }
+    control->rcv_pend -= lost;
+    control->error = err;
+
+    i2c_trans_done(i2c, control, 0);
 }
 
-static void do_error_timeout(uint32_t i2c, hw_i2c_t *control)
+static inline void i2c_recv_push(uint32_t i2c, hw_i2c_t *control)
 {
-    if (I2C_SR2(i2c) & I2C_SR2_MSL) {
-        I2C_CR1(i2c) |= I2C_CR1_STOP;
-    }
-
-    cupkee_device_set_error(control->dev_id, CUPKEE_ETIMEOUT);
-
-    control->state = I2C_STATE_IDLE;
-
-    //Todo: try next req OR clean req queue
+    cupkee_buffer_push(control->rcv_buf, I2C_DR(i2c));
+    control->trans_pos++;
+    control->rcv_pend--;
 }
 
-static void do_try_start(uint32_t i2c, hw_i2c_t *control)
+static void i2c_recv_begin(uint32_t i2c, hw_i2c_t *control)
 {
-    if (control->state == I2C_STATE_IDLE) {
-        if (request_go_trans(control)) {
-            if (I2C_SR2(i2c) & I2C_SR2_BUSY) {
-                control->state = I2C_STATE_WAIT_NBUSY;
-            } else {
-                I2C_CR1(i2c) |= I2C_CR1_START;
-                control->state = I2C_STATE_WAIT_START;
-            }
+    control->state = I2C_STATE_RECV;
+
+    switch (control->trans_rlen) {
+    case 1: // Nack and stop before the byte come in
+        I2C_CR1(i2c) &= ~I2C_CR1_ACK;
+        (void) I2C_SR2(i2c); // Clear addr
+        I2C_CR1(i2c) |= I2C_CR1_STOP;
+        I2C_CR2(i2c) |= I2C_CR2_ITBUFEN;
+        break;
+    case 2: // Nack the second byte, wait both in DR and shift register
+        I2C_CR1(i2c) |= I2C_CR1_POS;
+        (void) I2C_SR2(i2c);
+        I2C_CR1(i2c) &= ~I2C_CR1_ACK;
+        break;
+    default:
+        (void) I2C_SR2(i2c);
+        if (control->trans_rlen > 3) {
+            I2C_CR2(i2c) |= I2C_CR2_ITBUFEN;
         }
+        break;
     }
 }
 
-static void do_wait_nbusy(uint32_t i2c, hw_i2c_t *control)
+static void i2c_recv(uint32_t i2c, hw_i2c_t *control, uint32_t sr1)
 {
-    if (!(I2C_SR2(i2c) & I2C_SR2_BUSY)) {
-        I2C_CR1(i2c) |= I2C_CR1_START;
-        control->state = I2C_STATE_WAIT_START;
-    }
-}
+    unsigned lft = control->trans_rlen - control->trans_pos;
 
-static void do_wait_start(uint32_t i2c, hw_i2c_t *control)
-{
-    if (hw_i2c_match_event(i2c, I2C_EVENT_MASTER_MODE_SELECT)) {
-        I2C_DR(i2c) = control->slave_addr;
-        if (control->slave_addr & 1) {
-            control->state = I2C_STATE_WAIT_RADDR;
-        } else {
-            control->state = I2C_STATE_WAIT_WADDR;
+    if (lft > 3) {
+        if (sr1 & I2C_SR1_RxNE) {
+            i2c_recv_push(i2c, control);
+            if (lft == 4) {
+                // last 3 bytes handled on BTF
+                I2C_CR2(i2c) &= ~I2C_CR2_ITBUFEN;
+            }
+        }
+    } else
+    if (lft == 3) {
+        if (sr1 & I2C_SR1_BTF) {
+            I2C_CR1(i2c) &= ~I2C_CR1_ACK; // Nack to last byte
+            i2c_recv_push(i2c, control);
+        }
+    } else
+    if (lft == 2) {
+        if (sr1 & I2C_SR1_BTF) {
+            I2C_CR1(i2c) |= I2C_CR1_STOP;
+            i2c_recv_push(i2c, control);
+            i2c_recv_push(i2c, control);
+            i2c_trans_done(i2c, control, I2C_DONE_READ);
+        }
+    } else {
+        if (sr1 & I2C_SR1_RxNE) {
+            i2c_recv_push(i2c, control);
+            i2c_trans_done(i2c, control, I2C_DONE_READ);
         }
-        control->trans_pos = 0;
     }
 }
 
-static void do_wait_raddr(uint32_t i2c, hw_i2c_t *control)
+static void i2c_send(uint32_t i2c, hw_i2c_t *control, uint32_t sr1)
 {
-    if (I2C_SR1(i2c) & I2C_SR1_ADDR) {
-        uint32_t irq_state;
+    if (control->trans_pos < control->trans_wlen) {
+        if (sr1 & I2C_SR1_TxE) {
+            uint8_t data = 0;
 
-        switch (control->trans_size) {
-        case 1: // one byte read
-            I2C_CR1(i2c) &= ~I2C_CR1_ACK; // Nack for DataN
-
-            hw_enter_critical(&irq_state);
-            hw_i2c_match_event(i2c, I2C_EVENT_MASTER_RECEIVER_MODE_SELECT); // Clear addr
+            cupkee_buffer_shift(control->req_buf, &data);
+            I2C_DR(i2c) = data;
+            if (++control->trans_pos == control->trans_wlen) {
+                // wait BTF of the last byte
+                I2C_CR2(i2c) &= ~I2C_CR2_ITBUFEN;
+            }
+        }
+    } else
+    if (sr1 & I2C_SR1_BTF) {
+        if (control->trans_rlen) {
+            // restart for read part, in the same transaction
+            control->trans_addr |= 1;
+            control->trans_pos = 0;
+            control->state = I2C_STATE_START;
+            I2C_CR1(i2c) |= I2C_CR1_START;
+        } else {
             I2C_CR1(i2c) |= I2C_CR1_STOP;
-            hw_exit_critical(irq_state);
-            control->state = I2C_STATE_WAIT_DATA_1;
-
-            break;
-        case 2: // two bytes read
-            I2C_CR1(i2c) |= I2C_CR1_POS; // Trigger Nack at next shift complete
-
-            hw_enter_critical(&irq_state);
-            hw_i2c_match_event(i2c, I2C_EVENT_MASTER_RECEIVER_MODE_SELECT); // Clear addr
-            I2C_CR1(i2c) &= ~I2C_CR1_ACK; // Nack
-            hw_exit_critical(irq_state);
-            control->state = I2C_STATE_WAIT_DATA_2;
-
-            break;
-        default: // n bytes read
-            hw_i2c_match_event(i2c, I2C_EVENT_MASTER_RECEIVER_MODE_SELECT); // Clear addr
-            control->state = I2C_STATE_WAIT_DATA_N;
-            break;
+            i2c_trans_done(i2c, control, I2C_DONE_WRITE);
         }
     }
 }
 
-static void do_wait_data_1(uint32_t i2c, hw_i2c_t *control)
+static void i2c_event_isr(int instance)
 {
-    if(hw_i2c_match_event(i2c, I2C_EVENT_MASTER_RECEIVED)) {
-        control->trans_pos++;
-        cupkee_buffer_push(control->rcv_buf, I2C_DR(i2c));
-        control->state = I2C_STATE_STOP;
+    hw_i2c_t *control = &i2c_controls[instance];
+    uint32_t i2c = I2C_REG_BASE(instance);
+    uint32_t sr1 = I2C_SR1(i2c);
+
+    switch (control->state) {
+    case I2C_STATE_START:
+        if (sr1 & I2C_SR1_SB) {
+            I2C_DR(i2c) = control->trans_addr;
+            control->state = I2C_STATE_ADDR;
+        }
+        break;
+    case I2C_STATE_ADDR:
+        if (sr1 & I2C_SR1_ADDR) {
+            if (control->trans_addr & 1) {
+                i2c_recv_begin(i2c, control);
+            } else {
+                (void) I2C_SR2(i2c); // Clear addr
+                control->state = I2C_STATE_SEND;
+                I2C_CR2(i2c) |= I2C_CR2_ITBUFEN;
+            }
+        }
+        break;
+    case I2C_STATE_SEND: i2c_send(i2c, control, sr1); break;
+    case I2C_STATE_RECV: i2c_recv(i2c, control, sr1); break;
+    default:
+        I2C_CR2(i2c) &= ~I2C_CR2_IT_ALL;
+        break;
     }
 }
 
-static void do_wait_data_2(uint32_t i2c, hw_i2c_t *control)
+static void i2c_error_isr(int instance)
 {
-    if(hw_i2c_match_event(i2c, I2C_EVENT_MASTER_RECEIVE_HOLD)) {
-        uint32_t irq_state;
+    hw_i2c_t *control = &i2c_controls[instance];
+    uint32_t i2c = I2C_REG_BASE(instance);
+    uint32_t sr1 = I2C_SR1(i2c);
 
-        control->trans_pos += 2;
+    I2C_SR1(i2c) = sr1 & ~I2C_SR1_ERR_ALL;
 
-        hw_enter_critical(&irq_state);
-        I2C_CR1(i2c) |= I2C_CR1_STOP;
-        cupkee_buffer_push(control->rcv_buf, I2C_DR(i2c));
-        hw_exit_critical(irq_state);
-        cupkee_buffer_push(control->rcv_buf, I2C_DR(i2c));
+    if (control->state == I2C_STATE_IDLE) {
+        return;
+    }
 
-        control->state = I2C_STATE_STOP;
+    // bus already released by hardware when arbitration lost
+    if (!(sr1 & I2C_SR1_ARLO)) {
+        I2C_CR1(i2c) |= I2C_CR1_STOP;
     }
+    i2c_trans_abort(i2c, control, CUPKEE_EHARDWARE);
 }
 
-static void do_wait_data_n(uint32_t i2c, hw_i2c_t *control)
+void i2c1_ev_isr(void)
 {
-    if(hw_i2c_match_event(i2c, I2C_EVENT_MASTER_RECEIVE_HOLD)) {
-        unsigned lft = control->trans_size - control->trans_pos;
-        if (lft > 3) {
-            cupkee_buffer_push(control->rcv_buf, I2C_DR(i2c));
-            control->trans_pos++;
-        } else
-        if (lft == 3) {
-            I2C_CR1(i2c) &= ~I2C_CR1_ACK; // Nack to last byte
-            cupkee_buffer_push(control->rcv_buf, I2C_DR(i2c));
-            control->trans_pos++;
-        } else {
-            uint32_t irq_state;
-
-            hw_enter_critical(&irq_state);
-            I2C_CR1(i2c) |= I2C_CR1_STOP;
-            cupkee_buffer_push(control->rcv_buf, I2C_DR(i2c));
-            hw_exit_critical(irq_state);
-            cupkee_buffer_push(control->rcv_buf, I2C_DR(i2c));
-
-            control->trans_pos += 2;
-            control->state = I2C_STATE_STOP;
-        }
-    }
+    i2c_event_isr(0);
 }
 
-static void do_wait_waddr(uint32_t i2c, hw_i2c_t *control)
+void i2c1_er_isr(void)
 {
-    if (hw_i2c_match_event(i2c, I2C_EVENT_MASTER_TRANSMITTER_MODE_SELECT)) {
-        uint8_t data;
+    i2c_error_isr(0);
+}
 
-        cupkee_buffer_shift(control->req_buf, &data);
-        I2C_DR(i2c) = data;
+void i2c2_ev_isr(void)
+{
+    i2c_event_isr(1);
+}
 
-        control->trans_pos = 1;
-        control->state = I2C_STATE_SEND_DATA;
-    }
+void i2c2_er_isr(void)
+{
+    i2c_error_isr(1);
 }
 
-static void do_send_data(uint32_t i2c, hw_i2c_t *control)
+static int request_trans(int instance, size_t wlen, const uint8_t *wdat, size_t n, const void *data, size_t rlen)
 {
-    if (hw_i2c_match_event(i2c, I2C_EVENT_MASTER_TRANSMITTING)) {
-        if (control->trans_pos < control->trans_size) {
-            uint8_t data;
+    hw_i2c_t *control = hw_i2c_control(instance);
+    uint32_t state;
+    uint8_t head[I2C_TRANS_HEAD];
+    int err = CUPKEE_OK;
 
-            cupkee_buffer_shift(control->req_buf, &data);
-            I2C_DR(i2c) = data;
-            control->trans_pos++;
-        } else {
-            I2C_CR1(i2c) |= I2C_CR1_STOP;
-            control->state = I2C_STATE_STOP;
-        }
+    if (wlen + n > UINT8_MAX || rlen > UINT8_MAX) {
+        return -CUPKEE_EINVAL;
     }
-}
 
-static void do_stop(uint32_t i2c, hw_i2c_t *control)
-{
-    I2C_CR1(i2c) |= I2C_CR1_ACK;
-    control->state = I2C_STATE_IDLE;
+    head[0] = control->slave_addr;
+    head[1] = wlen + n;
+    head[2] = rlen;
 
-    if (control->slave_addr & 1) {
-        cupkee_event_post_device_data(control->dev_id);
+    hw_enter_critical(&state);
+    if (cupkee_buffer_space(control->req_buf) < I2C_TRANS_HEAD + wlen + n ||
+        cupkee_buffer_space(control->rcv_buf) < control->rcv_pend + rlen) {
+        err = -CUPKEE_EFULL;
     } else {
-        cupkee_event_post_device_drain(control->dev_id);
+        cupkee_buffer_give(control->req_buf, I2C_TRANS_HEAD, head);
+        cupkee_buffer_give(control->req_buf, wlen, wdat);
+        cupkee_buffer_give(control->req_buf, n, data);
+        control->rcv_pend += rlen;
+
+        if (control->state == I2C_STATE_IDLE) {
+            i2c_trans_next(I2C_REG_BASE(instance), control);
+        }
     }
+    hw_exit_critical(state);
 
-    do_try_start(i2c, control);
+    return err;
 }
 
 static void hw_i2c_reset(int instance)
@@ -366,6 +412,9 @@ static void hw_i2c_reset(int instance)
     hw_i2c_t *control = hw_i2c_control(instance);
     uint32_t i2c = I2C_REG_BASE(instance);
 
+    nvic_disable_irq(device_ev_irq[instance]);
+    nvic_disable_irq(device_er_irq[instance]);
+
     // Reset hardware
     I2C_CR1(i2c) = I2C_CR1_SWRST;
 
@@ -381,7 +430,7 @@ static void hw_i2c_reset(int instance)
     I2C_TRISE(i2c) = 0;
     I2C_CCR(i2c) = 0;
 
-    rcc_periph_clock_disable(RCC_I2C1);
+    rcc_periph_clock_disable(instance == 0 ? RCC_I2C1 : RCC_I2C2);
 
     // release resource
     if (control->rcv_buf) {
@@ -414,9 +463,12 @@ static int hw_i2c_setup(int instance, uint8_t dev_id, const hw_config_t *conf)
     control->dev_id = dev_id;
     control->state = I2C_STATE_IDLE;
     control->slave_addr = 0;
+    control->reg = I2C_REG_NONE;
     control->trans_time = 0;
-    control->trans_size = 0;
     control->trans_pos = 0;
+    control->rcv_pend = 0;
+    control->done = 0;
+    control->error = 0;
 
     if (NULL == (control->rcv_buf = cupkee_buffer_alloc(I2C_RCV_BUF_SIZE))) {
         hw_i2c_reset_pin(instance);
@@ -468,8 +520,9 @@ static int hw_i2c_setup(int instance, uint8_t dev_id, const hw_config_t *conf)
         I2C_CCR(i2c) = I2C_CCR_FS | ccr;
     }
 
-    //enable all interrupts
-    //I2C_CR2(i2c) |= I2C_CR2_ITBUFEN | I2C_CR2_ITEVTEN | I2C_CR2_ITERREN;
+    // interrupts enabled in CR2 only while the queue is running
+    nvic_enable_irq(device_ev_irq[instance]);
+    nvic_enable_irq(device_er_irq[instance]);
     I2C_CR1(i2c) |= I2C_CR1_ACK | I2C_CR1_PE;
 
     return 0; // CUPKEE_OK;
@@ -478,80 +531,107 @@ static int hw_i2c_setup(int instance, uint8_t dev_id, const hw_config_t *conf)
 static void hw_i2c_poll(int instance)
 {
     hw_i2c_t *control = hw_i2c_control(instance);
-    uint32_t i2c = I2C_REG_BASE(instance);
+    uint32_t state;
+    uint8_t done, error;
 
-    switch (control->state) {
-    case I2C_STATE_IDLE:
-    case I2C_STATE_ERROR: break;
-    case I2C_STATE_WAIT_NBUSY: do_wait_nbusy(i2c, control); break;
-    case I2C_STATE_WAIT_START: do_wait_start(i2c, control); break;
-    case I2C_STATE_WAIT_RADDR: do_wait_raddr(i2c, control); break;
-    case I2C_STATE_WAIT_WADDR: do_wait_waddr(i2c, control); break;
-    case I2C_STATE_SEND_DATA:  do_send_data(i2c, control); break;
-    case I2C_STATE_WAIT_DATA_1:  do_wait_data_1(i2c, control); break;
-    case I2C_STATE_WAIT_DATA_2:  do_wait_data_2(i2c, control); break;
-    case I2C_STATE_WAIT_DATA_N:  do_wait_data_n(i2c, control); break;
-    case I2C_STATE_STOP:  do_stop(i2c, control); break;
+    if (!control) {
+        return;
+    }
+
+    hw_enter_critical(&state);
+    done  = control->done;
+    error = control->error;
+    control->done  = 0;
+    control->error = 0;
+    hw_exit_critical(state);
+
+    if (error) {
+        cupkee_device_set_error(control->dev_id, error);
+    }
+    if (done & I2C_DONE_READ) {
+        cupkee_event_post_device_data(control->dev_id);
+    }
+    if (done & I2C_DONE_WRITE) {
+        cupkee_event_post_device_drain(control->dev_id);
     }
 }
 
 static void hw_i2c_sync(int instance, uint32_t systick)
 {
     hw_i2c_t *control = hw_i2c_control(instance);
+    uint32_t state;
 
     (void) systick;
 
-    if (!control || control->state <= I2C_STATE_ERROR) {
+    if (!control || control->state == I2C_STATE_IDLE) {
         return;
     }
 
-    control->trans_time++;
-    if (control->trans_time > I2C_TOUT_THRESHOLD) {
-        do_error_timeout(I2C_REG_BASE(instance), control);
+    hw_enter_critical(&state);
+    if (control->state != I2C_STATE_IDLE && ++control->trans_time > I2C_TOUT_THRESHOLD) {
+        uint32_t i2c = I2C_REG_BASE(instance);
+
+        if (I2C_SR2(i2c) & I2C_SR2_MSL) {
+            I2C_CR1(i2c) |= I2C_CR1_STOP;
+        }
+        i2c_trans_abort(i2c, control, CUPKEE_ETIMEOUT);
     }
+    hw_exit_critical(state);
 }
 
 static int hw_i2c_read_req(int instance, size_t size)
 {
     hw_i2c_t *control = hw_i2c_control(instance);
+    uint8_t reg;
 
     if (!control || size < 1) {
         return -CUPKEE_EINVAL;
     }
 
-    if (request_read(control, size) == 0) {
-        return -CUPKEE_EFULL;
+    // register set: write it, restart, then burst read from there
+    if (control->reg != I2C_REG_NONE) {
+        reg = control->reg;
+        return request_trans(instance, 1, &reg, 0, NULL, size);
+    } else {
+        return request_trans(instance, 0, NULL, 0, NULL, size);
     }
-
-    do_try_start(I2C_REG_BASE(instance), control);
-    return 0;
 }
 
 static int hw_i2c_read(int instance, size_t n, void *buf)
 {
     hw_i2c_t *control = hw_i2c_control(instance);
+    uint32_t state;
+    int cnt;
 
     if (!control) {
         return -CUPKEE_EINVAL;
     }
 
-    return cupkee_buffer_take(control->rcv_buf, n, buf);
+    hw_enter_critical(&state);
+    cnt = cupkee_buffer_take(control->rcv_buf, n, buf);
+    hw_exit_critical(state);
+
+    return cnt;
 }
 
 static int hw_i2c_write(int instance, size_t n, const void *data)
 {
     hw_i2c_t *control = hw_i2c_control(instance);
+    uint8_t reg;
+    int err;
 
     if (!control || n < 1) {
         return -CUPKEE_EINVAL;
     }
 
-    if (request_write(control, n, data) == 0) {
-        return -CUPKEE_EFULL;
+    if (control->reg != I2C_REG_NONE) {
+        reg = control->reg;
+        err = request_trans(instance, 1, &reg, n, data, 0);
+    } else {
+        err = request_trans(instance, 0, NULL, n, data, 0);
     }
 
-    do_try_start(I2C_REG_BASE(instance), control);
-    return n;
+    return err ? err : (int) n;
 }
 
 #define TOUT_TRY(cond)  while (cond) { \
@@ -572,13 +652,18 @@ static int hw_i2c_write_sync(int instance, size_t n, const void *data)
     }
 
     control = hw_i2c_control(instance);
-    i2c  = I2C_REG_BASE(instance);
-    addr = control->slave_addr & (~1);
-
     if (!control) {
         return -CUPKEE_EINVAL;
     }
 
+    // queued transactions own the bus
+    if (control->state != I2C_STATE_IDLE) {
+        return -CUPKEE_ERESOURCE;
+    }
+
+    i2c  = I2C_REG_BASE(instance);
+    addr = control->slave_addr & (~1);
+
     // Start
     TOUT_TRY (I2C_SR2(i2c) & I2C_SR2_BUSY);
     I2C_CR1(i2c) |= I2C_CR1_START;
@@ -719,13 +804,18 @@ static int hw_i2c_read_sync(int instance, size_t n, void *buf)
     }
 
     control = hw_i2c_control(instance);
-    i2c  = I2C_REG_BASE(instance);
-    addr = control->slave_addr | 1;
-
     if (!control) {
         return -CUPKEE_EINVAL;
     }
 
+    // queued transactions own the bus
+    if (control->state != I2C_STATE_IDLE) {
+        return -CUPKEE_ERESOURCE;
+    }
+
+    i2c  = I2C_REG_BASE(instance);
+    addr = control->slave_addr | 1;
+
     TOUT_TRY (I2C_SR2(i2c) & I2C_SR2_BUSY);
 
     if (n == 1) {
@@ -749,6 +839,10 @@ static int hw_i2c_prop_get(int instance, int which, uint32_t *value)
     if (which == I2C_PROP_SLAVE) {
         *value = control->slave_addr & (~1);
         return 1;
+    } else
+    if (which == I2C_PROP_REG) {
+        *value = control->reg;
+        return 1;
     }
     return 0;
 }
@@ -757,15 +851,23 @@ static int hw_i2c_prop_set(int instance, int which, uint32_t value)
 {
     hw_i2c_t *control = hw_i2c_control(instance);
 
-    value = value & 0xFE;
-
-    if (!control || (value & 0xfe) == 0) {
+    if (!control) {
         return 0;
     }
 
+    // new slave & register only apply to transactions queued later
     if (which == I2C_PROP_SLAVE) {
+        value = value & 0xFE;
+        if (value == 0) {
+            return 0;
+        }
         control->slave_addr = (uint8_t) value;
         return 1;
+    } else
+    if (which == I2C_PROP_REG) {
+        // out of byte range: plain read & write, no register phase
+        control->reg = value > UINT8_MAX ? I2C_REG_NONE : value;
+        return 1;
     }
     return 0;
 }
@@ -798,7 +900,7 @@ static int hw_i2c_io_cached(int instance, size_t *in, size_t *out)
 static int hw_i2c_prop_num(int instance)
 {
     (void) instance;
-    return 1;
+    return 2;
 }
 
 static const hw_driver_t i2c_driver = {
@@ -818,7 +920,9 @@ static const hw_driver_t i2c_driver = {
     .read      = hw_i2c_read,
     .write     = hw_i2c_write,
     .read_sync = hw_i2c_read_sync,
-    .write_sync = hw_i2c_write_sync
+    .write_sync = hw_i2c_write_sync,
+
+    .flags   = HW_DRIVER_FL_POLL_REQ
 };
 
 const hw_driver_t *hw_request_i2c(int instance)
@@ -829,6 +933,7 @@ const hw_driver_t *hw_request_i2c(int instance)
 
     i2c_controls[instance].dev_id = DEVICE_ID_INVALID;
     i2c_controls[instance].state  = I2C_STATE_IDLE;
+    i2c_controls[instance].reg    = I2C_REG_NONE;
 
     i2c_controls[instance].req_buf = NULL;
     i2c_controls[instance].rcv_buf = NULL;
@@ -0,0 +1,560 @@
+/*
+MIT License
+
+This file is part of cupkee project.
+
+Copyright (c) 2017 Lixing Ding <ding.lixing@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "hardware.h"
+
+#define SPI_TX_BUF_SIZE     128
+#define SPI_RX_BUF_SIZE     128
+#define SPI_XFER_MAX        64
+#define SPI_DUMMY           0xFF
+
+// Request queued in tx buffer: head {type, len}, then len bytes for write
+#define SPI_REQ_HEAD        2
+#define SPI_REQ_WRITE       0
+#define SPI_REQ_READ        1
+
+typedef struct hw_spi_t {
+    uint8_t dev_id;
+    uint8_t dma;                // transfer by dma, or by byte isr
+    uint8_t req_type;           // request in transfer
+    uint8_t req_left;           // bytes of the request not transferred
+    uint8_t xfer_len;           // bytes in transfer
+    volatile uint8_t xfer_done; // set in dma or byte isr
+    uint8_t xfer_pos;           // bytes transferred by byte isr
+    const uint8_t *xfer_tx;     // data to write by byte isr, dummy if NULL
+    uint16_t rd_pend;           // bytes requested to read, not received
+    void   *rx_buff;
+    void   *tx_buff;
+    const hw_config_spi_t *config;
+    uint8_t xfer_rx[SPI_XFER_MAX];
+} hw_spi_t;
+
+static uint8_t use_map;
+static hw_spi_t spi_controls[HW_INSTANCES_SPI];
+static const uint8_t spi_dummy = SPI_DUMMY;
+
+static const uint32_t device_base[] = {SPI1, SPI2};
+static const uint32_t device_rcc[]  = {RCC_SPI1, RCC_SPI2};
+static const uint8_t  device_bank[] = {0, 1};
+static const uint16_t device_pins[] = {GPIO5 | GPIO7, GPIO13 | GPIO15};
+static const uint16_t device_miso[] = {GPIO6, GPIO14};
+static const uint16_t device_nss[]  = {GPIO4, GPIO12};
+static const uint8_t dma_rx_chn[] = {DMA_CHANNEL2, DMA_CHANNEL4};
+static const uint8_t dma_tx_chn[] = {DMA_CHANNEL3, DMA_CHANNEL5};
+static const uint8_t dma_rx_irq[] = {NVIC_DMA1_CHANNEL2_IRQ, NVIC_DMA1_CHANNEL4_IRQ};
+static const uint8_t device_irq[] = {NVIC_SPI1_IRQ, NVIC_SPI2_IRQ};
+
+static inline hw_spi_t *hw_spi_control(int instance)
+{
+    if (instance < HW_INSTANCES_SPI && (use_map & (1 << instance))) {
+        return &spi_controls[instance];
+    } else {
+        return NULL;
+    }
+}
+
+static inline void spi_select(int instance, int on)
+{
+    if (spi_controls[instance].config->select == DEVICE_OPT_SELECT_AUTO) {
+        if (on) {
+            gpio_clear(device_bank[instance] ? GPIOB : GPIOA, device_nss[instance]);
+        } else {
+            gpio_set(device_bank[instance] ? GPIOB : GPIOA, device_nss[instance]);
+        }
+    }
+}
+
+static int spi_gpio_setup(int instance, const hw_config_spi_t *config)
+{
+    int bank = device_bank[instance];
+
+    if (!hw_gpio_use_setup(bank, device_pins[instance], GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_ALTFN_PUSHPULL)) {
+        return -CUPKEE_ERESOURCE;
+    }
+    if (!hw_gpio_use_setup(bank, device_miso[instance], GPIO_MODE_INPUT, GPIO_CNF_INPUT_FLOAT)) {
+        hw_gpio_release(bank, device_pins[instance]);
+        return -CUPKEE_ERESOURCE;
+    }
+
+    if (config->select == DEVICE_OPT_SELECT_AUTO) {
+        if (!hw_gpio_use_setup(bank, device_nss[instance], GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_PUSHPULL)) {
+            hw_gpio_release(bank, device_pins[instance] | device_miso[instance]);
+            return -CUPKEE_ERESOURCE;
+        }
+        gpio_set(bank ? GPIOB : GPIOA, device_nss[instance]);
+    }
+
+    return CUPKEE_OK;
+}
+
+static void spi_gpio_reset(int instance, const hw_config_spi_t *config)
+{
+    uint16_t pins = device_pins[instance] | device_miso[instance];
+
+    if (config->select == DEVICE_OPT_SELECT_AUTO) {
+        pins |= device_nss[instance];
+    }
+    hw_gpio_release(device_bank[instance], pins);
+}
+
+static void spi_dma_isr(int instance)
+{
+    hw_spi_t *control = &spi_controls[instance];
+
+    // rx complete, tx must be done too
+    dma_clear_interrupt_flags(DMA1, dma_rx_chn[instance], DMA_TCIF);
+    dma_disable_channel(DMA1, dma_rx_chn[instance]);
+    dma_disable_channel(DMA1, dma_tx_chn[instance]);
+
+    control->xfer_done = 1;
+    cupkee_device_poll_request(control->dev_id);
+}
+
+static void spi_byte_isr(int instance)
+{
+    hw_spi_t *control = &spi_controls[instance];
+    uint32_t base = device_base[instance];
+    uint8_t pos = control->xfer_pos;
+
+    if (!(SPI_SR(base) & SPI_SR_RXNE)) {
+        return;
+    }
+
+    // one byte in flight, next go out after this one clocked in
+    control->xfer_rx[pos++] = SPI_DR(base);
+    control->xfer_pos = pos;
+    if (pos < control->xfer_len) {
+        SPI_DR(base) = control->xfer_tx ? control->xfer_tx[pos] : SPI_DUMMY;
+    } else {
+        spi_disable_rx_buffer_not_empty_interrupt(base);
+        control->xfer_done = 1;
+        cupkee_device_poll_request(control->dev_id);
+    }
+}
+
+void spi1_isr(void)
+{
+    spi_byte_isr(0);
+}
+
+void spi2_isr(void)
+{
+    spi_byte_isr(1);
+}
+
+static void spi_dma_setup(int instance)
+{
+    uint32_t base = device_base[instance];
+    uint8_t rx = dma_rx_chn[instance];
+    uint8_t tx = dma_tx_chn[instance];
+
+    dma_channel_reset(DMA1, rx);
+    dma_set_peripheral_address(DMA1, rx, (uint32_t) &SPI_DR(base));
+    dma_set_peripheral_size(DMA1, rx, DMA_CCR_PSIZE_8BIT);
+    dma_set_memory_size(DMA1, rx, DMA_CCR_MSIZE_8BIT);
+    dma_set_priority(DMA1, rx, DMA_CCR_PL_HIGH);
+    dma_set_read_from_peripheral(DMA1, rx);
+    dma_set_memory_address(DMA1, rx, (uint32_t) spi_controls[instance].xfer_rx);
+    dma_enable_memory_increment_mode(DMA1, rx);
+    dma_enable_transfer_complete_interrupt(DMA1, rx);
+
+    dma_channel_reset(DMA1, tx);
+    dma_set_peripheral_address(DMA1, tx, (uint32_t) &SPI_DR(base));
+    dma_set_peripheral_size(DMA1, tx, DMA_CCR_PSIZE_8BIT);
+    dma_set_memory_size(DMA1, tx, DMA_CCR_MSIZE_8BIT);
+    dma_set_priority(DMA1, tx, DMA_CCR_PL_MEDIUM);
+    dma_set_read_from_memory(DMA1, tx);
+
+    nvic_enable_irq(dma_rx_irq[instance]);
+
+    spi_enable_rx_dma(base);
+    spi_enable_tx_dma(base);
+}
+
+static void spi_xfer_start(int instance, hw_spi_t *control)
+{
+    uint8_t rx = dma_rx_chn[instance];
+    uint8_t tx = dma_tx_chn[instance];
+    const uint8_t *ptr;
+    int n;
+
+    if (!control->req_left) {
+        uint8_t head[SPI_REQ_HEAD];
+
+        if (SPI_REQ_HEAD != cupkee_buffer_take(control->tx_buff, SPI_REQ_HEAD, head)) {
+            // queue drained, end the selection
+            spi_select(instance, 0);
+            return;
+        }
+        control->req_type = head[0];
+        control->req_left = head[1];
+        spi_select(instance, 1);
+    }
+
+    n = control->req_left > SPI_XFER_MAX ? SPI_XFER_MAX : control->req_left;
+    ptr = NULL;
+    if (control->req_type == SPI_REQ_WRITE) {
+        // from tx buffer memory directly, to the end of the segment
+        int seg = cupkee_buffer_segment(control->tx_buff, 0, &ptr);
+
+        if (n > seg) {
+            n = seg;
+        }
+    }
+    control->xfer_len = n;
+
+    if (!control->dma) {
+        control->xfer_pos = 0;
+        control->xfer_tx = ptr;
+        spi_enable_rx_buffer_not_empty_interrupt(device_base[instance]);
+        SPI_DR(device_base[instance]) = ptr ? ptr[0] : SPI_DUMMY;
+        return;
+    }
+
+    if (ptr) {
+        dma_set_memory_address(DMA1, tx, (uint32_t) ptr);
+        dma_enable_memory_increment_mode(DMA1, tx);
+    } else {
+        dma_set_memory_address(DMA1, tx, (uint32_t) &spi_dummy);
+        dma_disable_memory_increment_mode(DMA1, tx);
+    }
+
+    // every byte out clock one in, rx first to not miss any
+    dma_set_number_of_data(DMA1, rx, n);
+    dma_set_number_of_data(DMA1, tx, n);
+    dma_enable_channel(DMA1, rx);
+    dma_enable_channel(DMA1, tx);
+}
+
+static void spi_xfer_done(hw_spi_t *control)
+{
+    int keep = control->req_type == SPI_REQ_READ || control->config->dir == DEVICE_OPT_DIR_DUAL;
+    int n = control->xfer_len;
+
+    control->xfer_done = 0;
+    control->xfer_len = 0;
+    control->req_left -= n;
+
+    if (control->req_type == SPI_REQ_WRITE) {
+        cupkee_buffer_skip(control->tx_buff, n);
+    } else {
+        control->rd_pend -= n;
+    }
+
+    if (keep) {
+        if (cupkee_buffer_give(control->rx_buff, n, control->xfer_rx) < n) {
+            cupkee_event_post_device_error(control->dev_id);
+        }
+        cupkee_event_post_device_data(control->dev_id);
+    }
+
+    if (!control->req_left && control->req_type == SPI_REQ_WRITE &&
+        cupkee_buffer_is_empty(control->tx_buff)) {
+        cupkee_event_post_device_drain(control->dev_id);
+    }
+}
+
+static void hw_spi_poll(int instance)
+{
+    hw_spi_t *control = hw_spi_control(instance);
+
+    if (!control || !control->config) {
+        return;
+    }
+
+    if (control->xfer_done) {
+        spi_xfer_done(control);
+    }
+
+    if (!control->xfer_len) {
+        spi_xfer_start(instance, control);
+    }
+}
+
+static void hw_spi_reset(int instance)
+{
+    hw_spi_t *control = hw_spi_control(instance);
+    uint32_t base = device_base[instance];
+
+    if (!control || !control->config) {
+        return;
+    }
+
+    if (control->dma) {
+        nvic_disable_irq(dma_rx_irq[instance]);
+        dma_channel_reset(DMA1, dma_rx_chn[instance]);
+        dma_channel_reset(DMA1, dma_tx_chn[instance]);
+    } else {
+        spi_disable_rx_buffer_not_empty_interrupt(base);
+        nvic_disable_irq(device_irq[instance]);
+    }
+
+    spi_disable(base);
+    spi_disable_rx_dma(base);
+    spi_disable_tx_dma(base);
+    rcc_periph_clock_disable(device_rcc[instance]);
+
+    spi_gpio_reset(instance, control->config);
+
+    cupkee_buffer_reset(control->rx_buff);
+    cupkee_buffer_reset(control->tx_buff);
+
+    control->dev_id = DEVICE_ID_INVALID;
+    control->config = NULL;
+}
+
+static void hw_spi_release(int instance)
+{
+    hw_spi_t *control = hw_spi_control(instance);
+
+    if (!control) {
+        return;
+    }
+
+    hw_spi_reset(instance);
+
+    if (control->dma) {
+        hw_dma_release(dma_rx_chn[instance]);
+        hw_dma_release(dma_tx_chn[instance]);
+    }
+
+    cupkee_buffer_release(control->rx_buff);
+    cupkee_buffer_release(control->tx_buff);
+
+    hw_release_instance(instance, &use_map);
+}
+
+static int hw_spi_setup(int instance, uint8_t dev_id, const hw_config_t *conf)
+{
+    hw_spi_t *control = hw_spi_control(instance);
+    const hw_config_spi_t *config = (const hw_config_spi_t *) conf;
+    uint32_t base = device_base[instance];
+    uint32_t pclk, cpol, cpha;
+    int br, err;
+
+    if (!control) {
+        return -CUPKEE_EINVAL;
+    }
+
+    if (!config->speed || config->mode > 3 ||
+        config->dir >= DEVICE_OPT_DIR_MAX || config->select >= DEVICE_OPT_SELECT_MAX) {
+        return -CUPKEE_EINVAL;
+    }
+
+    if ((err = spi_gpio_setup(instance, config)) != CUPKEE_OK) {
+        return err;
+    }
+
+    // SPI1 on APB2, SPI2 on APB1; fastest divider not over the speed
+    pclk = instance == 0 ? SYS_PCLK * 2 : SYS_PCLK;
+    for (br = 0; br < 7 && (pclk >> (br + 1)) > config->speed; br++)
+        ;
+    cpol = config->mode & 2 ? SPI_CR1_CPOL_CLK_TO_1_WHEN_IDLE : SPI_CR1_CPOL_CLK_TO_0_WHEN_IDLE;
+    cpha = config->mode & 1 ? SPI_CR1_CPHA_CLK_TRANSITION_2 : SPI_CR1_CPHA_CLK_TRANSITION_1;
+
+    rcc_periph_clock_enable(device_rcc[instance]);
+    spi_reset(base);
+    spi_init_master(base, br << 3, cpol, cpha, SPI_CR1_DFF_8BIT,
+                    config->lsb ? SPI_CR1_LSBFIRST : SPI_CR1_MSBFIRST);
+    spi_enable_software_slave_management(base);
+    spi_set_nss_high(base);
+
+    control->dev_id = dev_id;
+    control->config = config;
+    control->req_left = 0;
+    control->xfer_len = 0;
+    control->xfer_done = 0;
+    control->rd_pend = 0;
+
+    if (control->dma) {
+        spi_dma_setup(instance);
+    } else {
+        nvic_enable_irq(device_irq[instance]);
+    }
+    spi_enable(base);
+
+    return CUPKEE_OK;
+}
+
+static int spi_request(hw_spi_t *control, uint8_t type, size_t n, const uint8_t *data)
+{
+    size_t cnt = 0;
+
+    while (cnt < n) {
+        size_t space = cupkee_buffer_space(control->tx_buff);
+        uint8_t head[SPI_REQ_HEAD];
+        size_t len;
+
+        if (space < SPI_REQ_HEAD + (type == SPI_REQ_WRITE)) {
+            break;
+        }
+
+        len = n - cnt;
+        if (len > UINT8_MAX) {
+            len = UINT8_MAX;
+        }
+        if (type == SPI_REQ_WRITE && len > space - SPI_REQ_HEAD) {
+            len = space - SPI_REQ_HEAD;
+        }
+
+        head[0] = type;
+        head[1] = len;
+        cupkee_buffer_give(control->tx_buff, SPI_REQ_HEAD, head);
+        if (type == SPI_REQ_WRITE) {
+            cupkee_buffer_give(control->tx_buff, len, data + cnt);
+        }
+        cnt += len;
+    }
+
+    if (cnt && !control->xfer_len) {
+        cupkee_device_poll_request(control->dev_id);
+    }
+
+    return cnt;
+}
+
+static int hw_spi_read_req(int instance, size_t n)
+{
+    hw_spi_t *control = hw_spi_control(instance);
+
+    if (!control || !control->config || !n) {
+        return -CUPKEE_EINVAL;
+    }
+
+    // queued as a whole, and clocked in data must have room when it come
+    if (cupkee_buffer_space(control->tx_buff) < SPI_REQ_HEAD * ((n + UINT8_MAX - 1) / UINT8_MAX) ||
+        cupkee_buffer_space(control->rx_buff) < control->rd_pend + n) {
+        return -CUPKEE_EFULL;
+    }
+
+    spi_request(control, SPI_REQ_READ, n, NULL);
+    control->rd_pend += n;
+
+    return 0;
+}
+
+static int hw_spi_read(int instance, size_t n, void *buf)
+{
+    hw_spi_t *control = hw_spi_control(instance);
+
+    if (!control) {
+        return -CUPKEE_EINVAL;
+    }
+
+    return cupkee_buffer_take(control->rx_buff, n, buf);
+}
+
+static int hw_spi_write(int instance, size_t n, const void *data)
+{
+    hw_spi_t *control = hw_spi_control(instance);
+
+    if (!control || !control->config) {
+        return -CUPKEE_EINVAL;
+    }
+
+    return spi_request(control, SPI_REQ_WRITE, n, data);
+}
+
+static int hw_spi_io_cached(int instance, size_t *in, size_t *out)
+{
+    hw_spi_t *control = hw_spi_control(instance);
+
+    if (!control) {
+        return -CUPKEE_EINVAL;
+    }
+
+    if (in) {
+        *in = cupkee_buffer_length(control->rx_buff);
+    }
+    if (out) {
+        *out = cupkee_buffer_length(control->tx_buff);
+    }
+    return 0;
+}
+
+static const hw_driver_t spi_driver = {
+    .release = hw_spi_release,
+    .reset   = hw_spi_reset,
+    .setup   = hw_spi_setup,
+    .poll    = hw_spi_poll,
+
+    .read_req = hw_spi_read_req,
+    .read    = hw_spi_read,
+    .write   = hw_spi_write,
+    .io_cached = hw_spi_io_cached,
+
+    .flags   = HW_DRIVER_FL_POLL_REQ
+};
+
+const hw_driver_t *hw_request_spi(int instance)
+{
+    hw_spi_t *control;
+
+    if (instance >= HW_INSTANCES_SPI || 0 == hw_use_instance(instance, &use_map)) {
+        return NULL;
+    }
+    control = &spi_controls[instance];
+
+    control->rx_buff = cupkee_buffer_alloc(SPI_RX_BUF_SIZE);
+    control->tx_buff = cupkee_buffer_alloc(SPI_TX_BUF_SIZE);
+    if (!control->rx_buff || !control->tx_buff) {
+        if (control->rx_buff) {
+            cupkee_buffer_release(control->rx_buff);
+        }
+        if (control->tx_buff) {
+            cupkee_buffer_release(control->tx_buff);
+        }
+        goto DO_FAIL;
+    }
+
+    control->dev_id = DEVICE_ID_INVALID;
+    control->config = NULL;
+    control->dma = 0;
+
+    // both channels, rx & tx finish together. They are shared with
+    // USART3 & USART1, taken by it already: fall back to byte interrupt
+    if (!hw_dma_request(dma_rx_chn[instance], spi_dma_isr, instance)) {
+        if (!hw_dma_request(dma_tx_chn[instance], spi_dma_isr, instance)) {
+            control->dma = 1;
+        } else {
+            hw_dma_release(dma_rx_chn[instance]);
+        }
+    }
+
+    return &spi_driver;
+
+DO_FAIL:
+    hw_release_instance(instance, &use_map);
+    return NULL;
+}
+
+void hw_setup_spi(void)
+{
+    use_map = 0;
+
+    memset(&spi_controls, 0, sizeof(spi_controls));
+}
+
@@ -44,6 +44,15 @@ typedef struct hw_timer_t {
     int32_t duration[4]; // 4 CCR
     int32_t data[4];
     const hw_config_timer_t *config;
+
+    // capture ring, write in isr, read in loop
+    uint8_t cap_size;
+    uint8_t cap_tail;
+    uint8_t cap_post;   // head when last event post
+    volatile uint8_t cap_head;
+    volatile uint8_t cap_lost;
+    uint32_t seconds;
+    hw_capture_t *cap_ring;
 } hw_timer_t;
 
 typedef struct hw_counter_t {
@@ -74,6 +83,38 @@ static hw_pulse_t *pulse_controls       = (hw_pulse_t *)   device_controls;
 static hw_timer_t *timer_controls       = (hw_timer_t *)   device_controls;
 static hw_counter_t *counter_controls   = (hw_counter_t *) device_controls;
 
+// pair 0: CC1 & CC2, pair 1: CC3 & CC4
+static inline uint8_t timer_pair_index(hw_timer_t *control, int pair) {
+    if (control->config->chn_num > 1 && (pair ? control->high_tail : !control->high_tail)) {
+        return 1;
+    }
+    return 0;
+}
+
+static void timer_capture_push(hw_timer_t *control, int pair, int level, int32_t width, uint32_t cnt)
+{
+    uint8_t polarity = control->config->polarity;
+    uint8_t head = control->cap_head;
+    uint8_t next = head + 1 < control->cap_size ? head + 1 : 0;
+    hw_capture_t *rec;
+
+    if (polarity == (level ? DEVICE_OPT_POLARITY_NEGATIVE : DEVICE_OPT_POLARITY_POSITIVE)) {
+        return;
+    }
+
+    if (next == control->cap_tail) {
+        control->cap_lost++;
+        return;
+    }
+
+    rec = &control->cap_ring[head];
+    rec->stamp = (control->seconds * 50000 + cnt) * 20;
+    rec->width = width * 20;
+    rec->chn   = timer_pair_index(control, pair);
+    rec->level = level;
+    control->cap_head = next;
+}
+
 static void device_timer_isr(int instance, uint32_t base)
 {
     uint32_t status = TIM_SR(base);
@@ -81,6 +122,7 @@ static void device_timer_isr(int instance, uint32_t base)
 
     TIM_SR(base) = 0;
     if (status & TIM_SR_UIF) {
+        control->seconds++;
         control->duration[0] += 50000; // add 1 second
         control->duration[1] += 50000; // add 1 second
         control->duration[2] += 50000; // add 1 second
@@ -95,7 +137,11 @@ static void device_timer_isr(int instance, uint32_t base)
         uint32_t cnt = TIM_CCR1(base);
 
         control->data[0] = control->duration[0] + cnt;
-        control->update |= 1;
+        if (control->cap_ring) {
+            timer_capture_push(control, 0, 0, control->data[0], cnt);
+        } else {
+            control->update |= 1;
+        }
 
         control->duration[1] = -cnt;
     } else
@@ -103,7 +149,11 @@ static void device_timer_isr(int instance, uint32_t base)
         uint32_t cnt = TIM_CCR2(base);
 
         control->data[1] = control->duration[1] + cnt;
-        control->update |= 2;
+        if (control->cap_ring) {
+            timer_capture_push(control, 0, 1, control->data[1], cnt);
+        } else {
+            control->update |= 2;
+        }
 
         control->duration[0] = -cnt;
     }
@@ -112,7 +162,11 @@ static void device_timer_isr(int instance, uint32_t base)
         uint32_t cnt = TIM_CCR3(base);
 
         control->data[2] = control->duration[2] + cnt;
-        control->update |= 4;
+        if (control->cap_ring) {
+            timer_capture_push(control, 1, 0, control->data[2], cnt);
+        } else {
+            control->update |= 4;
+        }
 
         control->duration[3] = -cnt;
     } else
@@ -120,10 +174,18 @@ static void device_timer_isr(int instance, uint32_t base)
         uint32_t cnt = TIM_CCR4(base);
 
         control->data[3] = control->duration[3] + cnt;
-        control->update |= 8;
+        if (control->cap_ring) {
+            timer_capture_push(control, 1, 1, control->data[3], cnt);
+        } else {
+            control->update |= 8;
+        }
 
         control->duration[2] = -cnt;
     }
+
+    if (control->update || control->cap_head != control->cap_post || control->cap_lost) {
+        cupkee_device_poll_request(control->dev_id);
+    }
 }
 
 static void device_count_isr(int instance, uint32_t base)
@@ -172,6 +234,10 @@ static void device_count_isr(int instance, uint32_t base)
             control->update |= 8;
         }
     }
+
+    if (control->update) {
+        cupkee_device_poll_request(control->dev_id);
+    }
 }
 
 void tim2_isr(void)
@@ -728,6 +794,11 @@ static void hw_timer_reset(int instance)
         device_reset(instance, channel);
     }
 
+    if (control->cap_ring) {
+        cupkee_free(control->cap_ring);
+        control->cap_ring = NULL;
+    }
+
     control->dev_id = DEVICE_ID_INVALID;
     control->config = NULL;
 }
@@ -752,14 +823,39 @@ static int timer_setup(int instance, uint8_t dev_id, const hw_config_t *conf)
         control->high_tail = 0;
     }
 
+    control->cap_ring = NULL;
+    control->cap_head = 0;
+    control->cap_tail = 0;
+    control->cap_post = 0;
+    control->cap_lost = 0;
+    control->seconds = 0;
+
     /* hardware setup here */
     err = device_channel_convert_timer(&channel, config->chn_num, config->chn_seq);
     if (err) {
         goto DO_END;
     }
 
+    if (config->depth) {
+        if (config->depth > HW_CAPTURE_DEPTH_MAX) {
+            err = -CUPKEE_EINVAL;
+            goto DO_END;
+        }
+        // one slot keep empty
+        control->cap_size = config->depth + 1;
+        control->cap_ring = cupkee_malloc(control->cap_size * sizeof(hw_capture_t));
+        if (!control->cap_ring) {
+            err = -CUPKEE_ENOMEM;
+            goto DO_END;
+        }
+    }
+
     base = device_channel_setup(instance, channel, GPIO_MODE_INPUT, GPIO_CNF_INPUT_FLOAT);
     if (!base) {
+        if (control->cap_ring) {
+            cupkee_free(control->cap_ring);
+            control->cap_ring = NULL;
+        }
         err = -CUPKEE_ERESOURCE;
         goto DO_END;
     }
@@ -773,10 +869,32 @@ DO_END:
     return err;
 }
 
+static void timer_capture_poll(hw_timer_t *control)
+{
+    if (control->cap_lost) {
+        uint32_t state;
+
+        hw_enter_critical(&state);
+        control->cap_lost = 0;
+        hw_exit_critical(state);
+
+        cupkee_event_post_device_error(control->dev_id);
+    }
+
+    // one event for all captures arrived since last one
+    if (control->cap_head != control->cap_post) {
+        control->cap_post = control->cap_head;
+        cupkee_event_post_device_data(control->dev_id);
+    }
+}
+
 static void timer_poll(int instance)
 {
     hw_timer_t *control = &timer_controls[instance];
 
+    if (control->cap_ring) {
+        timer_capture_poll(control);
+    } else
     if (control->update) {
         const hw_config_timer_t *config = control->config;
         uint8_t update = control->update;
@@ -825,6 +943,11 @@ static void timer_poll(int instance)
                 cupkee_event_post_device_data(control->dev_id);
             }
         }
+
+        // channel 3,4 update left
+        if (control->update) {
+            cupkee_device_poll_request(control->dev_id);
+        }
     }
 }
 
@@ -853,6 +976,53 @@ static int timer_size(int instance)
     return control->config->chn_num;
 }
 
+static int timer_read(int instance, size_t n, void *buf)
+{
+    hw_timer_t *control = &timer_controls[instance];
+    hw_capture_t *rec = buf;
+    uint8_t head = control->cap_head;
+    uint8_t tail = control->cap_tail;
+    int cnt = 0;
+
+    if (!control->cap_ring) {
+        return -CUPKEE_EIMPLEMENT;
+    }
+
+    // whole records only
+    while (tail != head && n >= sizeof(hw_capture_t)) {
+        memcpy(rec++, &control->cap_ring[tail], sizeof(hw_capture_t));
+        tail = tail + 1 < control->cap_size ? tail + 1 : 0;
+        n -= sizeof(hw_capture_t);
+        cnt += sizeof(hw_capture_t);
+    }
+    control->cap_tail = tail;
+
+    return cnt;
+}
+
+static int timer_io_cached(int instance, size_t *in, size_t *out)
+{
+    hw_timer_t *control = &timer_controls[instance];
+    int num;
+
+    if (!control->cap_ring) {
+        return -CUPKEE_EIMPLEMENT;
+    }
+
+    num = control->cap_head - control->cap_tail;
+    if (num < 0) {
+        num += control->cap_size;
+    }
+
+    if (in) {
+        *in = num * sizeof(hw_capture_t);
+    }
+    if (out) {
+        *out = 0;
+    }
+    return 0;
+}
+
 static void counter_reset(int instance)
 {
     hw_counter_t *control = &counter_controls[instance];
@@ -916,6 +1086,10 @@ static void counter_poll(int instance)
                 break;
             }
         }
+
+        if (control->update) {
+            cupkee_device_poll_request(control->dev_id);
+        }
     }
 }
 
@@ -969,7 +1143,12 @@ static const hw_driver_t timer_driver = {
     .poll    = timer_poll,
 
     .get  = timer_get,
-    .size = timer_size
+    .size = timer_size,
+
+    .read = timer_read,
+    .io_cached = timer_io_cached,
+
+    .flags = HW_DRIVER_FL_POLL_REQ
 };
 
 static const hw_driver_t counter_driver = {
@@ -979,7 +1158,9 @@ static const hw_driver_t counter_driver = {
     .poll    = counter_poll,
 
     .get  = counter_get,
-    .size = counter_size
+    .size = counter_size,
+
+    .flags = HW_DRIVER_FL_POLL_REQ
 };
 
 const hw_driver_t *hw_request_pwm(int instance)
@@ -1015,6 +1196,7 @@ const hw_driver_t *hw_request_timer(int instance)
     device_type[instance] = 1;
     timer_controls[instance].dev_id = DEVICE_ID_INVALID;
     timer_controls[instance].config = NULL;
+    timer_controls[instance].cap_ring = NULL;
 
     return &timer_driver;
 }
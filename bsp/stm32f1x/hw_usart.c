@@ -27,15 +27,31 @@ SOFTWARE.
 #include "hardware.h"
 
 #define HW_FL_USED              1
+#define HW_FL_DMA               2
 #define USART_TOUT_THRESHOLD    20
+#define USART_BUF_SIZE          128
+
+// events from isr, posted in poll
+#define UART_EV_DATA            1
+#define UART_EV_DRAIN           2
+#define UART_EV_ERROR           4
+
+// USART1 - USART3 work with DMA1, UART4 & UART5 (or channels taken) by byte interrupt
+#define USART_DMA_INSTANCES     3
+#define USART_DMA_RX_SIZE       64
+#define USART_DMA_RX_HALF       (USART_DMA_RX_SIZE / 2)
 
 typedef struct hw_uart_t {
     uint8_t flags;
     uint8_t dev_id;
-    uint8_t reserved[2];
+    uint8_t rx_pos;             // dma ring position consumed
+    uint8_t rx_seen;            // ring halves consumed
+    volatile uint8_t rx_halves; // ring halves filled, counted in dma isr
+    volatile uint8_t tx_done;   // set in dma isr
+    volatile uint8_t events;    // UART_EV_*, set in byte isr
+    uint16_t tx_len;            // bytes in dma transfer
     void   *rx_buff;
     void   *tx_buff;
-    uint32_t last_tick;
     const hw_config_uart_t *config;
 } hw_uart_t;
 
@@ -46,6 +62,18 @@ static const uint32_t device_base[] = {
 static const uint32_t device_rcc[] = {
     RCC_USART1, RCC_USART2, RCC_USART3, RCC_UART4, RCC_UART5
 };
+static const uint8_t device_irq[] = {
+    NVIC_USART1_IRQ, NVIC_USART2_IRQ, NVIC_USART3_IRQ, NVIC_UART4_IRQ, NVIC_UART5_IRQ
+};
+static const uint8_t dma_rx_chn[] = {DMA_CHANNEL5, DMA_CHANNEL6, DMA_CHANNEL3};
+static const uint8_t dma_tx_chn[] = {DMA_CHANNEL4, DMA_CHANNEL7, DMA_CHANNEL2};
+static const uint8_t dma_rx_irq[] = {
+    NVIC_DMA1_CHANNEL5_IRQ, NVIC_DMA1_CHANNEL6_IRQ, NVIC_DMA1_CHANNEL3_IRQ
+};
+static const uint8_t dma_tx_irq[] = {
+    NVIC_DMA1_CHANNEL4_IRQ, NVIC_DMA1_CHANNEL7_IRQ, NVIC_DMA1_CHANNEL2_IRQ
+};
+static uint8_t dma_rx_ring[USART_DMA_INSTANCES][USART_DMA_RX_SIZE];
 
 static int uart_gpio_setup(int instance)
 {
@@ -106,27 +134,220 @@ static inline hw_uart_t *uart_get(int instance) {
     return &uart_controls[instance];
 }
 
-static inline int uart_has_data(int instance) {
-    return USART_SR(device_base[instance]) & USART_SR_RXNE;
-}
-
 static inline int uart_not_busy(int instance) {
     return USART_SR(device_base[instance]) & USART_SR_TXE;
 }
 
-static inline uint8_t uart_data_get(int instance) {
-    return USART_DR(device_base[instance]);
-}
-
 static inline void uart_data_put(int instance, uint8_t data) {
     USART_DR(device_base[instance]) = data;
 }
 
+static void uart_byte_isr(int instance)
+{
+    hw_uart_t *control = uart_get(instance);
+    uint32_t base = device_base[instance];
+    uint32_t sr = USART_SR(base);
+    uint8_t events = 0;
+
+    // read DR clear RXNE, IDLE & ORE together
+    if (sr & USART_SR_RXNE) {
+        if (!cupkee_buffer_push(control->rx_buff, USART_DR(base))) {
+            events |= UART_EV_ERROR;
+        } else
+        if (cupkee_buffer_length(control->rx_buff) == USART_BUF_SIZE / 2) {
+            events |= UART_EV_DATA;
+        }
+    } else
+    if (sr & (USART_SR_IDLE | USART_SR_ORE)) {
+        (void) USART_DR(base);
+    }
+
+    if (sr & USART_SR_ORE) {
+        events |= UART_EV_ERROR;
+    }
+    if ((sr & USART_SR_IDLE) && !cupkee_buffer_is_empty(control->rx_buff)) {
+        events |= UART_EV_DATA;
+    }
+
+    if ((sr & USART_SR_TXE) && (USART_CR1(base) & USART_CR1_TXEIE)) {
+        uint8_t d;
+
+        if (cupkee_buffer_shift(control->tx_buff, &d)) {
+            USART_DR(base) = d;
+        } else {
+            USART_CR1(base) &= ~USART_CR1_TXEIE;
+            events |= UART_EV_DRAIN;
+        }
+    }
+
+    if (events) {
+        control->events |= events;
+        cupkee_device_poll_request(control->dev_id);
+    }
+}
+
+static void uart_line_isr(int instance)
+{
+    uint32_t base = device_base[instance];
+
+    // read SR then DR to clear IDLE
+    if (USART_SR(base) & USART_SR_IDLE) {
+        (void) USART_DR(base);
+        cupkee_device_poll_request(uart_get(instance)->dev_id);
+    }
+}
+
+static void uart_dma_rx_isr(int instance)
+{
+    hw_uart_t *control = uart_get(instance);
+    uint8_t chn = dma_rx_chn[instance];
+
+    if (dma_get_interrupt_flag(DMA1, chn, DMA_HTIF)) {
+        control->rx_halves++;
+    }
+    if (dma_get_interrupt_flag(DMA1, chn, DMA_TCIF)) {
+        control->rx_halves++;
+    }
+    dma_clear_interrupt_flags(DMA1, chn, DMA_HTIF | DMA_TCIF);
+    cupkee_device_poll_request(control->dev_id);
+}
+
+static void uart_dma_tx_isr(int instance)
+{
+    hw_uart_t *control = uart_get(instance);
+
+    dma_clear_interrupt_flags(DMA1, dma_tx_chn[instance], DMA_TCIF);
+    dma_disable_channel(DMA1, dma_tx_chn[instance]);
+
+    control->tx_done = 1;
+    cupkee_device_poll_request(control->dev_id);
+}
+
+static void uart_isr(int instance)
+{
+    if (uart_get(instance)->flags & HW_FL_DMA) {
+        uart_line_isr(instance);
+    } else {
+        uart_byte_isr(instance);
+    }
+}
+
+void usart1_isr(void)
+{
+    uart_isr(0);
+}
+
+void usart2_isr(void)
+{
+    uart_isr(1);
+}
+
+void usart3_isr(void)
+{
+    uart_isr(2);
+}
+
+void uart4_isr(void)
+{
+    uart_byte_isr(3);
+}
+
+void uart5_isr(void)
+{
+    uart_byte_isr(4);
+}
+
+static void uart_dma_channel_setup(uint8_t chn, uint32_t base)
+{
+    dma_channel_reset(DMA1, chn);
+    dma_set_peripheral_address(DMA1, chn, (uint32_t) &USART_DR(base));
+    dma_set_peripheral_size(DMA1, chn, DMA_CCR_PSIZE_8BIT);
+    dma_set_memory_size(DMA1, chn, DMA_CCR_MSIZE_8BIT);
+    dma_enable_memory_increment_mode(DMA1, chn);
+    dma_enable_transfer_complete_interrupt(DMA1, chn);
+}
+
+static void uart_dma_setup(int instance)
+{
+    hw_uart_t *control = uart_get(instance);
+    uint32_t base = device_base[instance];
+    uint8_t rx = dma_rx_chn[instance];
+    uint8_t tx = dma_tx_chn[instance];
+
+    rcc_periph_clock_enable(RCC_DMA1);
+
+    // rx: circular ring never stop, half, full & line idle kick poll
+    uart_dma_channel_setup(rx, base);
+    dma_set_read_from_peripheral(DMA1, rx);
+    dma_set_memory_address(DMA1, rx, (uint32_t) dma_rx_ring[instance]);
+    dma_set_number_of_data(DMA1, rx, USART_DMA_RX_SIZE);
+    dma_enable_circular_mode(DMA1, rx);
+    dma_enable_half_transfer_interrupt(DMA1, rx);
+    dma_enable_channel(DMA1, rx);
+
+    // tx: started by poll, from tx buffer memory directly
+    uart_dma_channel_setup(tx, base);
+    dma_set_read_from_memory(DMA1, tx);
+
+    control->rx_pos = 0;
+    control->rx_seen = 0;
+    control->rx_halves = 0;
+    control->tx_len = 0;
+    control->tx_done = 0;
+
+    nvic_enable_irq(dma_rx_irq[instance]);
+    nvic_enable_irq(dma_tx_irq[instance]);
+    nvic_enable_irq(device_irq[instance]);
+
+    usart_enable_rx_dma(base);
+    usart_enable_tx_dma(base);
+    USART_CR1(base) |= USART_CR1_IDLEIE;
+}
+
+static void uart_dma_stop(int instance)
+{
+    uint32_t base = device_base[instance];
+
+    USART_CR1(base) &= ~USART_CR1_IDLEIE;
+    usart_disable_rx_dma(base);
+    usart_disable_tx_dma(base);
+
+    nvic_disable_irq(device_irq[instance]);
+    nvic_disable_irq(dma_rx_irq[instance]);
+    nvic_disable_irq(dma_tx_irq[instance]);
+
+    dma_channel_reset(DMA1, dma_rx_chn[instance]);
+    dma_channel_reset(DMA1, dma_tx_chn[instance]);
+}
+
+static void uart_byte_setup(int instance)
+{
+    hw_uart_t *control = uart_get(instance);
+
+    control->events = 0;
+
+    nvic_enable_irq(device_irq[instance]);
+    USART_CR1(device_base[instance]) |= USART_CR1_RXNEIE | USART_CR1_IDLEIE;
+}
+
+static void uart_byte_stop(int instance)
+{
+    USART_CR1(device_base[instance]) &= ~(USART_CR1_RXNEIE | USART_CR1_IDLEIE | USART_CR1_TXEIE);
+    nvic_disable_irq(device_irq[instance]);
+}
+
 static void uart_reset(int instance)
 {
     hw_uart_t *control = uart_get(instance);
 
     /* Do hardware reset here */
+    if (control->config) {
+        if (control->flags & HW_FL_DMA) {
+            uart_dma_stop(instance);
+        } else {
+            uart_byte_stop(instance);
+        }
+    }
 
     control->dev_id = DEVICE_ID_INVALID;
     control->config = NULL;
@@ -138,6 +359,11 @@ static void uart_release(int instance)
 
     uart_reset(instance);
 
+    if (control->flags & HW_FL_DMA) {
+        hw_dma_release(dma_rx_chn[instance]);
+        hw_dma_release(dma_tx_chn[instance]);
+    }
+
     cupkee_buffer_release(control->rx_buff);
     cupkee_buffer_release(control->tx_buff);
 
@@ -190,6 +416,12 @@ static int uart_setup(int instance, uint8_t dev_id, const hw_config_t *conf)
     control->dev_id = dev_id;
     control->config = config;
 
+    if (control->flags & HW_FL_DMA) {
+        uart_dma_setup(instance);
+    } else {
+        uart_byte_setup(instance);
+    }
+
 DO_END:
     return -err;
 }
@@ -197,56 +429,145 @@ DO_END:
 static void uart_poll(int instance)
 {
     hw_uart_t *control = uart_get(instance);
+    uint32_t state;
+    uint8_t events;
 
-    if (uart_has_data(instance)) {
-        do {
-            if (cupkee_buffer_push(control->rx_buff, uart_data_get(instance)) == 0) {
-                //device_error_post(control->dev_id, CUPKEE_EOVERFLOW);
-                cupkee_event_post_device_error(control->dev_id);
-                break;
-            }
-            control->last_tick = _cupkee_systicks;
-        } while (uart_has_data(instance));
+    hw_enter_critical(&state);
+    events = control->events;
+    control->events = 0;
+    hw_exit_critical(state);
 
-        if (cupkee_buffer_is_full(control->rx_buff)) {
-            cupkee_event_post_device_data(control->dev_id);
-        }
-    } else {
-        if (!cupkee_buffer_is_empty(control->rx_buff)) {
-            if (_cupkee_systicks - control->last_tick > 10) {
-                cupkee_event_post_device_data(control->dev_id);
-            }
+    if (events & UART_EV_ERROR) {
+        cupkee_event_post_device_error(control->dev_id);
+    }
+    if (events & UART_EV_DATA) {
+        cupkee_event_post_device_data(control->dev_id);
+    }
+    if (events & UART_EV_DRAIN) {
+        cupkee_event_post_device_drain(control->dev_id);
+    }
+}
+
+static void uart_dma_rx(int instance)
+{
+    hw_uart_t *control = uart_get(instance);
+    // halves read before position: it may lag one isr behind, never ahead
+    uint8_t halves = control->rx_halves;
+    int pos = USART_DMA_RX_SIZE - DMA_CNDTR(DMA1, dma_rx_chn[instance]);
+    int n, lap;
+    uint8_t seen;
+
+    if (pos >= USART_DMA_RX_SIZE) {
+        pos = 0;
+    }
+
+    n = pos - control->rx_pos;
+    if (n < 0) {
+        n += USART_DMA_RX_SIZE;
+    }
+    seen = control->rx_seen + (control->rx_pos % USART_DMA_RX_HALF + n) / USART_DMA_RX_HALF;
+
+    lap = (int8_t)(halves - seen);
+    if (lap > 0) {
+        // dma run over unread bytes a whole ring or more, drop them all
+        control->rx_pos = pos;
+        control->rx_seen = seen + ((lap + 1) & ~1);
+        cupkee_event_post_device_error(control->dev_id);
+        return;
+    }
+    if (!n) {
+        return;
+    }
+
+    if (cupkee_buffer_give_ring(control->rx_buff, USART_DMA_RX_SIZE, dma_rx_ring[instance],
+                                control->rx_pos, pos) < n) {
+        cupkee_event_post_device_error(control->dev_id);
+    }
+    control->rx_pos = pos;
+    control->rx_seen = seen;
+
+    cupkee_event_post_device_data(control->dev_id);
+}
+
+static void uart_dma_tx(int instance)
+{
+    hw_uart_t *control = uart_get(instance);
+    uint8_t tx = dma_tx_chn[instance];
+    const uint8_t *ptr;
+    int n;
+
+    if (control->tx_done) {
+        control->tx_done = 0;
+        cupkee_buffer_skip(control->tx_buff, control->tx_len);
+        control->tx_len = 0;
+
+        if (cupkee_buffer_is_empty(control->tx_buff)) {
+            cupkee_event_post_device_drain(control->dev_id);
         }
     }
 
-    if (uart_not_busy(instance) && !cupkee_buffer_is_empty(control->tx_buff)) {
-        do {
-            uint8_t d;
-            if (cupkee_buffer_shift(control->tx_buff, &d)) {
-                uart_data_put(instance, d);
-            } else {
-                cupkee_event_post_device_drain(control->dev_id);
-                break;
-            }
-        } while(uart_not_busy(instance));
+    if (control->tx_len) {
+        return;
+    }
+
+    // data keep in tx buffer until transfer done, only new data append to it
+    n = cupkee_buffer_segment(control->tx_buff, 0, &ptr);
+    if (n > 0) {
+        control->tx_len = n;
+        dma_set_memory_address(DMA1, tx, (uint32_t) ptr);
+        dma_set_number_of_data(DMA1, tx, n);
+        dma_enable_channel(DMA1, tx);
     }
 }
 
+static void uart_dma_poll(int instance)
+{
+    uart_dma_rx(instance);
+    uart_dma_tx(instance);
+}
+
+// buffers shared with byte isr
 static int uart_recv(int instance, size_t n, void *buf)
 {
     hw_uart_t *control = uart_get(instance);
+    uint32_t state;
+    int cnt;
 
-    return cupkee_buffer_take(control->rx_buff, n, buf);
+    hw_enter_critical(&state);
+    cnt = cupkee_buffer_take(control->rx_buff, n, buf);
+    hw_exit_critical(state);
+
+    return cnt;
 }
 
 static int uart_send(int instance, size_t n, const void *data)
 {
     hw_uart_t *control = uart_get(instance);
+    uint32_t state;
+    int cnt;
+
+    hw_enter_critical(&state);
+    cnt = cupkee_buffer_give(control->tx_buff, n, data);
+    if (cnt > 0) {
+        USART_CR1(device_base[instance]) |= USART_CR1_TXEIE;
+    }
+    hw_exit_critical(state);
+
+    return cnt;
+}
+
+static int uart_dma_send(int instance, size_t n, const void *data)
+{
+    hw_uart_t *control = uart_get(instance);
+    int cnt = cupkee_buffer_give(control->tx_buff, n, data);
 
-    return cupkee_buffer_give(control->tx_buff, n, data);
+    if (cnt > 0 && !control->tx_len) {
+        cupkee_device_poll_request(control->dev_id);
+    }
+    return cnt;
 }
 
-static int uart_send_sync(int instance, size_t n, const void *data)
+static int uart_put_sync(int instance, size_t n, const void *data)
 {
     const uint8_t *ptr = data;
     size_t i = 0;
@@ -260,22 +581,115 @@ static int uart_send_sync(int instance, size_t n, const void *data)
     return i;
 }
 
+static int uart_buffer_givev(void *buf, int cnt, const hw_iovec_t *iov)
+{
+    int i, n, total = 0;
+
+    for (i = 0; i < cnt; i++) {
+        n = cupkee_buffer_give(buf, iov[i].len, iov[i].base);
+        total += n;
+        if ((size_t) n < iov[i].len) {
+            break;
+        }
+    }
+    return total;
+}
+
+static int uart_recvv(int instance, int cnt, const hw_iovec_t *iov)
+{
+    hw_uart_t *control = uart_get(instance);
+    uint32_t state;
+    int i, n, total = 0;
+
+    hw_enter_critical(&state);
+    for (i = 0; i < cnt; i++) {
+        n = cupkee_buffer_take(control->rx_buff, iov[i].len, iov[i].base);
+        total += n;
+        if ((size_t) n < iov[i].len) {
+            break;
+        }
+    }
+    hw_exit_critical(state);
+
+    return total;
+}
+
+static int uart_sendv(int instance, int cnt, const hw_iovec_t *iov)
+{
+    hw_uart_t *control = uart_get(instance);
+    uint32_t state;
+    int total;
+
+    hw_enter_critical(&state);
+    total = uart_buffer_givev(control->tx_buff, cnt, iov);
+    if (total > 0) {
+        USART_CR1(device_base[instance]) |= USART_CR1_TXEIE;
+    }
+    hw_exit_critical(state);
+
+    return total;
+}
+
+static int uart_dma_sendv(int instance, int cnt, const hw_iovec_t *iov)
+{
+    hw_uart_t *control = uart_get(instance);
+    int total = uart_buffer_givev(control->tx_buff, cnt, iov);
+
+    if (total > 0 && !control->tx_len) {
+        cupkee_device_poll_request(control->dev_id);
+    }
+    return total;
+}
+
+static int uart_send_sync(int instance, size_t n, const void *data)
+{
+    // let the bytes queued go out first
+    while (USART_CR1(device_base[instance]) & USART_CR1_TXEIE) {
+    }
+
+    return uart_put_sync(instance, n, data);
+}
+
 static int uart_recv_sync(int instance, size_t n, void *data)
 {
-    uint8_t *ptr = data;
+    hw_uart_t *control = uart_get(instance);
     uint32_t begin = cupkee_systicks();
-    size_t i = 0;
 
-    while (i < n) {
-        while (!uart_has_data(instance)) {
-            if (cupkee_systicks() - begin > USART_TOUT_THRESHOLD) {
-                return -1;
-            }
+    // bytes come to rx buffer by isr
+    while (cupkee_buffer_length(control->rx_buff) < n) {
+        if (cupkee_systicks() - begin > USART_TOUT_THRESHOLD) {
+            return -1;
         }
-        ptr[i++] = uart_data_get(instance);
     }
 
-    return i;
+    return uart_recv(instance, n, data);
+}
+
+static int uart_dma_send_sync(int instance, size_t n, const void *data)
+{
+    hw_uart_t *control = uart_get(instance);
+
+    // let the bytes queued go out first, the transfer in flight and the rest
+    while (control->tx_len || !cupkee_buffer_is_empty(control->tx_buff)) {
+        uart_dma_tx(instance);
+    }
+
+    return uart_put_sync(instance, n, data);
+}
+
+static int uart_dma_recv_sync(int instance, size_t n, void *data)
+{
+    hw_uart_t *control = uart_get(instance);
+    uint32_t begin = cupkee_systicks();
+
+    while (cupkee_buffer_length(control->rx_buff) < n) {
+        if (cupkee_systicks() - begin > USART_TOUT_THRESHOLD) {
+            return -1;
+        }
+        uart_dma_rx(instance);
+    }
+
+    return cupkee_buffer_take(control->rx_buff, n, data);
 }
 
 static int uart_io_cached(int instance, size_t *in, size_t *out)
@@ -304,9 +718,30 @@ static const hw_driver_t uart_driver = {
 
     .read    = uart_recv,
     .write   = uart_send,
+    .readv   = uart_recvv,
+    .writev  = uart_sendv,
     .read_sync    = uart_recv_sync,
     .write_sync   = uart_send_sync,
-    .io_cached    = uart_io_cached
+    .io_cached    = uart_io_cached,
+
+    .flags   = HW_DRIVER_FL_POLL_REQ
+};
+
+static const hw_driver_t uart_dma_driver = {
+    .release = uart_release,
+    .reset   = uart_reset,
+    .setup   = uart_setup,
+    .poll    = uart_dma_poll,
+
+    .read    = uart_recv,
+    .write   = uart_dma_send,
+    .readv   = uart_recvv,
+    .writev  = uart_dma_sendv,
+    .read_sync    = uart_dma_recv_sync,
+    .write_sync   = uart_dma_send_sync,
+    .io_cached    = uart_io_cached,
+
+    .flags   = HW_DRIVER_FL_POLL_REQ
 };
 
 const hw_driver_t *hw_request_uart(int instance)
@@ -318,12 +753,12 @@ const hw_driver_t *hw_request_uart(int instance)
         return NULL;
     }
 
-    rx_buff = cupkee_buffer_alloc(128);
+    rx_buff = cupkee_buffer_alloc(USART_BUF_SIZE);
     if (!rx_buff) {
         return NULL;
     }
 
-    tx_buff = cupkee_buffer_alloc(128);
+    tx_buff = cupkee_buffer_alloc(USART_BUF_SIZE);
     if (!tx_buff) {
         cupkee_buffer_release(rx_buff);
         return NULL;
@@ -335,6 +770,17 @@ const hw_driver_t *hw_request_uart(int instance)
     uart_controls[instance].tx_buff= tx_buff;
     uart_controls[instance].config = NULL;
 
+    // channels taken by spi: fall back to byte interrupt
+    if (instance < USART_DMA_INSTANCES) {
+        if (!hw_dma_request(dma_rx_chn[instance], uart_dma_rx_isr, instance)) {
+            if (!hw_dma_request(dma_tx_chn[instance], uart_dma_tx_isr, instance)) {
+                uart_controls[instance].flags |= HW_FL_DMA;
+                return &uart_dma_driver;
+            }
+            hw_dma_release(dma_rx_chn[instance]);
+        }
+    }
+
     return &uart_driver;
 }
 
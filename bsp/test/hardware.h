@@ -48,6 +48,7 @@ SOFTWARE.
 #include "hw_pulse.h"
 #include "hw_timer.h"
 #include "hw_counter.h"
+#include "hw_spi.h"
 
 /******************************************************************************
  * Debug api
@@ -80,6 +81,19 @@ int  hw_dbg_uart_data_take(int instance, int n);
 void hw_dbg_adc_setup_status_set(int instance, int status);
 void hw_dbg_adc_update(int instance, int chn, uint16_t data);
 
+#define HW_DBG_WAVE_DC          0
+#define HW_DBG_WAVE_SQUARE      1
+#define HW_DBG_WAVE_SAW         2
+#define HW_DBG_WAVE_TRIANGLE    3
+void hw_dbg_adc_wave_set(int instance, int chn, int shape, uint16_t amp, uint16_t period, uint16_t offset);
+void hw_dbg_adc_scan(int instance, int n);
+
+// spi device, MISO loop back MOSI, unless reply set
+void hw_dbg_spi_setup_status_set(int instance, int status);
+void hw_dbg_spi_reply_set(int instance, int n, const uint8_t *data);
+int  hw_dbg_spi_data_take(int instance, int n, uint8_t *buf);
+int  hw_dbg_spi_selected(int instance, int *times);
+
 #if 0
 #define _TRACE(fmt, ...)    printf(fmt, ##__VA_ARGS__)
 #else
@@ -27,23 +27,70 @@ SOFTWARE.
 #include "hardware.h"
 
 #define ADC_INVALID     0xffff
+#define ADC_BLOCK_MAX   64     // samples pre block
 
 typedef struct hw_adc_t {
     uint8_t inused;
     uint8_t dev_id;
-    uint8_t state;
+    uint8_t block;              // sample by timer, deliver in blocks
     uint8_t current;
+    uint8_t next;               // block: dma half to deliver next
+    uint8_t ready;              // block: dma half complete
     uint16_t  data[HW_CHN_MAX_ADC];
+    cupkee_filter_t filter[HW_CHN_MAX_ADC];
+    uint16_t block_size;        // block: bytes
+    void    *rx_buff;           // block: delivered, wait read
     const hw_config_adc_t *config;
 } hw_adc_t;
 
 static hw_adc_t adc_controls[HW_INSTANCES_ADC];
+static uint16_t adc_dma_area[HW_INSTANCES_ADC][ADC_BLOCK_MAX * 2];
 
 /****************************************************************************
  * Debug start                                                             */
+typedef struct dbg_wave_t {
+    uint8_t  shape;
+    uint16_t amp;
+    uint16_t period;    // scans
+    uint16_t offset;
+} dbg_wave_t;
+
 static int dbg_setup_status[HW_INSTANCES_ADC];
 static int dbg_update[HW_INSTANCES_ADC];
 static uint32_t dbg_data[HW_INSTANCES_ADC];
+static uint32_t dbg_scans[HW_INSTANCES_ADC];
+static int dbg_dma_pos[HW_INSTANCES_ADC];
+static dbg_wave_t dbg_wave[HW_INSTANCES_ADC][HW_CHN_MAX_ADC];
+
+static uint16_t dbg_wave_sample(dbg_wave_t *w, uint32_t t)
+{
+    uint32_t phase, v;
+
+    if (!w->period) {
+        return w->offset;
+    }
+
+    phase = t % w->period;
+    switch (w->shape) {
+    case HW_DBG_WAVE_SQUARE:
+        v = phase < w->period / 2 ? w->amp : 0;
+        break;
+    case HW_DBG_WAVE_SAW:
+        v = w->amp * phase / w->period;
+        break;
+    case HW_DBG_WAVE_TRIANGLE:
+        phase *= 2;
+        v = phase < w->period ? w->amp * phase / w->period
+                              : w->amp * (2 * w->period - phase) / w->period;
+        break;
+    default:
+        v = 0;
+        break;
+    }
+
+    v += w->offset;
+    return v > 0xfff ? 0xfff : v;   // 12 bits converter
+}
 
 void hw_dbg_adc_setup_status_set(int instance, int status)
 {
@@ -57,6 +104,47 @@ void hw_dbg_adc_update(int instance, int chn, uint16_t data)
     adc_controls[instance].current = chn;
 }
 
+void hw_dbg_adc_wave_set(int instance, int chn, int shape, uint16_t amp, uint16_t period, uint16_t offset)
+{
+    dbg_wave_t *w = &dbg_wave[instance][chn];
+
+    w->shape  = shape;
+    w->amp    = amp;
+    w->period = period;
+    w->offset = offset;
+}
+
+// As timer trigger n scans, dma write samples and flag half or full complete
+void hw_dbg_adc_scan(int instance, int n)
+{
+    hw_adc_t *control = &adc_controls[instance];
+    int ring, chn, i;
+
+    if (!control->block) {
+        return;
+    }
+
+    // samples of two blocks
+    ring = control->block_size;
+    for (i = 0; i < n; i++, dbg_scans[instance]++) {
+        for (chn = 0; chn < control->config->chn_num; chn++) {
+            uint16_t v = dbg_wave_sample(&dbg_wave[instance][chn], dbg_scans[instance]);
+
+            adc_dma_area[instance][dbg_dma_pos[instance]++] = v;
+        }
+
+        if (dbg_dma_pos[instance] * 2 == ring) {
+            control->ready |= 1;
+            cupkee_device_poll_request(control->dev_id);
+        } else
+        if (dbg_dma_pos[instance] == ring) {
+            control->ready |= 2;
+            dbg_dma_pos[instance] = 0;
+            cupkee_device_poll_request(control->dev_id);
+        }
+    }
+}
+
 /* debug end                                                               *
  ***************************************************************************/
 
@@ -69,10 +157,41 @@ static void adc_release(int instance)
 
 static void adc_reset(int instance)
 {
+    hw_adc_t *control = &adc_controls[instance];
+
     /* Do hardware reset here */
+    if (control->block) {
+        cupkee_buffer_release(control->rx_buff);
+        control->rx_buff = NULL;
+        control->block = 0;
+    }
 
-    adc_controls[instance].dev_id = DEVICE_ID_INVALID;
-    adc_controls[instance].config = NULL;
+    control->dev_id = DEVICE_ID_INVALID;
+    control->config = NULL;
+}
+
+static int adc_block_setup(int instance, hw_adc_t *control, const hw_config_adc_t *config)
+{
+    int samples = config->block * config->chn_num;
+
+    if (!config->block || samples > ADC_BLOCK_MAX) {
+        return -CUPKEE_EINVAL;
+    }
+
+    // two blocks to keep one for delivery while dma fill another
+    control->block_size = samples * sizeof(uint16_t);
+    control->rx_buff = cupkee_buffer_alloc(control->block_size * 2);
+    if (!control->rx_buff) {
+        return -CUPKEE_ENOMEM;
+    }
+    control->ready = 0;
+    control->next = 0;
+    control->block = 1;
+
+    dbg_dma_pos[instance] = 0;
+    dbg_scans[instance] = 0;
+
+    return CUPKEE_OK;
 }
 
 static int adc_setup(int instance, uint8_t dev_id, const hw_config_t *conf)
@@ -83,11 +202,19 @@ static int adc_setup(int instance, uint8_t dev_id, const hw_config_t *conf)
 
     for (i = 0; i < config->chn_num; i++) {
         control->data[i] = ADC_INVALID;
+
+        err = cupkee_filter_init(&control->filter[i], config->oversample, config->decimate, config->deadband);
+        if (err) {
+            return err;
+        }
     }
 
     /* hardware setup here */
 
     err = -dbg_setup_status[instance];
+    if (!err && config->rate) {
+        err = adc_block_setup(instance, control, config);
+    }
 
     if (!err) {
         control->dev_id = dev_id;
@@ -96,14 +223,50 @@ static int adc_setup(int instance, uint8_t dev_id, const hw_config_t *conf)
     return err;
 }
 
+static void adc_block_poll(hw_adc_t *control)
+{
+    uint8_t ready = control->ready;
+
+    control->ready = 0;
+    if (ready == 3) {
+        // both halves complete since last poll: the older one is being overwritten, skip it
+        cupkee_event_post_device_error(control->dev_id);
+        ready &= ~(1 << control->next);
+        control->next ^= 1;
+    }
+
+    while (ready & (1 << control->next)) {
+        const uint8_t *block = (const uint8_t *)adc_dma_area[control - adc_controls] +
+                               control->next * control->block_size;
+
+        ready &= ~(1 << control->next);
+        control->next ^= 1;
+
+        if (cupkee_buffer_space(control->rx_buff) < control->block_size) {
+            // reader too slow, drop whole block to keep the channel interleave
+            cupkee_event_post_device_error(control->dev_id);
+        } else {
+            cupkee_buffer_give(control->rx_buff, control->block_size, block);
+            cupkee_event_post_device_data(control->dev_id);
+        }
+    }
+}
+
 static void adc_poll(int instance)
 {
     hw_adc_t *control = &adc_controls[instance];
 
+    if (control->block) {
+        adc_block_poll(control);
+    } else
     if (dbg_update[instance]) {
+        cupkee_filter_t *filter = &control->filter[control->current];
+
         dbg_update[instance] = 0;
-        control->data[control->current] = dbg_data[instance];
-        device_data_post(control->dev_id);
+        if (cupkee_filter_push(filter, dbg_data[instance])) {
+            control->data[control->current] = cupkee_filter_value(filter);
+            cupkee_event_post_device_data(control->dev_id);
+        }
     }
 }
 
@@ -140,16 +303,45 @@ static int adc_size(int instance)
     return control->config->chn_num;
 }
 
+static int adc_read(int instance, size_t n, void *buf)
+{
+    hw_adc_t *control = &adc_controls[instance];
+
+    if (!control->block) {
+        return -CUPKEE_EIMPLEMENT;
+    }
+    return cupkee_buffer_take(control->rx_buff, n, buf);
+}
+
+static int adc_io_cached(int instance, size_t *in, size_t *out)
+{
+    hw_adc_t *control = &adc_controls[instance];
+
+    if (!control->block) {
+        return -CUPKEE_EIMPLEMENT;
+    }
+
+    if (in) {
+        *in = cupkee_buffer_length(control->rx_buff);
+    }
+    if (out) {
+        *out = 0;
+    }
+    return 0;
+}
+
 static const hw_driver_t adc_driver = {
     .release = adc_release,
     .reset   = adc_reset,
     .setup   = adc_setup,
     .poll    = adc_poll,
-    .io.map  = {
-        .get = adc_get,
-        .set = adc_set,
-        .size = adc_size
-    }
+
+    .get = adc_get,
+    .set = adc_set,
+    .size = adc_size,
+
+    .read = adc_read,
+    .io_cached = adc_io_cached
 };
 
 const hw_driver_t *hw_request_adc(int instance)
@@ -159,6 +351,7 @@ const hw_driver_t *hw_request_adc(int instance)
     }
 
     adc_controls[instance].inused = 1;
+    adc_controls[instance].block  = 0;
     adc_controls[instance].dev_id = DEVICE_ID_INVALID;
     adc_controls[instance].config = NULL;
 
@@ -174,6 +367,6 @@ void hw_setup_adc(void)
 
         // for debug
         dbg_setup_status[i] = 0;
+        memset(dbg_wave[i], 0, sizeof(dbg_wave[i]));
     }
 }
-
@@ -71,6 +71,7 @@ void hw_setup(void)
     hw_setup_pulse();
     hw_setup_timer();
     hw_setup_counter();
+    hw_setup_spi();
 }
 
 void hw_poll(void)
@@ -157,8 +158,8 @@ const hw_driver_t *hw_device_request(int type, int instance)
     case DEVICE_TYPE_TIMER:     return hw_request_timer(instance);
     case DEVICE_TYPE_COUNTER:   return hw_request_counter(instance);
     case DEVICE_TYPE_UART:      return hw_request_uart(instance);
+    case DEVICE_TYPE_SPI:       return hw_request_spi(instance);
     case DEVICE_TYPE_USART:
-    case DEVICE_TYPE_SPI:
     default:                    return NULL;
     }
 }
@@ -174,8 +175,8 @@ int hw_device_instances(int type)
     case DEVICE_TYPE_TIMER:     return HW_INSTANCES_TIMER;
     case DEVICE_TYPE_COUNTER:   return HW_INSTANCES_COUNTER;
     case DEVICE_TYPE_UART:      return HW_INSTANCES_UART;
+    case DEVICE_TYPE_SPI:       return HW_INSTANCES_SPI;
     case DEVICE_TYPE_USART:
-    case DEVICE_TYPE_SPI:
     default:                    return 0;
     }
 }
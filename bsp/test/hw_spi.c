@@ -0,0 +1,419 @@
+/*
+MIT License
+
+This file is part of cupkee project.
+
+Copyright (c) 2016 Lixing Ding <ding.lixing@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "hardware.h"
+
+#define HW_FL_USED      1
+#define HW_XFER_MAX     16
+#define HW_WIRE_SIZE    256
+
+// Request queued in tx buffer: head {type, len}, then len bytes for write
+#define SPI_REQ_HEAD    2
+#define SPI_REQ_WRITE   0
+#define SPI_REQ_READ    1
+
+typedef struct hw_spi_t {
+    uint8_t flags;
+    uint8_t dev_id;
+    uint8_t req_type;           // request in transfer
+    uint8_t req_left;           // bytes of the request not transferred
+    uint8_t xfer_len;           // bytes in dma transfer
+    uint8_t xfer_done;          // set by dma complete
+    uint16_t rd_pend;           // bytes requested to read, not received
+    void   *rx_buff;
+    void   *tx_buff;
+    const hw_config_spi_t *config;
+    uint8_t xfer_rx[HW_XFER_MAX];
+} hw_spi_t;
+
+static hw_spi_t spi_controls[HW_INSTANCES_SPI];
+
+/****************************************************************************
+ * Debug start                                                             */
+static int dbg_setup_status[HW_INSTANCES_SPI];
+static int dbg_selected[HW_INSTANCES_SPI];
+static int dbg_selects[HW_INSTANCES_SPI];
+
+// MOSI wire log, and MISO reply from slave; MISO loop back MOSI without reply
+static uint8_t dbg_mosi[HW_INSTANCES_SPI][HW_WIRE_SIZE];
+static int dbg_mosi_len[HW_INSTANCES_SPI];
+static uint8_t dbg_miso[HW_INSTANCES_SPI][HW_WIRE_SIZE];
+static int dbg_miso_len[HW_INSTANCES_SPI];
+static int dbg_miso_pos[HW_INSTANCES_SPI];
+
+static void dbg_select(int instance, int on)
+{
+    if (spi_controls[instance].config->select != DEVICE_OPT_SELECT_AUTO) {
+        return;
+    }
+    if (on && !dbg_selected[instance]) {
+        dbg_selects[instance]++;
+    }
+    dbg_selected[instance] = on;
+}
+
+// dma transfer complete at once, exchange bytes on wire
+static void dbg_dma_xfer(int instance, const uint8_t *out, int n)
+{
+    hw_spi_t *control = &spi_controls[instance];
+    int i;
+
+    for (i = 0; i < n; i++) {
+        uint8_t d = out ? out[i] : 0xFF;
+
+        if (dbg_mosi_len[instance] < HW_WIRE_SIZE) {
+            dbg_mosi[instance][dbg_mosi_len[instance]++] = d;
+        }
+        if (dbg_miso_pos[instance] < dbg_miso_len[instance]) {
+            d = dbg_miso[instance][dbg_miso_pos[instance]++];
+        }
+        control->xfer_rx[i] = d;
+    }
+
+    control->xfer_done = 1;
+    cupkee_device_poll_request(control->dev_id);
+}
+
+void hw_dbg_spi_setup_status_set(int instance, int status)
+{
+    dbg_setup_status[instance] = status;
+}
+
+void hw_dbg_spi_reply_set(int instance, int n, const uint8_t *data)
+{
+    if (n > HW_WIRE_SIZE) {
+        n = HW_WIRE_SIZE;
+    }
+    memcpy(dbg_miso[instance], data, n);
+    dbg_miso_len[instance] = n;
+    dbg_miso_pos[instance] = 0;
+}
+
+int hw_dbg_spi_data_take(int instance, int n, uint8_t *buf)
+{
+    int len = dbg_mosi_len[instance];
+
+    if (n > len) {
+        n = len;
+    }
+    memcpy(buf, dbg_mosi[instance], n);
+    memmove(dbg_mosi[instance], dbg_mosi[instance] + n, len - n);
+    dbg_mosi_len[instance] = len - n;
+
+    return n;
+}
+
+// Chip select state, and times it was selected
+int hw_dbg_spi_selected(int instance, int *times)
+{
+    if (times) {
+        *times = dbg_selects[instance];
+    }
+    return dbg_selected[instance];
+}
+
+/* Debug end                                                               *
+ ***************************************************************************/
+static inline hw_spi_t *spi_get(int instance) {
+    return &spi_controls[instance];
+}
+
+static void spi_release(int instance)
+{
+    hw_spi_t *control = spi_get(instance);
+
+    cupkee_buffer_release(control->rx_buff);
+    cupkee_buffer_release(control->tx_buff);
+
+    /* Do hardware release here */
+
+    control->flags = 0;
+}
+
+static void spi_reset(int instance)
+{
+    hw_spi_t *control = spi_get(instance);
+
+    /* Do hardware reset here */
+    if (control->config) {
+        dbg_select(instance, 0);
+        cupkee_buffer_reset(control->rx_buff);
+        cupkee_buffer_reset(control->tx_buff);
+    }
+
+    control->dev_id = DEVICE_ID_INVALID;
+    control->config = NULL;
+}
+
+static int spi_setup(int instance, uint8_t dev_id, const hw_config_t *config)
+{
+    hw_spi_t *control = spi_get(instance);
+    const hw_config_spi_t *spi = (const hw_config_spi_t *)config;
+    int err;
+
+    if (!spi->speed || spi->mode > 3 ||
+        spi->dir >= DEVICE_OPT_DIR_MAX || spi->select >= DEVICE_OPT_SELECT_MAX) {
+        return -CUPKEE_EINVAL;
+    }
+
+    /* Do hardware setup here */
+    err = -dbg_setup_status[instance];
+
+    if (!err) {
+        control->dev_id = dev_id;
+        control->config = spi;
+        control->req_left = 0;
+        control->xfer_len = 0;
+        control->xfer_done = 0;
+        control->rd_pend = 0;
+        dbg_selected[instance] = 0;
+        dbg_selects[instance] = 0;
+    }
+    return err;
+}
+
+static void spi_xfer_start(int instance, hw_spi_t *control)
+{
+    const uint8_t *ptr = NULL;
+    int n;
+
+    if (!control->req_left) {
+        uint8_t head[SPI_REQ_HEAD];
+
+        if (SPI_REQ_HEAD != cupkee_buffer_take(control->tx_buff, SPI_REQ_HEAD, head)) {
+            // queue drained, end the selection
+            dbg_select(instance, 0);
+            return;
+        }
+        control->req_type = head[0];
+        control->req_left = head[1];
+        dbg_select(instance, 1);
+    }
+
+    n = control->req_left > HW_XFER_MAX ? HW_XFER_MAX : control->req_left;
+    if (control->req_type == SPI_REQ_WRITE) {
+        int seg = cupkee_buffer_segment(control->tx_buff, 0, &ptr);
+
+        if (n > seg) {
+            n = seg;
+        }
+    }
+    control->xfer_len = n;
+
+    dbg_dma_xfer(instance, ptr, n);
+}
+
+static void spi_xfer_done(hw_spi_t *control)
+{
+    int keep = control->req_type == SPI_REQ_READ || control->config->dir == DEVICE_OPT_DIR_DUAL;
+    int n = control->xfer_len;
+
+    control->xfer_done = 0;
+    control->xfer_len = 0;
+    control->req_left -= n;
+
+    if (control->req_type == SPI_REQ_WRITE) {
+        cupkee_buffer_skip(control->tx_buff, n);
+    } else {
+        control->rd_pend -= n;
+    }
+
+    if (keep) {
+        if (cupkee_buffer_give(control->rx_buff, n, control->xfer_rx) < n) {
+            cupkee_event_post_device_error(control->dev_id);
+        }
+        cupkee_event_post_device_data(control->dev_id);
+    }
+
+    if (!control->req_left && control->req_type == SPI_REQ_WRITE &&
+        cupkee_buffer_is_empty(control->tx_buff)) {
+        cupkee_event_post_device_drain(control->dev_id);
+    }
+}
+
+static void spi_poll(int instance)
+{
+    hw_spi_t *control = spi_get(instance);
+
+    if (!control->config) {
+        return;
+    }
+
+    if (control->xfer_done) {
+        spi_xfer_done(control);
+    }
+
+    if (!control->xfer_len) {
+        spi_xfer_start(instance, control);
+    }
+}
+
+static int spi_request(hw_spi_t *control, uint8_t type, size_t n, const uint8_t *data)
+{
+    size_t cnt = 0;
+
+    while (cnt < n) {
+        size_t space = cupkee_buffer_space(control->tx_buff);
+        uint8_t head[SPI_REQ_HEAD];
+        size_t len;
+
+        if (space < SPI_REQ_HEAD + (type == SPI_REQ_WRITE)) {
+            break;
+        }
+
+        len = n - cnt;
+        if (len > UINT8_MAX) {
+            len = UINT8_MAX;
+        }
+        if (type == SPI_REQ_WRITE && len > space - SPI_REQ_HEAD) {
+            len = space - SPI_REQ_HEAD;
+        }
+
+        head[0] = type;
+        head[1] = len;
+        cupkee_buffer_give(control->tx_buff, SPI_REQ_HEAD, head);
+        if (type == SPI_REQ_WRITE) {
+            cupkee_buffer_give(control->tx_buff, len, data + cnt);
+        }
+        cnt += len;
+    }
+
+    if (cnt && !control->xfer_len) {
+        cupkee_device_poll_request(control->dev_id);
+    }
+
+    return cnt;
+}
+
+static int spi_read_req(int instance, size_t n)
+{
+    hw_spi_t *control = spi_get(instance);
+
+    if (!control->config || !n) {
+        return -CUPKEE_EINVAL;
+    }
+
+    if (cupkee_buffer_space(control->tx_buff) < SPI_REQ_HEAD * ((n + UINT8_MAX - 1) / UINT8_MAX) ||
+        cupkee_buffer_space(control->rx_buff) < control->rd_pend + n) {
+        return -CUPKEE_EFULL;
+    }
+
+    spi_request(control, SPI_REQ_READ, n, NULL);
+    control->rd_pend += n;
+
+    return 0;
+}
+
+static int spi_recv(int instance, size_t n, void *buf)
+{
+    hw_spi_t *control = spi_get(instance);
+
+    return cupkee_buffer_take(control->rx_buff, n, buf);
+}
+
+static int spi_send(int instance, size_t n, const void *data)
+{
+    hw_spi_t *control = spi_get(instance);
+
+    if (!control->config) {
+        return -CUPKEE_EINVAL;
+    }
+
+    return spi_request(control, SPI_REQ_WRITE, n, data);
+}
+
+static int spi_io_cached(int instance, size_t *in, size_t *out)
+{
+    hw_spi_t *control = spi_get(instance);
+
+    if (in) {
+        *in = cupkee_buffer_length(control->rx_buff);
+    }
+    if (out) {
+        *out = cupkee_buffer_length(control->tx_buff);
+    }
+    return 0;
+}
+
+static const hw_driver_t spi_driver = {
+    .release = spi_release,
+    .reset   = spi_reset,
+    .setup   = spi_setup,
+    .poll    = spi_poll,
+
+    .read_req = spi_read_req,
+    .read    = spi_recv,
+    .write   = spi_send,
+    .io_cached = spi_io_cached,
+
+    .flags   = HW_DRIVER_FL_POLL_REQ
+};
+
+const hw_driver_t *hw_request_spi(int instance)
+{
+    void *rx_buff;
+    void *tx_buff;
+
+    if (instance >= HW_INSTANCES_SPI || spi_controls[instance].flags) {
+        return NULL;
+    }
+
+    rx_buff = cupkee_buffer_alloc(32);
+    if (!rx_buff) {
+        return NULL;
+    }
+
+    tx_buff = cupkee_buffer_alloc(32);
+    if (!tx_buff) {
+        cupkee_buffer_release(rx_buff);
+        return NULL;
+    }
+
+    spi_controls[instance].flags  = HW_FL_USED;
+    spi_controls[instance].dev_id = DEVICE_ID_INVALID;
+    spi_controls[instance].rx_buff= rx_buff;
+    spi_controls[instance].tx_buff= tx_buff;
+    spi_controls[instance].config = NULL;
+
+    return &spi_driver;
+}
+
+void hw_setup_spi(void)
+{
+    int i;
+
+    for (i = 0; i < HW_INSTANCES_SPI; i++) {
+        spi_controls[i].flags = 0;
+
+        // dbg init
+        dbg_setup_status[i] = 0;
+        dbg_selected[i] = 0;
+        dbg_selects[i] = 0;
+        dbg_mosi_len[i] = 0;
+        dbg_miso_len[i] = 0;
+        dbg_miso_pos[i] = 0;
+    }
+}
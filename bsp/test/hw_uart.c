@@ -27,14 +27,19 @@ SOFTWARE.
 #include "hardware.h"
 
 #define HW_FL_USED      1
+#define HW_DMA_RX_SIZE  16
+#define HW_DMA_RX_HALF  (HW_DMA_RX_SIZE / 2)
 
 typedef struct hw_uart_t {
     uint8_t flags;
     uint8_t dev_id;
-    uint8_t reserved[2];
+    uint8_t rx_pos;             // dma ring position consumed
+    uint8_t rx_seen;            // ring halves consumed
+    uint8_t rx_halves;          // ring halves filled, counted by dma
+    uint8_t tx_done;            // set by dma complete
+    uint16_t tx_len;            // bytes in dma transfer
     void   *rx_buff;
     void   *tx_buff;
-    uint32_t last_tick;
     const hw_config_uart_t *config;
 } hw_uart_t;
 
@@ -43,12 +48,24 @@ static hw_uart_t uart_controls[HW_INSTANCES_UART];
 /****************************************************************************
  * Debug start                                                             */
 static int dbg_setup_status[HW_INSTANCES_UART];
-static int dbg_data_pos[HW_INSTANCES_UART];
-static int dbg_data_len[HW_INSTANCES_UART];
-static const char *dbg_data_ptr[HW_INSTANCES_UART];
 static int dbg_data_send[HW_INSTANCES_UART];
 static int dbg_send_enable[HW_INSTANCES_UART];
 
+// DMA model: rx channel write circular ring, tx channel read tx buffer
+static uint8_t dbg_dma_ring[HW_INSTANCES_UART][HW_DMA_RX_SIZE];
+static int dbg_dma_rx_pos[HW_INSTANCES_UART];
+
+static void dbg_dma_tx_complete(int instance)
+{
+    hw_uart_t *control = &uart_controls[instance];
+
+    if (control->tx_len && !control->tx_done && dbg_send_enable[instance]) {
+        dbg_data_send[instance] += control->tx_len;
+        control->tx_done = 1;
+        cupkee_device_poll_request(control->dev_id);
+    }
+}
+
 void hw_dbg_uart_setup_status_set(int instance, int status)
 {
     dbg_setup_status[instance] = status;
@@ -57,19 +74,36 @@ void hw_dbg_uart_setup_status_set(int instance, int status)
 void hw_dbg_uart_send_state(int instance, int status)
 {
     dbg_send_enable[instance] = status;
+    dbg_dma_tx_complete(instance);
 }
 
+// Data more than ring size before poll is overrun, as hardware
 void hw_dbg_uart_data_give(int instance, const char *data)
 {
-    dbg_data_pos[instance] = 0;
-    dbg_data_len[instance] = strlen(data);
-    dbg_data_ptr[instance] = data;
+    int pos = dbg_dma_rx_pos[instance];
+
+    while (*data) {
+        dbg_dma_ring[instance][pos++] = *data++;
+        if (pos >= HW_DMA_RX_SIZE) {
+            pos = 0;
+        }
+        if (pos % HW_DMA_RX_HALF == 0) {
+            uart_controls[instance].rx_halves++;
+        }
+    }
+    dbg_dma_rx_pos[instance] = pos;
+
+    // line idle after data
+    cupkee_device_poll_request(uart_controls[instance].dev_id);
 }
 
 int  hw_dbg_uart_data_take(int instance, int n)
 {
-    int send = dbg_data_send[instance];
+    int send;
+
+    dbg_dma_tx_complete(instance);
 
+    send = dbg_data_send[instance];
     if (send > n) {
         dbg_data_send[instance] -= n;
     } else {
@@ -85,30 +119,12 @@ static inline hw_uart_t *uart_get(int instance) {
     return &uart_controls[instance];
 }
 
-static inline int uart_has_data(int instance) {
-    return dbg_data_len[instance] > dbg_data_pos[instance];
-}
-
-static inline int uart_not_busy(int instance) {
-    return dbg_send_enable[instance];
-}
-
-static inline uint8_t uart_data_get(int instance) {
-    return dbg_data_ptr[instance][dbg_data_pos[instance]++];
-}
-
-static inline void uart_data_put(int instance, uint8_t data) {
-    (void) data;
-    dbg_data_send[instance]++;
-    return;
-}
-
 static void uart_release(int instance)
 {
     hw_uart_t *control = uart_get(instance);
 
-    cupkee_buf_release(control->rx_buff);
-    cupkee_buf_release(control->tx_buff);
+    cupkee_buffer_release(control->rx_buff);
+    cupkee_buffer_release(control->tx_buff);
 
     /* Do hardware release here */
 
@@ -136,66 +152,113 @@ static int uart_setup(int instance, uint8_t dev_id, const hw_config_t *config)
     if (!err) {
         control->dev_id = dev_id;
         control->config = (const hw_config_uart_t *)config;
+        control->rx_pos = 0;
+        control->rx_seen = 0;
+        control->rx_halves = 0;
+        control->tx_len = 0;
+        control->tx_done = 0;
+        dbg_dma_rx_pos[instance] = 0;
     }
     return err;
 }
 
-static void uart_poll(int instance)
+static void uart_dma_rx(int instance)
 {
     hw_uart_t *control = uart_get(instance);
+    int pos = dbg_dma_rx_pos[instance];
+    int n, lap;
+    uint8_t seen;
 
-    if (uart_has_data(instance)) {
-        do {
-            if (cupkee_buf_push(control->rx_buff, uart_data_get(instance)) == 0) {
-                device_error_post(control->dev_id, CUPKEE_EOVERFLOW);
-                break;
-            }
-            control->last_tick = system_ticks_count;
-        } while (uart_has_data(instance));
-
-        if (cupkee_buf_is_full(control->rx_buff)) {
-            device_data_post(control->dev_id);
-        }
-    } else {
-        if (!cupkee_buf_is_empty(control->rx_buff)) {
-            if (system_ticks_count - control->last_tick > 10) {
-                device_data_post(control->dev_id);
-            }
+    n = pos - control->rx_pos;
+    if (n < 0) {
+        n += HW_DMA_RX_SIZE;
+    }
+    seen = control->rx_seen + (control->rx_pos % HW_DMA_RX_HALF + n) / HW_DMA_RX_HALF;
+
+    lap = (int8_t)(control->rx_halves - seen);
+    if (lap > 0) {
+        // dma run over unread bytes a whole ring or more, drop them all
+        control->rx_pos = pos;
+        control->rx_seen = seen + ((lap + 1) & ~1);
+        cupkee_event_post_device_error(control->dev_id);
+        return;
+    }
+    if (!n) {
+        return;
+    }
+
+    if (cupkee_buffer_give_ring(control->rx_buff, HW_DMA_RX_SIZE, dbg_dma_ring[instance],
+                                control->rx_pos, pos) < n) {
+        cupkee_event_post_device_error(control->dev_id);
+    }
+    control->rx_pos = pos;
+    control->rx_seen = seen;
+
+    cupkee_event_post_device_data(control->dev_id);
+}
+
+static void uart_dma_tx(int instance)
+{
+    hw_uart_t *control = uart_get(instance);
+    const uint8_t *ptr;
+    int n;
+
+    if (control->tx_done) {
+        control->tx_done = 0;
+        cupkee_buffer_skip(control->tx_buff, control->tx_len);
+        control->tx_len = 0;
+
+        if (cupkee_buffer_is_empty(control->tx_buff)) {
+            cupkee_event_post_device_drain(control->dev_id);
         }
     }
 
-    if (uart_not_busy(instance) && !cupkee_buf_is_empty(control->tx_buff)) {
-        do {
-            uint8_t d;
-            if (cupkee_buf_shift(control->tx_buff, &d)) {
-                uart_data_put(instance, d);
-            } else {
-                device_drain_post(control->dev_id);
-                break;
-            }
-        } while(uart_not_busy(instance));
+    if (control->tx_len) {
+        return;
+    }
+
+    n = cupkee_buffer_segment(control->tx_buff, 0, &ptr);
+    if (n > 0) {
+        control->tx_len = n;
+        dbg_dma_tx_complete(instance);
     }
 }
 
-static int uart_recv(int instance, int size, void *buf)
+static void uart_poll(int instance)
+{
+    uart_dma_rx(instance);
+    uart_dma_tx(instance);
+}
+
+static int uart_recv(int instance, size_t n, void *buf)
 {
     hw_uart_t *control = uart_get(instance);
 
-    return cupkee_buf_take(control->rx_buff, size, buf);
+    return cupkee_buffer_take(control->rx_buff, n, buf);
 }
 
-static int uart_send(int instance, int len, void *data)
+static int uart_send(int instance, size_t n, const void *data)
 {
     hw_uart_t *control = uart_get(instance);
+    int cnt = cupkee_buffer_give(control->tx_buff, n, data);
 
-    return cupkee_buf_give(control->tx_buff, len, data);
+    if (cnt > 0 && !control->tx_len) {
+        cupkee_device_poll_request(control->dev_id);
+    }
+    return cnt;
 }
 
-static int uart_received(int instance)
+static int uart_io_cached(int instance, size_t *in, size_t *out)
 {
     hw_uart_t *control = uart_get(instance);
 
-    return cupkee_buf_length(control->rx_buff);
+    if (in) {
+        *in = cupkee_buffer_length(control->rx_buff);
+    }
+    if (out) {
+        *out = cupkee_buffer_length(control->tx_buff);
+    }
+    return 0;
 }
 
 static const hw_driver_t uart_driver = {
@@ -203,11 +266,12 @@ static const hw_driver_t uart_driver = {
     .reset   = uart_reset,
     .setup   = uart_setup,
     .poll    = uart_poll,
-    .io.stream = {
-        .recv = uart_recv,
-        .send = uart_send,
-        .received = uart_received,
-    }
+
+    .read    = uart_recv,
+    .write   = uart_send,
+    .io_cached = uart_io_cached,
+
+    .flags   = HW_DRIVER_FL_POLL_REQ
 };
 
 const hw_driver_t *hw_request_uart(int instance)
@@ -219,14 +283,14 @@ const hw_driver_t *hw_request_uart(int instance)
         return NULL;
     }
 
-    rx_buff = cupkee_buf_alloc();
+    rx_buff = cupkee_buffer_alloc(32);
     if (!rx_buff) {
         return NULL;
     }
 
-    tx_buff = cupkee_buf_alloc();
+    tx_buff = cupkee_buffer_alloc(32);
     if (!tx_buff) {
-        cupkee_buf_release(rx_buff);
+        cupkee_buffer_release(rx_buff);
         return NULL;
     }
 
@@ -247,10 +311,8 @@ void hw_setup_uart(void)
         uart_controls[i].flags = 0;
 
         // dbg init
-        dbg_data_len[i] = 0;
-        dbg_data_pos[i] = 0;
         dbg_data_send[i] = 0;
         dbg_send_enable[i] = 0;
+        dbg_dma_rx_pos[i] = 0;
     }
 }
-
@@ -38,6 +38,8 @@ static const native_t native_entries[] = {
     {"pinMap",          native_pin_map},
     {"ledMap",          native_led_map},
     {"led",             native_led},
+    {"bufferDecode",    native_buffer_decode},
+    {"bufferEncode",    native_buffer_encode},
 
     {"setTimeout",      native_set_timeout},
     {"setInterval",     native_set_interval},
@@ -59,6 +61,8 @@ const native_t *board_native_entries(void)
 
 void board_setup(void)
 {
+    cupkee_crc_module_register();
+
     // Setup code here
 }
 
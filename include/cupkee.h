@@ -43,8 +43,15 @@ SOFTWARE.
 #define CUPKEE_MEMBER_OFFSET(T, m)      (intptr_t)(&(((T*)0)->m))
 #define CUPKEE_CONTAINER_OF(p, T, m)    ((T*)((intptr_t)(p) - CUPKEE_MEMBER_OFFSET(T, m)))
 
-/* User configure ? */
+/* User configure, device table start with APP_DEV_MAX slots, grow up to APP_DEV_LIMIT,
+ * board raise APP_DEV_LIMIT to reserve memory for the bigger table at init */
+#ifndef APP_DEV_MAX
 #define APP_DEV_MAX                 8
+#endif
+
+#ifndef APP_DEV_LIMIT
+#define APP_DEV_LIMIT               APP_DEV_MAX
+#endif
 
 void cupkee_init(void);
 void cupkee_loop(void);
@@ -55,8 +62,11 @@ void cupkee_loop(void);
 #include "cupkee_memory.h"
 #include "cupkee_event.h"
 #include "cupkee_buffer.h"
-#include "cupkee_stream.h"
+#include "cupkee_sbuffer.h"
+#include "cupkee_crc.h"
+#include "cupkee_filter.h"
 #include "cupkee_timer.h"
+#include "cupkee_stream.h"
 #include "cupkee_device.h"
 #include "cupkee_console.h"
 #include "cupkee_auto_complete.h"
@@ -102,6 +102,10 @@ enum DEVICE_TYPE {
 #define DEVICE_OPT_STOPBITS_1_5             3
 #define DEVICE_OPT_STOPBITS_MAX             4
 
+#define DEVICE_OPT_SELECT_AUTO              0   // default, chip selected while transfer queued
+#define DEVICE_OPT_SELECT_NONE              1   // chip select left to app
+#define DEVICE_OPT_SELECT_MAX               2
+
 typedef struct hw_info_t {
     int ram_sz;
     int rom_sz;
@@ -114,12 +118,18 @@ typedef struct hw_config_pin_t {
     uint8_t num;
     uint8_t start;
     uint8_t dir;         // DEVICE_OPT_DIR
+    uint8_t debounce;    // ms, input hold still before reported
 } hw_config_pin_t;
 
 typedef struct hw_config_adc_t {
     uint16_t interval;
     uint8_t chn_num;
     uint8_t chn_seq[HW_CHN_MAX_ADC];
+    uint16_t rate;       // scans pre second, 0: one conversion pre interval
+    uint16_t block;      // scans pre data block, when rate set
+    uint8_t  oversample; // sum 4^n samples to one, n more bits
+    uint8_t  decimate;   // average of n results to one
+    uint16_t deadband;   // report when changed more than it
 } hw_config_adc_t;
 
 typedef struct hw_config_pwm_t {
@@ -139,8 +149,20 @@ typedef struct hw_config_timer_t {
     uint8_t polarity;   // DEVICE_OPT_POLARITY
     uint8_t chn_num;
     uint8_t chn_seq[HW_CHN_MAX_TIMER];
+    uint8_t depth;      // captures kept for read, 0: latest value only
 } hw_config_timer_t;
 
+#define HW_CAPTURE_DEPTH_MAX                32
+
+// Timer capture record, read by bytes from capture device
+typedef struct hw_capture_t {
+    uint32_t stamp;     // us, time of the edge end the pulse
+    uint32_t width;     // us
+    uint8_t  chn;       // index in chn_seq
+    uint8_t  level;     // 1: high pulse, 0: low pulse
+    uint16_t reserved;
+} hw_capture_t;
+
 typedef struct hw_config_counter_t {
     uint16_t period;     // us
     uint8_t  polarity;   // DEVICE_OPT_POLARITY
@@ -160,6 +182,14 @@ typedef struct hw_config_i2c_t {
     uint8_t  addr;       // self-address
 } hw_config_i2c_t;
 
+typedef struct hw_config_spi_t {
+    uint32_t speed;      // max clock, hz
+    uint8_t  mode;       // 0 ~ 3: polarity << 1 | phase
+    uint8_t  lsb;        // bit order, 1: lsb first
+    uint8_t  dir;        // DEVICE_OPT_DIR, keep data clock in: read only, or all
+    uint8_t  select;     // DEVICE_OPT_SELECT
+} hw_config_spi_t;
+
 typedef struct hw_config_t {
     union {
         hw_config_pin_t     pin;
@@ -170,9 +200,20 @@ typedef struct hw_config_t {
         hw_config_counter_t counter;
         hw_config_uart_t    uart;
         hw_config_i2c_t     i2c;
+        hw_config_spi_t     spi;
     } data;
 } hw_config_t;
 
+// One part of a multi-part read or write
+typedef struct hw_iovec_t {
+    void  *base;
+    size_t len;
+} hw_iovec_t;
+
+// Driver call cupkee_device_poll_request when it need service,
+// poll will not be called in every loop
+#define HW_DRIVER_FL_POLL_REQ   1
+
 typedef struct hw_driver_t {
     void (*release) (int inst);
     void (*reset) (int inst);
@@ -190,8 +231,15 @@ typedef struct hw_driver_t {
     int (*read_sync)    (int inst, size_t n, void *buf);
     int (*write_sync)   (int inst, size_t n, const void *buf);
 
+    // Optional, parts in order as one read or write, return bytes done.
+    // Without them device layer call read or write part by part
+    int (*readv)        (int inst, int cnt, const hw_iovec_t *iov);
+    int (*writev)       (int inst, int cnt, const hw_iovec_t *iov);
+
     // Todo: need a suitable name
     int (*io_cached) (int inst, size_t *in, size_t *out);
+
+    uint32_t flags;
 } hw_driver_t;
 
 /****************************************************************/
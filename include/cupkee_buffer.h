@@ -50,6 +50,12 @@ int    cupkee_buffer_shift(void *b, uint8_t *d);
 
 int    cupkee_buffer_take(void *b, size_t n, void *buf);
 int    cupkee_buffer_give(void *b, size_t n, const void *buf);
+int    cupkee_buffer_move(void *dst, void *src, size_t n);
+
+/* Append bytes [from, to) of a circular area (e.g. DMA ring), for drivers */
+int    cupkee_buffer_give_ring(void *b, size_t size, const uint8_t *ring, size_t from, size_t to);
+/* Drop n bytes from buffer head */
+int    cupkee_buffer_skip(void *b, size_t n);
 
 void   *cupkee_buffer_slice(void *b, int start, int n);
 void   *cupkee_buffer_copy(void *b);
@@ -78,5 +84,12 @@ int    cupkee_buffer_read_float_le(void *b, int offset, float *f);
 int    cupkee_buffer_read_double_be(void *b, int offset, double *d);
 int    cupkee_buffer_read_double_le(void *b, int offset, double *d);
 
+/* Contiguous bytes at offset from buffer head, for scan without copy */
+int    cupkee_buffer_segment(void *b, int offset, const uint8_t **ptr);
+
+/* Bulk decode/encode n elements of size bytes, at offset from buffer head */
+int    cupkee_buffer_read_array (void *b, int offset, int n, int size, int be, void *v);
+int    cupkee_buffer_write_array(void *b, int offset, int n, int size, int be, const void *v);
+
 #endif /* __CUPKEE_BUFFER_INC__ */
 
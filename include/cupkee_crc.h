@@ -0,0 +1,51 @@
+/*
+MIT License
+
+This file is part of cupkee project.
+
+Copyright (c) 2017 Lixing Ding <ding.lixing@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __CUPKEE_CRC_INC__
+#define __CUPKEE_CRC_INC__
+
+#define CUPKEE_CRC8             0   // poly 0x07, init 0x00
+#define CUPKEE_CRC16_MODBUS     1   // poly 0x8005 reflected, init 0xffff
+#define CUPKEE_CRC16_CCITT      2   // poly 0x1021, init 0xffff
+#define CUPKEE_CRC32            3   // poly 0x04c11db7 reflected, init & xorout 0xffffffff
+#define CUPKEE_CRC_MAX          4
+
+uint8_t  cupkee_crc8(uint8_t crc, const void *data, size_t n);
+uint16_t cupkee_crc16_modbus(uint16_t crc, const void *data, size_t n);
+uint16_t cupkee_crc16_ccitt(uint16_t crc, const void *data, size_t n);
+uint32_t cupkee_crc32(uint32_t crc, const void *data, size_t n);
+
+/* Generic interface: crc = cupkee_crc_init(type), then update with chunks */
+uint32_t cupkee_crc_init(int type);
+uint32_t cupkee_crc_update(int type, uint32_t crc, const void *data, size_t n);
+
+int cupkee_crc_buffer(int type, uint32_t *crc, void *b, int offset, int n);
+int cupkee_crc_storage(int type, uint32_t *crc, int bank, uint32_t offset, uint32_t n);
+
+int cupkee_crc_module_register(void);
+
+#endif /* __CUPKEE_CRC_INC__ */
+
@@ -54,12 +54,17 @@ struct cupkee_device_t {
 
     const cupkee_device_desc_t *desc;
     const hw_driver_t *driver;
-
-    struct cupkee_device_t *next;
 };
 
+typedef struct cupkee_device_poll_stat_t {
+    uint32_t loops;
+    uint32_t polls;
+} cupkee_device_poll_stat_t;
+
 int  cupkee_device_init(void);
 void cupkee_device_poll(void);
+void cupkee_device_poll_request(int id);
+void cupkee_device_poll_stat(cupkee_device_poll_stat_t *stat);
 void cupkee_device_sync(uint32_t systicks);
 void cupkee_device_event_handle(uint16_t which, uint8_t code);
 
@@ -96,6 +101,9 @@ int cupkee_device_read_req(cupkee_device_t *dev, size_t n);
 int cupkee_device_read(cupkee_device_t *dev, size_t n, void *buf);
 int cupkee_device_write(cupkee_device_t *dev, size_t n, const void *data);
 
+int cupkee_device_readv(cupkee_device_t *dev, int cnt, const hw_iovec_t *iov);
+int cupkee_device_writev(cupkee_device_t *dev, int cnt, const hw_iovec_t *iov);
+
 int cupkee_device_read_sync(cupkee_device_t *dev, size_t n, void *buf);
 int cupkee_device_write_sync(cupkee_device_t *dev, size_t n, const void *data);
 
@@ -0,0 +1,57 @@
+/*
+MIT License
+
+This file is part of cupkee project.
+
+Copyright (c) 2017 Lixing Ding <ding.lixing@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __CUPKEE_FILTER_INC__
+#define __CUPKEE_FILTER_INC__
+
+#define CUPKEE_FILTER_OVERSAMPLE_MAX    4   // 4^4 samples, 4 more bits
+
+/*
+ * Sample filter, stage by stage:
+ *   oversample: sum 4^n samples and shift by n, got n more bits
+ *   decimate:   boxcar average of n oversampled results, 0 or 1 for bypass
+ *   deadband:   report only when changed more than deadband from last report
+ */
+typedef struct cupkee_filter_t {
+    uint32_t acc;
+    uint32_t box;
+    uint16_t acc_cnt;
+    uint8_t  box_cnt;
+    uint8_t  valid;
+    uint16_t value;     // last reported
+    uint16_t deadband;
+    uint8_t  oversample;
+    uint8_t  decimate;
+} cupkee_filter_t;
+
+int cupkee_filter_init(cupkee_filter_t *f, uint8_t oversample, uint8_t decimate, uint16_t deadband);
+int cupkee_filter_push(cupkee_filter_t *f, uint16_t sample);
+
+static inline uint16_t cupkee_filter_value(cupkee_filter_t *f) {
+    return f->value;
+}
+
+#endif /* __CUPKEE_FILTER_INC__ */
@@ -32,11 +32,16 @@ typedef struct cupkee_memory_desc_t {
     uint32_t block_cnt;
 } cupkee_memory_desc_t;
 
+// Called when pool is exhausted, return number of blocks released
+typedef int (*cupkee_memory_reclaim_t)(size_t n);
+
 void cupkee_memory_init(int n, cupkee_memory_desc_t *descs);
+int  cupkee_memory_reclaim_register(cupkee_memory_reclaim_t fn);
 
 void *cupkee_malloc(size_t n);
 void cupkee_free(void *p);
 void *cupkee_mem_ref(void *p);
+size_t cupkee_memory_block_max(void);
 
 #endif /* __CUPKEE_MEMORY_INC__ */
 
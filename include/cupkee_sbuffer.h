@@ -0,0 +1,51 @@
+/*
+MIT License
+
+This file is part of cupkee project.
+
+Copyright (c) 2017 Lixing Ding <ding.lixing@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __CUPKEE_SBUFFER_INC__
+#define __CUPKEE_SBUFFER_INC__
+
+/*
+ * Segmented buffer: a fifo of chained memory pool blocks,
+ * segments are allocated on write and released on read.
+ */
+void   *cupkee_sbuffer_alloc(size_t seg_size, size_t limit);
+void   cupkee_sbuffer_release(void *b);
+void   cupkee_sbuffer_reset(void *b);
+
+size_t cupkee_sbuffer_space(void *b);
+size_t cupkee_sbuffer_length(void *b);
+
+int    cupkee_sbuffer_is_empty(void *b);
+int    cupkee_sbuffer_is_full(void *b);
+
+int    cupkee_sbuffer_push(void *b, uint8_t d);
+int    cupkee_sbuffer_shift(void *b, uint8_t *d);
+
+int    cupkee_sbuffer_take(void *b, size_t n, void *buf);
+int    cupkee_sbuffer_give(void *b, size_t n, const void *buf);
+
+#endif /* __CUPKEE_SBUFFER_INC__ */
+
@@ -56,6 +56,22 @@ enum {
     CUPKEE_EVENT_STREAM_MAX
 };
 
+typedef struct cupkee_stream_stat_t {
+    uint32_t bytes_in;
+    uint32_t bytes_out;
+    uint32_t rx_blocks;         // RX_BLOCKED transitions
+    uint32_t tx_blocks;         // TX_BLOCKED transitions
+    uint32_t rx_block_ticks;    // systicks spent in RX_BLOCKED
+    uint32_t tx_block_ticks;    // systicks spent in TX_BLOCKED
+    uint16_t rx_peak;           // peak cached bytes
+    uint16_t tx_peak;
+    uint32_t alloc_fails;
+
+    // internal: when current block begin
+    uint32_t rx_block_from;
+    uint32_t tx_block_from;
+} cupkee_stream_stat_t;
+
 typedef struct cupkee_stream_t cupkee_stream_t;
 struct cupkee_stream_t {
     cupkee_event_emitter_t *emitter;
@@ -68,9 +84,38 @@ struct cupkee_stream_t {
     uint16_t rx_size_max;
     uint16_t tx_size_max;
 
+    // rx block at high, tx block when write over high,
+    // both resume when cached data drop to low
+    uint16_t rx_high;
+    uint16_t rx_low;
+    uint16_t tx_high;
+    uint16_t tx_low;
+
     void *rx_buf;
     void *tx_buf;
 
+    // read only chunk shared with other streams, served before tx_buf
+    void *tx_share;
+    uint16_t tx_share_pos;
+
+    // write coalesce: hold tx request while corked, or until
+    // tx_flush_size bytes cached or tx_flush_wait ticks passed
+    uint8_t  tx_cork;
+    uint8_t  tx_hold;
+    uint16_t tx_flush_size;
+    uint16_t tx_flush_wait;
+    cupkee_timer_t *tx_flush_timer;
+
+    // cache retention: keep released cache as spare, drop it and empty
+    // caches after retain_wait ticks without new data or on pool pressure
+    uint16_t retain_wait;
+    uint32_t retain_stamp;
+    void *cache_spare;
+    cupkee_stream_t *retain_next;
+
+    // counters, only when enabled
+    cupkee_stream_stat_t *stat;
+
     void (*_read) (cupkee_stream_t *s, size_t n);
     void (*_write)(cupkee_stream_t *s);
 
@@ -105,6 +150,13 @@ int cupkee_stream_init_duplex(
    void (*_read)(cupkee_stream_t *s, size_t n),
    void (*_write)(cupkee_stream_t *s)
 );
+int cupkee_stream_init_transform(
+   cupkee_stream_t *stream,
+   cupkee_event_emitter_t *emitter,
+   size_t rx_buf_max_size,
+   size_t tx_buf_max_size,
+   void (*_transform)(cupkee_stream_t *s)
+);
 int cupkee_stream_deinit(cupkee_stream_t *s);
 
 void cupkee_stream_resume(cupkee_stream_t *s);
@@ -119,6 +171,23 @@ int cupkee_stream_write(cupkee_stream_t *s, size_t n, const void *data);
 
 int cupkee_stream_unshift(cupkee_stream_t *s, uint8_t data);
 
+void cupkee_stream_cork(cupkee_stream_t *s);
+void cupkee_stream_uncork(cupkee_stream_t *s);
+void cupkee_stream_flush(cupkee_stream_t *s);
+int cupkee_stream_set_flush(cupkee_stream_t *s, size_t size, uint32_t wait);
+
+int cupkee_stream_set_retain(cupkee_stream_t *s, uint32_t wait);
+void cupkee_stream_sync(uint32_t systicks);
+
+int cupkee_stream_stat_enable(cupkee_stream_t *s, int enable);
+int cupkee_stream_stat_get(cupkee_stream_t *s, cupkee_stream_stat_t *stat);
+
+// For stream implementations, change blocked state with accounting
+void cupkee_stream_block(cupkee_stream_t *s, uint8_t flags);
+void cupkee_stream_unblock(cupkee_stream_t *s, uint8_t flags);
+
+int cupkee_stream_set_watermark(cupkee_stream_t *s, uint8_t flags, size_t high, size_t low);
+
 void cupkee_stream_set_error(cupkee_stream_t *s, uint8_t err);
 int cupkee_stream_get_error(cupkee_stream_t *s);
 
@@ -131,5 +200,58 @@ void *cupkee_stream_pull_buf(cupkee_stream_t *s);
 void *cupkee_stream_read_buf(cupkee_stream_t *s);
 int cupkee_stream_write_buf(cupkee_stream_t *s, void *data);
 
+/* Native framing transforms */
+enum {
+    CUPKEE_FRAME_LINE,      // '\n' terminated, terminator kept
+    CUPKEE_FRAME_SLIP,      // RFC 1055
+    CUPKEE_FRAME_COBS,      // 0x00 delimited
+    CUPKEE_FRAME_LENGTH,    // 16bit big endian length prefix
+    CUPKEE_FRAME_MAX
+};
+
+typedef struct cupkee_frame_stream_t {
+    cupkee_stream_t stream;
+
+    uint8_t  type;
+    uint8_t  state;
+    uint8_t  busy;
+    uint8_t  reserved;
+    uint16_t frame_max;
+    uint16_t expect;
+
+    void    *frame;     // frame in building
+    void    *ready;     // complete frame, wait for reader
+} cupkee_frame_stream_t;
+
+int cupkee_frame_stream_init(
+    cupkee_frame_stream_t *f,
+    cupkee_event_emitter_t *emitter,
+    int type,
+    size_t frame_max,
+    size_t tx_buf_max_size
+);
+int cupkee_frame_stream_deinit(cupkee_frame_stream_t *f);
+
+/* Tee: feed chunks written to it to all outputs without copy */
+#define CUPKEE_TEE_OUTPUT_MAX   4
+
+typedef struct cupkee_tee_t {
+    cupkee_stream_t stream;
+
+    uint8_t  num;
+    uint8_t  drop;      // outputs drop chunk when busy, instead of block tee
+    uint8_t  pending;   // outputs not get current chunk yet
+    uint8_t  busy;
+    uint32_t dropped;   // bytes dropped
+
+    void    *chunk;
+    cupkee_stream_t *outputs[CUPKEE_TEE_OUTPUT_MAX];
+} cupkee_tee_t;
+
+int cupkee_tee_init(cupkee_tee_t *t, cupkee_event_emitter_t *emitter, size_t buf_max_size);
+int cupkee_tee_deinit(cupkee_tee_t *t);
+int cupkee_tee_add(cupkee_tee_t *t, cupkee_stream_t *output, int drop);
+int cupkee_tee_remove(cupkee_tee_t *t, cupkee_stream_t *output);
+
 #endif /* __CUPKEE_STREAM_INC__ */
 
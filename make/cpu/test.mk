@@ -29,3 +29,6 @@ ARCH = pc
 MCU  = x86
 
 BOARD_SRC_DIR = test
+
+# exercise device table growth
+DEFS += -DAPP_DEV_LIMIT=64
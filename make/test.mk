@@ -33,6 +33,11 @@ test_SRCS +=	CUnit_Basic.c \
 				CUnit_TestRun.c \
 				CUnit_Util.c \
 
+# driver mocks exercised through cupkee_device_*
+test_SRCS +=	hw_spi.c \
+				hw_uart.c \
+				hw_adc.c
+
 test_CPPFLAGS = -I${INC_DIR} -I${LANG_DIR}/include
 test_CPPFLAGS += -I${TST_DIR}/cunit -I${BSP_DIR}/test
 
@@ -41,4 +46,4 @@ test_LDFLAGS  = -L${BSP_BUILD_DIR} -L${SYS_BUILD_DIR} -L${LANG_BUILD_DIR} -lsys
 
 include ${MAKE_DIR}/cupkee.ruls.mk
 
-VPATH = ${BASE_DIR}/test:${BASE_DIR}/test/cunit
+VPATH = ${BASE_DIR}/test:${BASE_DIR}/test/cunit:${BSP_DIR}/test
@@ -37,6 +37,7 @@ static void cupkee_event_process(void)
         if (e.type == EVENT_SYSTICK) {
             cupkee_device_sync(_cupkee_systicks);
             cupkee_timer_sync(_cupkee_systicks);
+            cupkee_stream_sync(_cupkee_systicks);
         } else
         if (e.type == EVENT_DEVICE) {
             cupkee_device_event_handle(e.which, e.code);
@@ -233,3 +233,280 @@ int cupkee_buffer_give(void *p, size_t n, const void *buf)
 
     return n;
 }
+
+int cupkee_buffer_give_ring(void *p, size_t size, const uint8_t *ring, size_t from, size_t to)
+{
+    int n;
+
+    if (from >= size || to >= size) {
+        return -CUPKEE_EINVAL;
+    }
+
+    if (to >= from) {
+        return cupkee_buffer_give(p, to - from, ring + from);
+    }
+
+    // data wrap around the ring end
+    n = cupkee_buffer_give(p, size - from, ring + from);
+    if (n == (int)(size - from)) {
+        n += cupkee_buffer_give(p, to, ring);
+    }
+    return n;
+}
+
+int cupkee_buffer_skip(void *p, size_t n)
+{
+    cupkee_buffer_t *b = (cupkee_buffer_t *)p;
+
+    if (n > b->len) {
+        n = b->len;
+    }
+
+    b->bgn += n;
+    if (b->bgn >= b->cap) {
+        b->bgn -= b->cap;
+    }
+    b->len -= n;
+
+    return n;
+}
+
+int cupkee_buffer_move(void *d, void *p, size_t n)
+{
+    cupkee_buffer_t *b = (cupkee_buffer_t *)p;
+    size_t space = cupkee_buffer_space(d);
+    size_t done = 0;
+
+    if (n > b->len) {
+        n = b->len;
+    }
+    if (n > space) {
+        n = space;
+    }
+
+    while (done < n) {
+        size_t size = b->cap - b->bgn;
+
+        if (size > n - done) {
+            size = n - done;
+        }
+        cupkee_buffer_give(d, size, b->ptr + b->bgn);
+
+        b->bgn += size;
+        if (b->bgn >= b->cap) {
+            b->bgn = 0;
+        }
+        b->len -= size;
+        done += size;
+    }
+
+    return n;
+}
+
+int cupkee_buffer_segment(void *p, int offset, const uint8_t **ptr)
+{
+    cupkee_buffer_t *b = (cupkee_buffer_t *)p;
+    int head;
+
+    if (offset < 0 || offset > b->len) {
+        return -CUPKEE_EINVAL;
+    }
+
+    head = b->bgn + offset;
+    if (head >= b->cap) {
+        head -= b->cap;
+    }
+    *ptr = b->ptr + head;
+
+    if (head + b->len - offset > b->cap) {
+        return b->cap - head;
+    } else {
+        return b->len - offset;
+    }
+}
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define BUFFER_HOST_BE  1
+#else
+#define BUFFER_HOST_BE  0
+#endif
+
+static void buffer_swap(uint8_t *d, int n, int size)
+{
+    uint8_t t;
+    int i, j;
+
+    if (size == 2) {
+        for (i = 0; i < n; i++, d += 2) {
+            t = d[0]; d[0] = d[1]; d[1] = t;
+        }
+    } else
+    if (size == 4) {
+        for (i = 0; i < n; i++, d += 4) {
+            t = d[0]; d[0] = d[3]; d[3] = t;
+            t = d[1]; d[1] = d[2]; d[2] = t;
+        }
+    } else {
+        for (i = 0; i < n; i++, d += size) {
+            for (j = 0; j < size / 2; j++) {
+                t = d[j]; d[j] = d[size - 1 - j]; d[size - 1 - j] = t;
+            }
+        }
+    }
+}
+
+int cupkee_buffer_read_array(void *p, int offset, int n, int size, int be, void *v)
+{
+    cupkee_buffer_t *b = (cupkee_buffer_t *)p;
+    int head, bytes, wrap;
+
+    if (offset < 0 || n < 0 || size < 1 || offset > b->len) {
+        return -CUPKEE_EINVAL;
+    }
+
+    if (n > (b->len - offset) / size) {
+        n = (b->len - offset) / size;
+    }
+
+    if (n) {
+        bytes = n * size;
+        head  = b->bgn + offset;
+        if (head >= b->cap) {
+            head -= b->cap;
+        }
+
+        wrap = head + bytes - b->cap;
+        if (wrap > 0) {
+            memcpy(v, b->ptr + head, bytes - wrap);
+            memcpy((uint8_t *)v + bytes - wrap, b->ptr, wrap);
+        } else {
+            memcpy(v, b->ptr + head, bytes);
+        }
+
+        if (size > 1 && (be ? 1 : 0) != BUFFER_HOST_BE) {
+            buffer_swap(v, n, size);
+        }
+    }
+
+    return n;
+}
+
+int cupkee_buffer_write_array(void *p, int offset, int n, int size, int be, const void *v)
+{
+    cupkee_buffer_t *b = (cupkee_buffer_t *)p;
+    int head, bytes, wrap;
+
+    if (offset < 0 || n < 0 || size < 1 || offset > b->len) {
+        return -CUPKEE_EINVAL;
+    }
+
+    if (n > (b->cap - offset) / size) {
+        n = (b->cap - offset) / size;
+    }
+
+    if (n) {
+        bytes = n * size;
+        head  = b->bgn + offset;
+        if (head >= b->cap) {
+            head -= b->cap;
+        }
+
+        if (size > 1 && (be ? 1 : 0) != BUFFER_HOST_BE) {
+            const uint8_t *s = v;
+            int i, j;
+
+            for (i = 0; i < n; i++, s += size) {
+                for (j = size - 1; j >= 0; j--) {
+                    b->ptr[head++] = s[j];
+                    if (head >= b->cap) {
+                        head = 0;
+                    }
+                }
+            }
+        } else {
+            wrap = head + bytes - b->cap;
+            if (wrap > 0) {
+                memcpy(b->ptr + head, v, bytes - wrap);
+                memcpy(b->ptr, (const uint8_t *)v + bytes - wrap, wrap);
+            } else {
+                memcpy(b->ptr + head, v, bytes);
+            }
+        }
+
+        if (offset + bytes > b->len) {
+            b->len = offset + bytes;
+        }
+    }
+
+    return n;
+}
+
+int cupkee_buffer_read_int8(void *b, int offset, int8_t *i)
+{
+    return cupkee_buffer_read_array(b, offset, 1, 1, 0, i);
+}
+
+int cupkee_buffer_read_uint8(void *b, int offset, uint8_t *u)
+{
+    return cupkee_buffer_read_array(b, offset, 1, 1, 0, u);
+}
+
+int cupkee_buffer_read_int16_le(void *b, int offset, int16_t *i)
+{
+    return cupkee_buffer_read_array(b, offset, 1, 2, 0, i);
+}
+
+int cupkee_buffer_read_int16_be(void *b, int offset, int16_t *i)
+{
+    return cupkee_buffer_read_array(b, offset, 1, 2, 1, i);
+}
+
+int cupkee_buffer_read_uint16_le(void *b, int offset, uint16_t *u)
+{
+    return cupkee_buffer_read_array(b, offset, 1, 2, 0, u);
+}
+
+int cupkee_buffer_read_uint16_be(void *b, int offset, uint16_t *u)
+{
+    return cupkee_buffer_read_array(b, offset, 1, 2, 1, u);
+}
+
+int cupkee_buffer_read_int32_le(void *b, int offset, int32_t *i)
+{
+    return cupkee_buffer_read_array(b, offset, 1, 4, 0, i);
+}
+
+int cupkee_buffer_read_int32_be(void *b, int offset, int32_t *i)
+{
+    return cupkee_buffer_read_array(b, offset, 1, 4, 1, i);
+}
+
+int cupkee_buffer_read_uint32_le(void *b, int offset, uint32_t *u)
+{
+    return cupkee_buffer_read_array(b, offset, 1, 4, 0, u);
+}
+
+int cupkee_buffer_read_uint32_be(void *b, int offset, uint32_t *u)
+{
+    return cupkee_buffer_read_array(b, offset, 1, 4, 1, u);
+}
+
+int cupkee_buffer_read_float_le(void *b, int offset, float *f)
+{
+    return cupkee_buffer_read_array(b, offset, 1, 4, 0, f);
+}
+
+int cupkee_buffer_read_float_be(void *b, int offset, float *f)
+{
+    return cupkee_buffer_read_array(b, offset, 1, 4, 1, f);
+}
+
+int cupkee_buffer_read_double_le(void *b, int offset, double *d)
+{
+    return cupkee_buffer_read_array(b, offset, 1, 8, 0, d);
+}
+
+int cupkee_buffer_read_double_be(void *b, int offset, double *d)
+{
+    return cupkee_buffer_read_array(b, offset, 1, 8, 1, d);
+}
@@ -27,63 +27,192 @@ SOFTWARE.
 #include "cupkee.h"
 #include "cupkee_shell_device.h"
 
-static cupkee_device_t *devices[APP_DEV_MAX];
-static cupkee_device_t *device_work = NULL;
+#if APP_DEV_LIMIT >= DEVICE_ID_INVALID
+#error "APP_DEV_LIMIT should less than DEVICE_ID_INVALID, device id is 8 bits"
+#endif
+
+#if APP_DEV_LIMIT < APP_DEV_MAX
+#error "APP_DEV_LIMIT should not less than APP_DEV_MAX"
+#endif
+
+#define DEVICE_POLL_WORDS   ((APP_DEV_LIMIT + 31) / 32)
+
+typedef struct device_sync_entry_t {
+    void (*sync)(int inst, uint32_t systicks);
+    int  inst;
+} device_sync_entry_t;
+
+typedef struct device_poll_entry_t {
+    void (*poll)(int inst);
+    int  inst;
+} device_poll_entry_t;
+
+// Device table, index by id. Start with APP_DEV_MAX slots,
+// grow to APP_DEV_LIMIT when all used.
+static int device_cap;
+static cupkee_device_t **devices;
+
+#if APP_DEV_LIMIT > APP_DEV_MAX
+// Storage for APP_DEV_LIMIT slots, taken at init, before shell use all memory left
+static uint8_t *device_reserve;
+#endif
+
+// Dispatch arrays, rebuilt when device enable or disable
+static int device_sync_num;
+static int device_poll_num;
+static device_sync_entry_t *device_sync_list;
+static device_poll_entry_t *device_poll_list;   // poll in every loop
+static device_poll_entry_t *device_poll_reqs;   // poll on request, index by id
+
+static cupkee_device_t    *device_table_init[APP_DEV_MAX];
+static device_sync_entry_t device_sync_init[APP_DEV_MAX];
+static device_poll_entry_t device_poll_init[APP_DEV_MAX];
+static device_poll_entry_t device_reqs_init[APP_DEV_MAX];
+
+// Set by driver (maybe in isr), cleared when device be polled
+static volatile uint32_t device_poll_pending[DEVICE_POLL_WORDS];
+static cupkee_device_poll_stat_t device_poll_stat;
+
+static inline cupkee_device_t *device_of(int id)
+{
+    return (id >= 0 && id < device_cap) ? devices[id] : NULL;
+}
 
-static cupkee_device_t *device_block_alloc(void)
+static void device_dispatch_build(void)
 {
     int i;
 
-    for (i = 0; i < APP_DEV_MAX; i++) {
-        if (devices[i] == NULL) {
-            cupkee_device_t *dev = (cupkee_device_t *)cupkee_malloc(sizeof(cupkee_device_t));
-            if (dev) {
-                devices[i] = dev;
-                dev->id = i;
+    device_sync_num = 0;
+    device_poll_num = 0;
+
+    for (i = 0; i < device_cap; i++) {
+        cupkee_device_t *dev = devices[i];
+        const hw_driver_t *driver;
+
+        device_poll_reqs[i].poll = NULL;
+        if (!cupkee_device_is_enabled(dev)) {
+            continue;
+        }
+        driver = dev->driver;
+
+        if (driver->sync) {
+            device_sync_list[device_sync_num].sync = driver->sync;
+            device_sync_list[device_sync_num].inst = dev->instance;
+            device_sync_num++;
+        }
+
+        if (driver->poll) {
+            device_poll_entry_t *entry;
+
+            if (driver->flags & HW_DRIVER_FL_POLL_REQ) {
+                entry = &device_poll_reqs[i];
+            } else {
+                entry = &device_poll_list[device_poll_num++];
             }
-            return dev;
+            entry->poll = driver->poll;
+            entry->inst = dev->instance;
         }
     }
-    return NULL;
 }
 
-static void device_block_release(cupkee_device_t *dev)
+#if APP_DEV_LIMIT > APP_DEV_MAX
+#define DEVICE_RESERVE_SIZE (APP_DEV_LIMIT * (sizeof(cupkee_device_t *) + sizeof(device_sync_entry_t) + \
+                                             sizeof(device_poll_entry_t) * 2))
+
+static int device_table_grow(void)
 {
-    memset(dev, 0, sizeof(cupkee_device_t));
+    int cap = device_cap * 2;
 
-    if (dev == devices[dev->id]) {
-        devices[dev->id] = NULL;
-        cupkee_free(dev);
+    if (device_cap >= APP_DEV_LIMIT || !device_reserve) {
+        return -CUPKEE_ERESOURCE;
     }
-}
+    if (cap > APP_DEV_LIMIT) {
+        cap = APP_DEV_LIMIT;
+    }
+
+    // move to reserved storage at first grow, it hold all slots already
+    if ((uint8_t *)devices != device_reserve) {
+        uint8_t *base = device_reserve;
+
+        memset(base, 0, DEVICE_RESERVE_SIZE);
+        memcpy(base, devices, device_cap * sizeof(cupkee_device_t *));
+        devices = (cupkee_device_t **) base;
+        base += APP_DEV_LIMIT * sizeof(cupkee_device_t *);
+
+        device_sync_list = (device_sync_entry_t *) base;
+        base += APP_DEV_LIMIT * sizeof(device_sync_entry_t);
 
-static void device_join_work_list(cupkee_device_t *device)
+        device_poll_list = (device_poll_entry_t *) base;
+        base += APP_DEV_LIMIT * sizeof(device_poll_entry_t);
+
+        device_poll_reqs = (device_poll_entry_t *) base;
+    }
+
+    device_cap = cap;
+    device_dispatch_build();
+
+    return CUPKEE_OK;
+}
+#else
+static inline int device_table_grow(void)
 {
-    device->next = device_work;
-    device_work = device;
+    return -CUPKEE_ERESOURCE;
 }
+#endif
 
-static void device_drop_work_list(cupkee_device_t *device)
+static cupkee_device_t *device_block_alloc(void)
 {
-    cupkee_device_t *cur = device_work;
+    cupkee_device_t *dev;
+    int i;
 
-    if (cur == device) {
-        device_work = cur->next;
-        return;
+    for (i = 0; i < device_cap; i++) {
+        if (devices[i] == NULL) {
+            break;
+        }
+    }
+
+    if (i == device_cap && device_table_grow() != CUPKEE_OK) {
+        return NULL;
     }
 
-    while(cur) {
-        cupkee_device_t *next = cur->next;
+    dev = (cupkee_device_t *)cupkee_malloc(sizeof(cupkee_device_t));
+    if (dev) {
+        devices[i] = dev;
+        dev->id = i;
+    }
+    return dev;
+}
 
-        if (next == device) {
-            cur->next = device->next;
-            return;
-        }
+static void device_block_release(cupkee_device_t *dev)
+{
+    int id = dev->id;
 
-        cur = next;
+    memset(dev, 0, sizeof(cupkee_device_t));
+
+    if (dev == device_of(id)) {
+        devices[id] = NULL;
+        cupkee_free(dev);
     }
+}
+
+static void device_poll_requested(int word)
+{
+    uint32_t pending, state;
+
+    hw_enter_critical(&state);
+    pending = device_poll_pending[word];
+    device_poll_pending[word] = 0;
+    hw_exit_critical(state);
 
-    device->next = NULL;
+    while (pending) {
+        device_poll_entry_t *entry = &device_poll_reqs[word * 32 + __builtin_ctz(pending)];
+
+        pending &= pending - 1;
+        if (entry->poll) {
+            entry->poll(entry->inst);
+            device_poll_stat.polls++;
+        }
+    }
 }
 
 static cupkee_device_t *device_request(const cupkee_device_desc_t *desc, int instance)
@@ -109,7 +238,10 @@ static cupkee_device_t *device_request(const cupkee_device_desc_t *desc, int ins
     dev->driver = driver;
     dev->desc   = desc;
 
-    dev->next   = NULL;
+    memset(&dev->config, 0, sizeof(hw_config_t));
+    if (desc->conf_init) {
+        desc->conf_init(&dev->config);
+    }
 
     return dev;
 }
@@ -117,8 +249,26 @@ static cupkee_device_t *device_request(const cupkee_device_desc_t *desc, int ins
 int cupkee_device_init(void)
 {
     /* Device blocks initial */
-    memset(devices, 0, sizeof(devices));
-    device_work = NULL;
+    memset(device_table_init, 0, sizeof(device_table_init));
+    memset(device_reqs_init, 0, sizeof(device_reqs_init));
+    devices = device_table_init;
+    device_cap = APP_DEV_MAX;
+
+    device_sync_list = device_sync_init;
+    device_poll_list = device_poll_init;
+    device_poll_reqs = device_reqs_init;
+    device_sync_num = 0;
+    device_poll_num = 0;
+
+    memset((void *)device_poll_pending, 0, sizeof(device_poll_pending));
+    memset(&device_poll_stat, 0, sizeof(device_poll_stat));
+
+#if APP_DEV_LIMIT > APP_DEV_MAX
+    // without it, table stay in APP_DEV_MAX slots
+    if (!device_reserve) {
+        device_reserve = hw_malloc(DEVICE_RESERVE_SIZE, 4);
+    }
+#endif
 
     return 0;
 }
@@ -149,12 +299,10 @@ int cupkee_device_elem_index(intptr_t id, cupkee_device_t **pdev)
 
 cupkee_device_t *cupkee_device_block(int id)
 {
-    if (id >= 0 && id < APP_DEV_MAX) {
-        cupkee_device_t *dev = devices[id];
+    cupkee_device_t *dev = device_of(id);
 
-        if (dev->desc) {
-            return dev;
-        }
+    if (dev && dev->desc) {
+        return dev;
     }
 
     return NULL;
@@ -162,12 +310,10 @@ cupkee_device_t *cupkee_device_block(int id)
 
 hw_config_t *cupkee_device_config(int id)
 {
-    if (id >= 0 && id < APP_DEV_MAX) {
-        cupkee_device_t *dev = devices[id];
+    cupkee_device_t *dev = device_of(id);
 
-        if (dev->desc) {
-            return &dev->config;
-        }
+    if (dev && dev->desc) {
+        return &dev->config;
     }
 
     return NULL;
@@ -175,50 +321,70 @@ hw_config_t *cupkee_device_config(int id)
 
 void cupkee_device_set_error(int id, uint8_t code)
 {
-    if (id >= 0 && id < APP_DEV_MAX) {
-        cupkee_device_t *dev = devices[id];
+    cupkee_device_t *dev = device_of(id);
 
-        if (cupkee_device_is_enabled(dev)) {
-            dev->error = code;
-            cupkee_event_post_device_error(id);
-        }
+    if (cupkee_device_is_enabled(dev)) {
+        dev->error = code;
+        cupkee_event_post_device_error(id);
     }
 }
 
 void cupkee_device_event_handle(uint16_t which, uint8_t code)
 {
-    cupkee_device_t *dev = devices[which];
+    cupkee_device_t *dev = device_of(which);
 
-    if ((dev->flags & DEVICE_FL_ENABLE) && dev->handle) {
+    if (cupkee_device_is_enabled(dev) && dev->handle) {
         dev->handle(dev, code, dev->handle_param);
     }
 }
 
 void cupkee_device_sync(uint32_t systicks)
 {
-    cupkee_device_t *dev = device_work;
+    int i;
 
-    while (dev) {
-        if (dev->driver->sync) {
-            dev->driver->sync(dev->instance, systicks);
-        }
-        dev = dev->next;
+    for (i = 0; i < device_sync_num; i++) {
+        device_sync_list[i].sync(device_sync_list[i].inst, systicks);
     }
 }
 
 void cupkee_device_poll(void)
 {
-    cupkee_device_t *dev = device_work;
+    int i;
 
     hw_poll();
-    while (dev) {
-        if (dev->driver->poll) {
-            dev->driver->poll(dev->instance);
+    device_poll_stat.loops++;
+
+    // drivers can not tell when they need service
+    for (i = 0; i < device_poll_num; i++) {
+        device_poll_list[i].poll(device_poll_list[i].inst);
+    }
+    device_poll_stat.polls += device_poll_num;
+
+    for (i = 0; i < DEVICE_POLL_WORDS; i++) {
+        if (device_poll_pending[i]) {
+            device_poll_requested(i);
         }
-        dev = dev->next;
     }
 }
 
+void cupkee_device_poll_request(int id)
+{
+    uint32_t state;
+
+    if (id < 0 || id >= device_cap) {
+        return;
+    }
+
+    hw_enter_critical(&state);
+    device_poll_pending[id / 32] |= 1u << (id % 32);
+    hw_exit_critical(state);
+}
+
+void cupkee_device_poll_stat(cupkee_device_poll_stat_t *stat)
+{
+    *stat = device_poll_stat;
+}
+
 cupkee_device_t *cupkee_device_request(const char *name, int instance)
 {
     const cupkee_device_desc_t *desc;
@@ -269,7 +435,7 @@ int cupkee_device_enable(cupkee_device_t *dev)
     err = dev->driver->setup(dev->instance, id, &dev->config);
     if (0 == err) {
         dev->flags |= DEVICE_FL_ENABLE;
-        device_join_work_list(dev);
+        device_dispatch_build();
         return CUPKEE_OK;
     }
 
@@ -280,8 +446,8 @@ int cupkee_device_disable(cupkee_device_t *dev)
 {
     if (cupkee_device_is_enabled(dev)) {
         dev->driver->reset(dev->instance);
-        device_drop_work_list(dev);
         dev->flags &= ~DEVICE_FL_ENABLE;
+        device_dispatch_build();
     }
 
     return CUPKEE_OK;
@@ -352,6 +518,68 @@ int cupkee_device_write(cupkee_device_t *dev, size_t n, const void *data)
     }
 }
 
+// parts one by one, stop at the first not done whole
+static int device_io_parts(cupkee_device_t *dev, int write, int cnt, const hw_iovec_t *iov)
+{
+    const hw_driver_t *driver = dev->driver;
+    int i, total = 0;
+
+    for (i = 0; i < cnt; i++) {
+        int n = write ? driver->write(dev->instance, iov[i].len, iov[i].base)
+                      : driver->read(dev->instance, iov[i].len, iov[i].base);
+
+        if (n < 0) {
+            return total ? total : n;
+        }
+        total += n;
+        if ((size_t) n < iov[i].len) {
+            break;
+        }
+    }
+
+    return total;
+}
+
+int cupkee_device_readv(cupkee_device_t *dev, int cnt, const hw_iovec_t *iov)
+{
+    if (cnt < 0 || (cnt && !iov)) {
+        return -CUPKEE_EINVAL;
+    }
+
+    if (cupkee_device_is_enabled(dev)) {
+        if (dev->driver->readv) {
+            return dev->driver->readv(dev->instance, cnt, iov);
+        } else
+        if (dev->driver->read) {
+            return device_io_parts(dev, 0, cnt, iov);
+        } else {
+            return -CUPKEE_EIMPLEMENT;
+        }
+    } else {
+        return -CUPKEE_EENABLED;
+    }
+}
+
+int cupkee_device_writev(cupkee_device_t *dev, int cnt, const hw_iovec_t *iov)
+{
+    if (cnt < 0 || (cnt && !iov)) {
+        return -CUPKEE_EINVAL;
+    }
+
+    if (cupkee_device_is_enabled(dev)) {
+        if (dev->driver->writev) {
+            return dev->driver->writev(dev->instance, cnt, iov);
+        } else
+        if (dev->driver->write) {
+            return device_io_parts(dev, 1, cnt, iov);
+        } else {
+            return -CUPKEE_EIMPLEMENT;
+        }
+    } else {
+        return -CUPKEE_EENABLED;
+    }
+}
+
 int cupkee_device_read_sync(cupkee_device_t *dev, size_t n, void *buf)
 {
     if (cupkee_device_is_enabled(dev)) {
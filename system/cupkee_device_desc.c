@@ -29,17 +29,21 @@ SOFTWARE.
 #include "cupkee_shell_device.h"
 
 static const char * const device_pin_conf_names[] = {
-    "pinNum", "pinStart", "dir"
+    "pinNum", "pinStart", "dir", "debounce"
 };
 
 static const char * const device_adc_conf_names[] = {
-    "channel", "interval"
+    "channel", "interval", "oversample", "decimate", "deadband", "rate", "block"
 };
 
 static const char * const device_pwm_pulse_timer_counter_conf_names[] = {
     "channel", "polarity", "period"
 };
 
+static const char * const device_capture_conf_names[] = {
+    "channel", "polarity", "depth"
+};
+
 static const char * const device_uart_conf_names[] = {
     "baudrate", "dataBits", "stopBits", "parity"
 };
@@ -48,6 +52,10 @@ static const char *device_i2c_conf_names[] = {
     "speed", "address"
 };
 
+static const char *device_spi_conf_names[] = {
+    "speed", "mode", "bitOrder", "dir", "select"
+};
+
 static const char *device_opt_dir[] = {
     "in", "out", "duplex"
 };
@@ -64,11 +72,19 @@ static const char *device_opt_stopbits[] = {
     "1bit", "2bit", "0.5bit", "1.5bit"
 };
 
+static const char *device_opt_order[] = {
+    "msb", "lsb"
+};
+
+static const char *device_opt_select[] = {
+    "auto", "none"
+};
+
 static const cupkee_device_desc_t device_pin = {
     .name = "pin",
     .type = DEVICE_TYPE_PIN,
     .category = DEVICE_CATEGORY_MAP,
-    .conf_num = 3,
+    .conf_num = 4,
     .conf_names = device_pin_conf_names
 };
 
@@ -76,8 +92,26 @@ static const cupkee_device_desc_t device_adc = {
     .name = "adc",
     .type = DEVICE_TYPE_ADC,
     .category = DEVICE_CATEGORY_MAP,
-    .conf_num = 2,
+    .conf_num = 5,
+    .conf_names = device_adc_conf_names,
+};
+
+static void device_sampler_conf_init(hw_config_t *conf)
+{
+    hw_config_adc_t *adc = (hw_config_adc_t *) conf;
+
+    adc->rate  = 1000;
+    adc->block = 16;
+}
+
+// adc sample by timer, data deliver in blocks
+static const cupkee_device_desc_t device_sampler = {
+    .name = "sampler",
+    .type = DEVICE_TYPE_ADC,
+    .category = DEVICE_CATEGORY_BLOCK,
+    .conf_num = 7,
     .conf_names = device_adc_conf_names,
+    .conf_init = device_sampler_conf_init,
 };
 
 static const cupkee_device_desc_t device_pwm = {
@@ -104,6 +138,23 @@ static const cupkee_device_desc_t device_timer = {
     .conf_names = device_pwm_pulse_timer_counter_conf_names,
 };
 
+static void device_capture_conf_init(hw_config_t *conf)
+{
+    hw_config_timer_t *timer = (hw_config_timer_t *) conf;
+
+    timer->depth = 16;
+}
+
+// timer keep every captured pulse, read in bulk
+static const cupkee_device_desc_t device_capture = {
+    .name = "capture",
+    .type = DEVICE_TYPE_TIMER,
+    .category = DEVICE_CATEGORY_BLOCK,
+    .conf_num = 3,
+    .conf_names = device_capture_conf_names,
+    .conf_init = device_capture_conf_init,
+};
+
 static const cupkee_device_desc_t device_counter = {
     .name = "counter",
     .type = DEVICE_TYPE_COUNTER,
@@ -128,6 +179,22 @@ static const cupkee_device_desc_t device_i2c = {
     .conf_names = device_i2c_conf_names,
 };
 
+static void device_spi_conf_init(hw_config_t *conf)
+{
+    hw_config_spi_t *spi = (hw_config_spi_t *) conf;
+
+    spi->speed = 1000000;
+}
+
+static const cupkee_device_desc_t device_spi = {
+    .name = "spi",
+    .type = DEVICE_TYPE_SPI,
+    .category = DEVICE_CATEGORY_STREAM,
+    .conf_num = 5,
+    .conf_names = device_spi_conf_names,
+    .conf_init = device_spi_conf_init,
+};
+
 static const cupkee_device_desc_t device_usb_cdc = {
     .name = "usb-cdc",
     .type = DEVICE_TYPE_USB_CDC,
@@ -138,12 +205,15 @@ static const cupkee_device_desc_t device_usb_cdc = {
 static const cupkee_device_desc_t *device_entrys[] = {
     &device_pin,
     &device_adc,
+    &device_sampler,
     &device_pwm,
     &device_pulse,
     &device_timer,
+    &device_capture,
     &device_counter,
     &device_uart,
     &device_i2c,
+    &device_spi,
     &device_usb_cdc,
     NULL
 };
@@ -264,6 +334,7 @@ static int device_pin_config_get(env_t *env, hw_config_t *conf, int which, val_t
     case DEVICE_PIN_CONF_NUM:   val_set_number(val, pin->num);   break;
     case DEVICE_PIN_CONF_START: val_set_number(val, pin->start); break;
     case DEVICE_PIN_CONF_DIR:   device_config_get_option(val, pin->dir, DEVICE_OPT_DIR_MAX, device_opt_dir); break;
+    case DEVICE_PIN_CONF_DEBOUNCE: val_set_number(val, pin->debounce); break;
     default:                    return -CUPKEE_EINVAL;
     }
 
@@ -280,6 +351,7 @@ static int device_pin_config_set(env_t *env, hw_config_t *conf, int which, val_t
     case DEVICE_PIN_CONF_NUM:   return device_config_set_uint8(val, &pin->num);
     case DEVICE_PIN_CONF_START: return device_config_set_uint8(val, &pin->start);
     case DEVICE_PIN_CONF_DIR:   return device_config_set_option(val, &pin->dir, DEVICE_OPT_DIR_MAX, device_opt_dir);
+    case DEVICE_PIN_CONF_DEBOUNCE: return device_config_set_uint8(val, &pin->debounce);
     default:                    return -CUPKEE_EINVAL;
     }
 }
@@ -291,6 +363,11 @@ static int device_adc_config_get(env_t *env, hw_config_t *conf, int which, val_t
     switch (which) {
     case DEVICE_ADC_CONF_CHANNELS: device_config_get_sequence(env, val, adc->chn_num, adc->chn_seq);   break;
     case DEVICE_ADC_CONF_INTERVAL: val_set_number(val, adc->interval); break;
+    case DEVICE_ADC_CONF_OVERSAMPLE: val_set_number(val, adc->oversample); break;
+    case DEVICE_ADC_CONF_DECIMATE: val_set_number(val, adc->decimate); break;
+    case DEVICE_ADC_CONF_DEADBAND: val_set_number(val, adc->deadband); break;
+    case DEVICE_ADC_CONF_RATE:     val_set_number(val, adc->rate); break;
+    case DEVICE_ADC_CONF_BLOCK:    val_set_number(val, adc->block); break;
     default:                       return -CUPKEE_EINVAL;
     }
 
@@ -306,6 +383,11 @@ static int device_adc_config_set(env_t *env, hw_config_t *conf, int which, val_t
     switch (which) {
     case DEVICE_ADC_CONF_CHANNELS: return device_config_set_sequence(val, HW_CHN_MAX_ADC, &adc->chn_num, adc->chn_seq);
     case DEVICE_ADC_CONF_INTERVAL: return device_config_set_uint16(val, &adc->interval);
+    case DEVICE_ADC_CONF_OVERSAMPLE: return device_config_set_uint8(val, &adc->oversample);
+    case DEVICE_ADC_CONF_DECIMATE: return device_config_set_uint8(val, &adc->decimate);
+    case DEVICE_ADC_CONF_DEADBAND: return device_config_set_uint16(val, &adc->deadband);
+    case DEVICE_ADC_CONF_RATE:     return device_config_set_uint16(val, &adc->rate);
+    case DEVICE_ADC_CONF_BLOCK:    return device_config_set_uint16(val, &adc->block);
     default:                       return -CUPKEE_EINVAL;
     }
 }
@@ -317,6 +399,7 @@ static int device_timer_config_get(env_t *env, hw_config_t *conf, int which, val
     switch (which) {
     case DEVICE_TIMER_CONF_CHANNELS: device_config_get_sequence(env, val, timer->chn_num, timer->chn_seq);   break;
     case DEVICE_TIMER_CONF_POLARITY: device_config_get_option(val, timer->polarity, DEVICE_OPT_POLARITY_MAX, device_opt_polarity); break;
+    case DEVICE_TIMER_CONF_DEPTH:    val_set_number(val, timer->depth); break;
     default:                       return -CUPKEE_EINVAL;
     }
     return CUPKEE_OK;
@@ -330,6 +413,7 @@ static int device_timer_config_set(env_t *env, hw_config_t *conf, int which, val
     switch (which) {
     case DEVICE_TIMER_CONF_CHANNELS: return device_config_set_sequence(val, HW_CHN_MAX_TIMER, &timer->chn_num, timer->chn_seq);
     case DEVICE_TIMER_CONF_POLARITY: return device_config_set_option(val, &timer->polarity, DEVICE_OPT_POLARITY_MAX, device_opt_polarity); break;
+    case DEVICE_TIMER_CONF_DEPTH:    return device_config_set_uint8(val, &timer->depth);
     default:                       return -CUPKEE_EINVAL;
     }
 }
@@ -480,9 +564,56 @@ static int device_i2c_config_set(env_t *env, hw_config_t *conf, int which, val_t
     return -CUPKEE_EINVAL;
 }
 
+static int device_spi_config_get(env_t *env, hw_config_t *conf, int which, val_t *val)
+{
+    hw_config_spi_t *spi = (hw_config_spi_t *) conf;
+
+    (void) env;
+
+    switch (which) {
+    case DEVICE_SPI_CONF_SPEED:  val_set_number(val, spi->speed); break;
+    case DEVICE_SPI_CONF_MODE:   val_set_number(val, spi->mode);  break;
+    case DEVICE_SPI_CONF_ORDER:  device_config_get_option(val, spi->lsb, 2, device_opt_order); break;
+    case DEVICE_SPI_CONF_DIR:    device_config_get_option(val, spi->dir, DEVICE_OPT_DIR_MAX, device_opt_dir); break;
+    case DEVICE_SPI_CONF_SELECT: device_config_get_option(val, spi->select, DEVICE_OPT_SELECT_MAX, device_opt_select); break;
+    default: return -CUPKEE_EINVAL;
+    }
+
+    return CUPKEE_OK;
+}
+
+static int device_spi_config_set(env_t *env, hw_config_t *conf, int which, val_t *val)
+{
+    hw_config_spi_t *spi = (hw_config_spi_t *) conf;
+
+    (void) env;
+
+    switch (which) {
+    case DEVICE_SPI_CONF_SPEED:  return device_config_set_uint32(val, &spi->speed);
+    case DEVICE_SPI_CONF_MODE:   return device_config_set_uint8(val, &spi->mode);
+    case DEVICE_SPI_CONF_ORDER:  return device_config_set_option(val, &spi->lsb, 2, device_opt_order);
+    case DEVICE_SPI_CONF_DIR:    return device_config_set_option(val, &spi->dir, DEVICE_OPT_DIR_MAX, device_opt_dir);
+    case DEVICE_SPI_CONF_SELECT: return device_config_set_option(val, &spi->select, DEVICE_OPT_SELECT_MAX, device_opt_select);
+    default: break;
+    }
+
+    return -CUPKEE_EINVAL;
+}
+
+// sampler deliver raw blocks, the map filters not apply to it
+static int device_config_hidden(cupkee_device_t *dev, int index)
+{
+    if (dev->desc->type == DEVICE_TYPE_ADC && dev->desc->category == DEVICE_CATEGORY_BLOCK) {
+        return index == DEVICE_ADC_CONF_OVERSAMPLE ||
+               index == DEVICE_ADC_CONF_DECIMATE ||
+               index == DEVICE_ADC_CONF_DEADBAND;
+    }
+    return 0;
+}
+
 static int device_config_set(cupkee_device_t *dev, env_t *env, int index, val_t *val)
 {
-    if (index >= 0 && index < dev->desc->conf_num) {
+    if (index >= 0 && index < dev->desc->conf_num && !device_config_hidden(dev, index)) {
         switch (dev->desc->type) {
         case DEVICE_TYPE_PIN:      return device_pin_config_set     (env, &dev->config, index, val);
         case DEVICE_TYPE_ADC:      return device_adc_config_set     (env, &dev->config, index, val);
@@ -492,8 +623,8 @@ static int device_config_set(cupkee_device_t *dev, env_t *env, int index, val_t
         case DEVICE_TYPE_TIMER:    return device_timer_config_set   (env, &dev->config, index, val);
         case DEVICE_TYPE_COUNTER:  return device_counter_config_set (env, &dev->config, index, val);
         case DEVICE_TYPE_UART:     return device_uart_config_set    (env, &dev->config, index, val);
-        case DEVICE_TYPE_USART:
-        case DEVICE_TYPE_SPI:      return -CUPKEE_EIMPLEMENT;
+        case DEVICE_TYPE_USART:    return -CUPKEE_EIMPLEMENT;
+        case DEVICE_TYPE_SPI:      return device_spi_config_set     (env, &dev->config, index, val);
         case DEVICE_TYPE_I2C:      return device_i2c_config_set     (env, &dev->config, index, val);
         case DEVICE_TYPE_USB_CDC:
         default: break;
@@ -506,7 +637,7 @@ static int device_config_set(cupkee_device_t *dev, env_t *env, int index, val_t
 
 static int device_config_get(cupkee_device_t *dev, env_t *env, int index, val_t *val)
 {
-    if (index >= 0 && index < dev->desc->conf_num) {
+    if (index >= 0 && index < dev->desc->conf_num && !device_config_hidden(dev, index)) {
         switch (dev->desc->type) {
         case DEVICE_TYPE_PIN:      return device_pin_config_get     (env, &dev->config, index, val);
         case DEVICE_TYPE_ADC:      return device_adc_config_get     (env, &dev->config, index, val);
@@ -516,8 +647,8 @@ static int device_config_get(cupkee_device_t *dev, env_t *env, int index, val_t
         case DEVICE_TYPE_TIMER:    return device_timer_config_get   (env, &dev->config, index, val);
         case DEVICE_TYPE_COUNTER:  return device_counter_config_get (env, &dev->config, index, val);
         case DEVICE_TYPE_UART:     return device_uart_config_get    (env, &dev->config, index, val);
-        case DEVICE_TYPE_USART:
-        case DEVICE_TYPE_SPI:      return -CUPKEE_EIMPLEMENT;
+        case DEVICE_TYPE_USART:    return -CUPKEE_EIMPLEMENT;
+        case DEVICE_TYPE_SPI:      return device_spi_config_get     (env, &dev->config, index, val);
         case DEVICE_TYPE_I2C:      return device_i2c_config_get     (env, &dev->config, index, val);
         case DEVICE_TYPE_USB_CDC:
         default: return -CUPKEE_EIMPLEMENT;
@@ -0,0 +1,72 @@
+/*
+MIT License
+
+This file is part of cupkee project.
+
+Copyright (c) 2017 Lixing Ding <ding.lixing@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "cupkee.h"
+
+int cupkee_filter_init(cupkee_filter_t *f, uint8_t oversample, uint8_t decimate, uint16_t deadband)
+{
+    if (!f || oversample > CUPKEE_FILTER_OVERSAMPLE_MAX) {
+        return -CUPKEE_EINVAL;
+    }
+
+    memset(f, 0, sizeof(cupkee_filter_t));
+    f->oversample = oversample;
+    f->decimate = decimate > 1 ? decimate : 1;
+    f->deadband = deadband;
+
+    return CUPKEE_OK;
+}
+
+// return 1 when a new value should be reported
+int cupkee_filter_push(cupkee_filter_t *f, uint16_t sample)
+{
+    uint16_t v;
+
+    f->acc += sample;
+    if (++f->acc_cnt < (1u << (2 * f->oversample))) {
+        return 0;
+    }
+    v = f->acc >> f->oversample;
+    f->acc = 0;
+    f->acc_cnt = 0;
+
+    f->box += v;
+    if (++f->box_cnt < f->decimate) {
+        return 0;
+    }
+    v = f->box / f->decimate;
+    f->box = 0;
+    f->box_cnt = 0;
+
+    // deadband 0: report any change
+    if (f->valid && (v > f->value ? v - f->value : f->value - v) <= f->deadband) {
+        return 0;
+    }
+
+    f->valid = 1;
+    f->value = v;
+    return 1;
+}
@@ -27,6 +27,7 @@ SOFTWARE.
 #include "cupkee.h"
 
 #define MEM_POOL_MAX    8
+#define MEM_RECLAIM_MAX 4
 
 #ifdef SIZE_ALIGN
 #undef SIZE_ALIGN
@@ -58,6 +59,8 @@ typedef struct mem_pool_t {
 
 static int         mem_pool_cnt = 0;
 static mem_pool_t *mem_pool[MEM_POOL_MAX];
+static int         mem_reclaim_cnt = 0;
+static cupkee_memory_reclaim_t mem_reclaim[MEM_RECLAIM_MAX];
 static const cupkee_memory_desc_t mem_pool_def[3] = {
     {64,  32},
     {128, 16},
@@ -125,6 +128,7 @@ void cupkee_memory_init(int pool_cnt, cupkee_memory_desc_t *descs)
     int i;
 
     mem_pool_cnt = 0;
+    mem_reclaim_cnt = 0;
     if (pool_cnt == 0 || descs == NULL) {
         pool_cnt = 3;
         descs = (cupkee_memory_desc_t *) mem_pool_def;
@@ -139,7 +143,21 @@ void cupkee_memory_init(int pool_cnt, cupkee_memory_desc_t *descs)
     mem_pool_cnt = i;
 }
 
-void *cupkee_malloc(size_t n)
+// Largest size one allocation could ever get
+size_t cupkee_memory_block_max(void)
+{
+    size_t max = 0;
+    int i;
+
+    for (i = 0; i < mem_pool_cnt; i++) {
+        if (max < mem_pool[i]->block_size) {
+            max = mem_pool[i]->block_size;
+        }
+    }
+    return max;
+}
+
+static void *memory_alloc(size_t n)
 {
     int i;
 
@@ -157,6 +175,49 @@ void *cupkee_malloc(size_t n)
     return NULL;
 }
 
+static int memory_reclaim(size_t n)
+{
+    int i, released = 0;
+
+    for (i = 0; i < mem_reclaim_cnt; i++) {
+        released += mem_reclaim[i](n);
+    }
+    return released;
+}
+
+int cupkee_memory_reclaim_register(cupkee_memory_reclaim_t fn)
+{
+    int i;
+
+    if (!fn) {
+        return -CUPKEE_EINVAL;
+    }
+
+    for (i = 0; i < mem_reclaim_cnt; i++) {
+        if (mem_reclaim[i] == fn) {
+            return CUPKEE_OK;
+        }
+    }
+
+    if (mem_reclaim_cnt >= MEM_RECLAIM_MAX) {
+        return -CUPKEE_ERESOURCE;
+    }
+    mem_reclaim[mem_reclaim_cnt++] = fn;
+
+    return CUPKEE_OK;
+}
+
+void *cupkee_malloc(size_t n)
+{
+    void *p = memory_alloc(n);
+
+    // pool pressure: ask holders of idle blocks to give them back
+    if (!p && memory_reclaim(n) > 0) {
+        p = memory_alloc(n);
+    }
+    return p;
+}
+
 void cupkee_free(void *p)
 {
     mem_block_t *b = CUPKEE_CONTAINER_OF(p, mem_block_t, next);
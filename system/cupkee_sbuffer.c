@@ -0,0 +1,253 @@
+/*
+MIT License
+
+This file is part of cupkee project.
+
+Copyright (c) 2017 Lixing Ding <ding.lixing@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "cupkee.h"
+
+typedef struct sbuffer_seg_t {
+    struct sbuffer_seg_t *next;
+    uint8_t ptr[0];
+} sbuffer_seg_t;
+
+typedef struct cupkee_sbuffer_t {
+    uint32_t limit;     // 0: no limit, bounded by memory only
+    uint32_t len;
+    uint16_t seg_size;
+    uint16_t head_pos;  // read position in head segment
+    uint16_t tail_pos;  // write position in tail segment
+    sbuffer_seg_t *head;
+    sbuffer_seg_t *tail;
+} cupkee_sbuffer_t;
+
+static sbuffer_seg_t *sbuffer_seg_append(cupkee_sbuffer_t *b)
+{
+    sbuffer_seg_t *seg = cupkee_malloc(sizeof(sbuffer_seg_t) + b->seg_size);
+
+    if (seg) {
+        seg->next = NULL;
+        if (b->tail) {
+            b->tail->next = seg;
+        } else {
+            b->head = seg;
+            b->head_pos = 0;
+        }
+        b->tail = seg;
+        b->tail_pos = 0;
+    }
+    return seg;
+}
+
+static void sbuffer_seg_drop(cupkee_sbuffer_t *b)
+{
+    sbuffer_seg_t *seg = b->head;
+
+    b->head = seg->next;
+    b->head_pos = 0;
+    if (!b->head) {
+        b->tail = NULL;
+        b->tail_pos = 0;
+    }
+    cupkee_free(seg);
+}
+
+static inline int sbuffer_head_data(cupkee_sbuffer_t *b)
+{
+    return (b->head == b->tail ? b->tail_pos : b->seg_size) - b->head_pos;
+}
+
+static inline int sbuffer_tail_space(cupkee_sbuffer_t *b)
+{
+    return b->tail ? b->seg_size - b->tail_pos : 0;
+}
+
+void *cupkee_sbuffer_alloc(size_t seg_size, size_t limit)
+{
+    cupkee_sbuffer_t *b;
+
+    // segment must fit one memory block, or it never get allocated
+    if (seg_size == 0 || seg_size > UINT16_MAX ||
+        sizeof(sbuffer_seg_t) + seg_size > cupkee_memory_block_max()) {
+        return NULL;
+    }
+
+    b = cupkee_malloc(sizeof(cupkee_sbuffer_t));
+    if (b) {
+        b->limit = limit;
+        b->len = 0;
+        b->seg_size = seg_size;
+        b->head_pos = 0;
+        b->tail_pos = 0;
+        b->head = NULL;
+        b->tail = NULL;
+    }
+    return b;
+}
+
+void cupkee_sbuffer_reset(void *p)
+{
+    cupkee_sbuffer_t *b = (cupkee_sbuffer_t *)p;
+
+    while (b->head) {
+        sbuffer_seg_drop(b);
+    }
+    b->len = 0;
+}
+
+void cupkee_sbuffer_release(void *p)
+{
+    cupkee_sbuffer_reset(p);
+    cupkee_free(p);
+}
+
+size_t cupkee_sbuffer_space(void *p)
+{
+    cupkee_sbuffer_t *b = (cupkee_sbuffer_t *)p;
+
+    return b->limit ? b->limit - b->len : UINT32_MAX - b->len;
+}
+
+size_t cupkee_sbuffer_length(void *p)
+{
+    cupkee_sbuffer_t *b = (cupkee_sbuffer_t *)p;
+
+    return b->len;
+}
+
+int cupkee_sbuffer_is_empty(void *p)
+{
+    cupkee_sbuffer_t *b = (cupkee_sbuffer_t *)p;
+
+    return b->len == 0;
+}
+
+int cupkee_sbuffer_is_full(void *p)
+{
+    cupkee_sbuffer_t *b = (cupkee_sbuffer_t *)p;
+
+    return b->limit && b->len >= b->limit;
+}
+
+int cupkee_sbuffer_push(void *p, uint8_t d)
+{
+    cupkee_sbuffer_t *b = (cupkee_sbuffer_t *)p;
+
+    if (b->limit && b->len >= b->limit) {
+        return 0;
+    }
+
+    if (!sbuffer_tail_space(b) && !sbuffer_seg_append(b)) {
+        return 0;
+    }
+
+    b->tail->ptr[b->tail_pos++] = d;
+    b->len++;
+
+    return 1;
+}
+
+int cupkee_sbuffer_shift(void *p, uint8_t *d)
+{
+    cupkee_sbuffer_t *b = (cupkee_sbuffer_t *)p;
+
+    if (b->len == 0) {
+        return 0;
+    }
+
+    *d = b->head->ptr[b->head_pos++];
+    if (--b->len == 0) {
+        // keep the last segment for reuse
+        b->head_pos = 0;
+        b->tail_pos = 0;
+    } else
+    if (b->head_pos >= b->seg_size) {
+        sbuffer_seg_drop(b);
+    }
+
+    return 1;
+}
+
+int cupkee_sbuffer_take(void *p, size_t n, void *buf)
+{
+    cupkee_sbuffer_t *b = (cupkee_sbuffer_t *)p;
+    size_t done = 0;
+
+    if (n > b->len) {
+        n = b->len;
+    }
+
+    while (done < n) {
+        size_t size = sbuffer_head_data(b);
+
+        if (size > n - done) {
+            size = n - done;
+        }
+        memcpy((uint8_t *)buf + done, b->head->ptr + b->head_pos, size);
+
+        done += size;
+        b->head_pos += size;
+        b->len -= size;
+
+        if (b->len == 0) {
+            b->head_pos = 0;
+            b->tail_pos = 0;
+        } else
+        if (b->head_pos >= b->seg_size) {
+            sbuffer_seg_drop(b);
+        }
+    }
+
+    return n;
+}
+
+int cupkee_sbuffer_give(void *p, size_t n, const void *buf)
+{
+    cupkee_sbuffer_t *b = (cupkee_sbuffer_t *)p;
+    size_t done = 0;
+
+    if (b->limit && n + b->len > b->limit) {
+        n = b->limit - b->len;
+    }
+
+    while (done < n) {
+        size_t size = sbuffer_tail_space(b);
+
+        if (!size) {
+            if (!sbuffer_seg_append(b)) {
+                break;
+            }
+            size = b->seg_size;
+        }
+        if (size > n - done) {
+            size = n - done;
+        }
+        memcpy(b->tail->ptr + b->tail_pos, (const uint8_t *)buf + done, size);
+
+        done += size;
+        b->tail_pos += size;
+        b->len += size;
+    }
+
+    return done;
+}
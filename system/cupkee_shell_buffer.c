@@ -0,0 +1,243 @@
+/*
+MIT License
+
+This file is part of cupkee project.
+
+Copyright (c) 2016-2017 Lixing Ding <ding.lixing@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cupkee.h>
+
+#include "cupkee_shell_misc.h"
+
+#define BUFFER_ELEM_SIGNED      0
+#define BUFFER_ELEM_UNSIGNED    1
+#define BUFFER_ELEM_FLOAT       2
+
+typedef struct buffer_elem_type_t {
+    uint8_t size;
+    uint8_t be;
+    uint8_t kind;
+} buffer_elem_type_t;
+
+static const char * const buffer_elem_names[] = {
+    "int8", "uint8",
+    "int16le", "int16be", "uint16le", "uint16be",
+    "int32le", "int32be", "uint32le", "uint32be",
+    "floatle", "floatbe", "doublele", "doublebe",
+};
+
+static const buffer_elem_type_t buffer_elem_types[] = {
+    {1, 0, BUFFER_ELEM_SIGNED}, {1, 0, BUFFER_ELEM_UNSIGNED},
+    {2, 0, BUFFER_ELEM_SIGNED}, {2, 1, BUFFER_ELEM_SIGNED},
+    {2, 0, BUFFER_ELEM_UNSIGNED}, {2, 1, BUFFER_ELEM_UNSIGNED},
+    {4, 0, BUFFER_ELEM_SIGNED}, {4, 1, BUFFER_ELEM_SIGNED},
+    {4, 0, BUFFER_ELEM_UNSIGNED}, {4, 1, BUFFER_ELEM_UNSIGNED},
+    {4, 0, BUFFER_ELEM_FLOAT}, {4, 1, BUFFER_ELEM_FLOAT},
+    {8, 0, BUFFER_ELEM_FLOAT}, {8, 1, BUFFER_ELEM_FLOAT},
+};
+
+#define BUFFER_ELEM_TYPE_MAX (sizeof(buffer_elem_types) / sizeof(buffer_elem_type_t))
+
+static const buffer_elem_type_t *buffer_elem_type(val_t *v)
+{
+    int id = shell_val_id(v, BUFFER_ELEM_TYPE_MAX, buffer_elem_names);
+
+    if (id < 0 || id >= (int)BUFFER_ELEM_TYPE_MAX) {
+        return NULL;
+    }
+    return &buffer_elem_types[id];
+}
+
+static uint64_t buffer_elem_load(const uint8_t *p, int size, int be)
+{
+    uint64_t raw = 0;
+    int i;
+
+    if (be) {
+        for (i = 0; i < size; i++) {
+            raw = (raw << 8) | p[i];
+        }
+    } else {
+        for (i = size - 1; i >= 0; i--) {
+            raw = (raw << 8) | p[i];
+        }
+    }
+    return raw;
+}
+
+static void buffer_elem_store(uint8_t *p, int size, int be, uint64_t raw)
+{
+    int i;
+
+    if (be) {
+        for (i = size - 1; i >= 0; i--, raw >>= 8) {
+            p[i] = raw;
+        }
+    } else {
+        for (i = 0; i < size; i++, raw >>= 8) {
+            p[i] = raw;
+        }
+    }
+}
+
+static double buffer_elem_decode(const buffer_elem_type_t *t, uint64_t raw)
+{
+    union {
+        uint32_t u;
+        float    f;
+    } u32;
+    union {
+        uint64_t u;
+        double   d;
+    } u64;
+
+    if (t->kind == BUFFER_ELEM_UNSIGNED) {
+        return raw;
+    } else
+    if (t->kind == BUFFER_ELEM_SIGNED) {
+        int shift = 64 - t->size * 8;
+        return (int64_t)(raw << shift) >> shift;
+    } else
+    if (t->size == 4) {
+        u32.u = raw;
+        return u32.f;
+    } else {
+        u64.u = raw;
+        return u64.d;
+    }
+}
+
+static uint64_t buffer_elem_encode(const buffer_elem_type_t *t, double v)
+{
+    union {
+        uint32_t u;
+        float    f;
+    } u32;
+    union {
+        uint64_t u;
+        double   d;
+    } u64;
+
+    if (t->kind != BUFFER_ELEM_FLOAT) {
+        // double to integer conversion is undefined out of range
+        if (v != v) {
+            return 0;
+        } else
+        if (v >= 9223372036854775808.0) {
+            return (uint64_t)INT64_MAX;
+        } else
+        if (v < -9223372036854775808.0) {
+            return (uint64_t)INT64_MIN;
+        }
+        return (uint64_t)(int64_t)v;
+    } else
+    if (t->size == 4) {
+        u32.f = v;
+        return u32.u;
+    } else {
+        u64.d = v;
+        return u64.u;
+    }
+}
+
+/*
+ * bufferDecode(buffer, type [, offset [, n]]) => array of numbers
+ */
+val_t native_buffer_decode(env_t *env, int ac, val_t *av)
+{
+    const buffer_elem_type_t *t;
+    const uint8_t *ptr;
+    array_t *list;
+    val_t *elems, result;
+    int offset = 0, n, size, i;
+
+    if (ac < 2 || !val_is_buffer(av) || !(t = buffer_elem_type(av + 1))) {
+        return VAL_UNDEFINED;
+    }
+
+    size = _val_buffer_size(av);
+    if (ac > 2 && val_is_number(av + 2)) {
+        offset = val_2_integer(av + 2);
+    }
+    if (offset < 0 || offset > size) {
+        return VAL_UNDEFINED;
+    }
+
+    n = (size - offset) / t->size;
+    if (ac > 3 && val_is_number(av + 3)) {
+        i = val_2_integer(av + 3);
+        if (i >= 0 && i < n) {
+            n = i;
+        }
+    }
+
+    list = _array_create(env, n);
+    if (!list) {
+        return VAL_UNDEFINED;
+    }
+
+    // array create may move the buffer, get the address after it
+    ptr = (const uint8_t *)_val_buffer_addr(av) + offset;
+    elems = array_values(list);
+    for (i = 0; i < n; i++, ptr += t->size) {
+        val_set_number(elems + i, buffer_elem_decode(t, buffer_elem_load(ptr, t->size, t->be)));
+    }
+
+    val_set_array(&result, (intptr_t) list);
+
+    return result;
+}
+
+/*
+ * bufferEncode(array, type) => buffer
+ */
+val_t native_buffer_encode(env_t *env, int ac, val_t *av)
+{
+    const buffer_elem_type_t *t;
+    type_buffer_t *b;
+    val_t *elems, result;
+    uint8_t *ptr;
+    int n, i;
+
+    if (ac < 2 || !val_is_array(av) || !(t = buffer_elem_type(av + 1))) {
+        return VAL_UNDEFINED;
+    }
+
+    n = array_len((array_t *)val_2_intptr(av));
+    b = buffer_create(env, n * t->size);
+    if (!b) {
+        return VAL_UNDEFINED;
+    }
+
+    // buffer create may move the array, get the values after it
+    elems = array_values((array_t *)val_2_intptr(av));
+    ptr = b->buf;
+    for (i = 0; i < n; i++, ptr += t->size) {
+        double v = val_is_number(elems + i) ? val_2_double(elems + i) : 0;
+
+        buffer_elem_store(ptr, t->size, t->be, buffer_elem_encode(t, v));
+    }
+
+    val_set_buffer(&result, b);
+
+    return result;
+}
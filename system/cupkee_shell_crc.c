@@ -0,0 +1,155 @@
+/*
+MIT License
+
+This file is part of cupkee project.
+
+Copyright (c) 2016-2017 Lixing Ding <ding.lixing@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cupkee.h>
+
+#include "cupkee_shell_misc.h"
+
+static const char * const crc_type_names[] = {
+    "crc8", "crc16", "crc16ccitt", "crc32"
+};
+
+/*
+ * crc.crc16(data [, crc]) => number
+ * data is a buffer or string, crc continues a previous result
+ */
+static val_t crc_data(int type, int ac, val_t *av)
+{
+    uint32_t crc;
+    void *data;
+    int size;
+
+    if (ac < 1) {
+        return VAL_UNDEFINED;
+    }
+
+    data = cupkee_val2data(av, &size);
+    if (ac > 1 && val_is_number(av + 1)) {
+        double v = val_2_double(av + 1);
+
+        // not a previous result, and out of uint32 range is undefined to convert
+        if (!(v >= 0 && v <= UINT32_MAX)) {
+            return VAL_UNDEFINED;
+        }
+        crc = v;
+    } else {
+        crc = cupkee_crc_init(type);
+    }
+
+    if (data) {
+        crc = cupkee_crc_update(type, crc, data, size);
+    }
+
+    return val_mk_number(crc);
+}
+
+static val_t native_crc8(env_t *env, int ac, val_t *av)
+{
+    (void) env;
+
+    return crc_data(CUPKEE_CRC8, ac, av);
+}
+
+static val_t native_crc16(env_t *env, int ac, val_t *av)
+{
+    (void) env;
+
+    return crc_data(CUPKEE_CRC16_MODBUS, ac, av);
+}
+
+static val_t native_crc16_ccitt(env_t *env, int ac, val_t *av)
+{
+    (void) env;
+
+    return crc_data(CUPKEE_CRC16_CCITT, ac, av);
+}
+
+static val_t native_crc32(env_t *env, int ac, val_t *av)
+{
+    (void) env;
+
+    return crc_data(CUPKEE_CRC32, ac, av);
+}
+
+/*
+ * crc.storage(type, bank [, offset [, n]]) => number
+ * n default to the data length of bank
+ */
+static val_t native_crc_storage(env_t *env, int ac, val_t *av)
+{
+    uint32_t crc, offset = 0, n;
+    int type, bank;
+
+    (void) env;
+
+    if (ac < 2 || !val_is_number(av + 1)) {
+        return VAL_UNDEFINED;
+    }
+
+    type = shell_val_id(av, CUPKEE_CRC_MAX, crc_type_names);
+    if (type < 0 || type >= CUPKEE_CRC_MAX) {
+        return VAL_UNDEFINED;
+    }
+    bank = val_2_integer(av + 1);
+
+    if (ac > 2 && val_is_number(av + 2)) {
+        offset = val_2_integer(av + 2);
+    }
+    if (ac > 3 && val_is_number(av + 3)) {
+        n = val_2_integer(av + 3);
+    } else {
+        n = hw_storage_data_length(bank);
+    }
+
+    crc = cupkee_crc_init(type);
+    if (cupkee_crc_storage(type, &crc, bank, offset, n) < 0) {
+        return VAL_UNDEFINED;
+    }
+
+    return val_mk_number(crc);
+}
+
+int cupkee_crc_module_register(void)
+{
+    void *mod = cupkee_module_create("crc", 5);
+
+    if (!mod) {
+        return -CUPKEE_ENOMEM;
+    }
+
+    cupkee_module_export_native(mod, "crc8", native_crc8);
+    cupkee_module_export_native(mod, "crc16", native_crc16);
+    cupkee_module_export_native(mod, "crc16ccitt", native_crc16_ccitt);
+    cupkee_module_export_native(mod, "crc32", native_crc32);
+    cupkee_module_export_native(mod, "storage", native_crc_storage);
+
+    if (0 != cupkee_module_register(mod)) {
+        cupkee_module_release(mod);
+        return -CUPKEE_ENAME;
+    }
+
+    return CUPKEE_OK;
+}
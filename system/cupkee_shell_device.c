@@ -29,11 +29,30 @@ SOFTWARE.
 #include "cupkee_shell_misc.h"
 #include "cupkee_shell_device.h"
 
+#define DEVICE_WRITE_PARTS_MAX  8
+#define DEVICE_BATCH_VALUES_MAX 64      // values one batch hold, fit in a memory block
+
 typedef union device_handle_set_t {
     intptr_t param;
     uint8_t  handles[DEVICE_EVENT_MAX];
 } device_handle_set_t;
 
+// Map device data cached natively, deliver to handler in batch
+typedef struct device_batch_t {
+    struct device_batch_t *next;
+    cupkee_timer_t *timer;
+    uint8_t  dev_id;
+    uint8_t  width;         // values of one sample
+    uint16_t batch;         // samples of one callback
+    uint16_t count;         // samples cached
+    uint16_t max_delay;     // ms from first sample cached, 0: no limit
+    uint8_t  due;           // due event posted by timer, flush on it
+    val_t   *values;
+} device_batch_t;
+
+static device_batch_t *device_batch_head;
+static cupkee_event_emitter_t device_batch_emitter; // due events, code is device id
+
 static int device_is_true(intptr_t ptr);
 static void device_op_prop(void *env, intptr_t id, val_t *name, val_t *prop);
 static void device_op_elem(void *env, intptr_t id, val_t *which, val_t *elem);
@@ -275,6 +294,28 @@ static int device_read_2_buffer(cupkee_device_t *dev, env_t *env, int n, val_t *
     return err;
 }
 
+static int device_write_parts(cupkee_device_t *dev, val_t *list)
+{
+    array_t *array = (array_t *)val_2_intptr(list);
+    hw_iovec_t iov[DEVICE_WRITE_PARTS_MAX];
+    int i, cnt = array_len(array);
+
+    if (cnt > DEVICE_WRITE_PARTS_MAX) {
+        return -CUPKEE_EINVAL;
+    }
+
+    for (i = 0; i < cnt; i++) {
+        int size;
+
+        if (!(iov[i].base = cupkee_val2data(_array_elem(array, i), &size))) {
+            return -CUPKEE_EINVAL;
+        }
+        iov[i].len = size;
+    }
+
+    return cupkee_device_writev(dev, cnt, iov);
+}
+
 static int device_event_handle_set(cupkee_device_t *dev, int event, val_t *cb)
 {
     device_handle_set_t *set = (device_handle_set_t *)&dev->handle_param;
@@ -319,10 +360,255 @@ static void device_event_handle_release(cupkee_device_t *dev)
     }
 }
 
+static void device_batch_timer_stop(device_batch_t *b)
+{
+    cupkee_timer_t *t = b->timer;
+
+    if (t) {
+        b->timer = NULL;
+        cupkee_timer_unregister(t);
+    }
+}
+
+static device_batch_t *device_batch_find(uint8_t id)
+{
+    device_batch_t *b = device_batch_head;
+
+    while (b && b->dev_id != id) {
+        b = b->next;
+    }
+    return b;
+}
+
+static void device_batch_release(uint8_t id)
+{
+    device_batch_t **pb = &device_batch_head;
+    device_batch_t *b;
+
+    while ((b = *pb) != NULL) {
+        if (b->dev_id == id) {
+            *pb = b->next;
+            device_batch_timer_stop(b);
+            if (b->values) {
+                cupkee_free(b->values);
+            }
+            cupkee_free(b);
+            return;
+        }
+        pb = &b->next;
+    }
+}
+
+static int device_batch_setup(cupkee_device_t *dev, val_t *opts)
+{
+    object_iter_t it;
+    const char *key;
+    val_t *val;
+    int batch = 0, delay = 0;
+    device_batch_t *b;
+
+    if (dev->desc->category != DEVICE_CATEGORY_MAP || object_iter_init(&it, opts)) {
+        return -CUPKEE_EINVAL;
+    }
+
+    while (object_iter_next(&it, &key, &val)) {
+        if (!val_is_number(val)) {
+            return -CUPKEE_EINVAL;
+        }
+        if (!strcmp(key, "batch")) {
+            batch = val_2_integer(val);
+        } else
+        if (!strcmp(key, "maxDelay")) {
+            delay = val_2_integer(val);
+        }
+    }
+
+    if (batch < 0 || batch > DEVICE_BATCH_VALUES_MAX || delay < 0 || delay > UINT16_MAX) {
+        return -CUPKEE_EINVAL;
+    }
+
+    device_batch_release(dev->id);
+    if (batch < 2) {
+        return CUPKEE_OK;
+    }
+
+    b = cupkee_malloc(sizeof(device_batch_t));
+    if (!b) {
+        return -CUPKEE_ERESOURCE;
+    }
+    b->timer = NULL;
+    b->dev_id = dev->id;
+    b->width = 0;
+    b->batch = batch;
+    b->count = 0;
+    b->max_delay = delay;
+    b->due = 0;
+    b->values = NULL;
+
+    b->next = device_batch_head;
+    device_batch_head = b;
+
+    return CUPKEE_OK;
+}
+
+static void device_batch_flush(device_batch_t *b, env_t *env, val_t *handle)
+{
+    int i, n = b->count * b->width;
+    array_t *list;
+    val_t args[2];
+
+    device_batch_timer_stop(b);
+    if (!n) {
+        return;
+    }
+
+    // samples in one flat array, width values each
+    list = _array_create(env, n);
+    if (!list) {
+        b->count = 0;
+        shell_do_callback_error(env, handle, -CUPKEE_ERESOURCE);
+        return;
+    }
+    for (i = 0; i < n; i++) {
+        *_array_elem(list, i) = b->values[i];
+    }
+
+    val_set_array(args, (intptr_t) list);
+    val_set_number(args + 1, b->count);
+    b->count = 0;
+
+    shell_do_callback(env, handle, 2, args);
+}
+
+static void device_batch_due(cupkee_event_emitter_t *emitter, uint8_t id)
+{
+    device_batch_t *b = device_batch_find(id);
+    cupkee_device_t *dev = cupkee_device_block(id);
+    val_t *handle;
+
+    (void) emitter;
+
+    // flushed by a data event come first already
+    if (!b || !b->due || !dev || !cupkee_device_is_enabled(dev)) {
+        return;
+    }
+
+    b->due = 0;
+    handle = device_event_handle_get(dev, DEVICE_EVENT_DATA);
+    if (handle) {
+        device_batch_flush(b, cupkee_shell_env(), handle);
+    }
+}
+
+static void device_batch_due_post(device_batch_t *b)
+{
+    if (!device_batch_emitter.handle) {
+        cupkee_event_emitter_init(&device_batch_emitter, device_batch_due);
+    }
+
+    b->due = 1;
+    cupkee_event_emitter_emit(&device_batch_emitter, b->dev_id);
+}
+
+// No JS here, handler may release the batch. Flush on the due event posted
+static void device_batch_timeout(int drop, void *param)
+{
+    device_batch_t *b = (device_batch_t *)param;
+
+    if (!drop) {
+        device_batch_due_post(b);
+    } else
+    if (b->timer) {
+        // dropped by others (clearTimeout), not by batch itself
+        b->timer = NULL;
+        if (!b->due && b->count) {
+            device_batch_due_post(b);
+        }
+    }
+}
+
+static int device_batch_width(device_batch_t *b, int width)
+{
+    if (width < 1 || width > DEVICE_BATCH_VALUES_MAX) {
+        return -CUPKEE_EINVAL;
+    }
+
+    if (width != b->width) {
+        // device reconfigured, samples cached in old shape dropped
+        b->count = 0;
+        if (b->values) {
+            cupkee_free(b->values);
+        }
+        b->values = cupkee_malloc(DEVICE_BATCH_VALUES_MAX * sizeof(val_t));
+        b->width = b->values ? width : 0;
+    }
+
+    return b->values ? CUPKEE_OK : -CUPKEE_ERESOURCE;
+}
+
+static int device_batch_take(cupkee_device_t *dev, device_batch_t *b, env_t *env, val_t *handle)
+{
+    uint32_t data;
+    val_t *values;
+    int i, width, status;
+
+    status = cupkee_device_get(dev, -1, &data);
+    if (status > 0) {
+        width = 1;
+    } else
+    if (status == 0 && dev->driver->size) {
+        width = dev->driver->size(dev->instance);
+    } else {
+        return -CUPKEE_EINVAL;
+    }
+
+    if (device_batch_width(b, width)) {
+        return -CUPKEE_ERESOURCE;
+    }
+
+    values = b->values + b->count * width;
+    if (status > 0) {
+        val_set_number(values, data);
+    } else {
+        for (i = 0; i < width; i++) {
+            if (cupkee_device_get(dev, i, &data) > 0) {
+                val_set_number(values + i, data);
+            } else {
+                val_set_undefined(values + i);
+            }
+        }
+    }
+    b->count++;
+
+    if (b->count >= b->batch || (b->count + 1) * width > DEVICE_BATCH_VALUES_MAX) {
+        device_batch_flush(b, env, handle);
+    } else
+    if (b->max_delay && !b->timer) {
+        b->timer = cupkee_timer_register(b->max_delay, 0, device_batch_timeout, b);
+    }
+
+    return CUPKEE_OK;
+}
+
 static void device_map_data_proc(cupkee_device_t *dev, env_t *env, val_t *handle)
 {
+    device_batch_t *b = device_batch_find(dev->id);
     val_t info;
 
+    if (b) {
+        int due = b->due;
+
+        if (CUPKEE_OK == device_batch_take(dev, b, env, handle)) {
+            // deadline passed, flush with this sample, the due event become no-op.
+            // Handler may release the batch, find it again
+            if (due && (b = device_batch_find(dev->id)) != NULL && b->due) {
+                b->due = 0;
+                device_batch_flush(b, env, handle);
+            }
+            return;
+        }
+    }
+
     device_get_all(dev, env, &info);
 
     shell_do_callback(env, handle, 1, &info);
@@ -404,6 +690,7 @@ val_t native_device_destroy(env_t *env, int ac, val_t *av)
     }
 
     device_event_handle_release(dev);
+    device_batch_release(dev->id);
     if (CUPKEE_OK == cupkee_device_release(dev)) {
         return VAL_TRUE;
     } else {
@@ -519,6 +806,15 @@ val_t native_device_write(env_t *env, int ac, val_t *av)
         return VAL_FALSE;
     }
 
+    if (ac && val_is_array(av)) {
+        // parts go to device in one write, without joining them
+        data = av++; ac--;
+        if ((n = device_write_parts(dev, data)) < 0) {
+            err = n;
+        }
+        ptr = NULL;
+        size = 0;
+    } else
     if (ac < 1 || (ptr = cupkee_val2data(av, &size)) == NULL) {
         err = -CUPKEE_EINVAL;
     } else {
@@ -549,13 +845,15 @@ val_t native_device_write(env_t *env, int ac, val_t *av)
         return VAL_FALSE;
     }
 
-    if (n > 0 && offset < size) {
-        if (offset + n > size) {
-            n = size - offset;
+    if (ptr) {
+        if (n > 0 && offset < size) {
+            if (offset + n > size) {
+                n = size - offset;
+            }
+            n = cupkee_device_write(dev, n, ptr + offset);
+        } else {
+            n = 0;
         }
-        n = cupkee_device_write(dev, n, ptr + offset);
-    } else {
-        n = 0;
     }
 
     if (ac) {
@@ -640,6 +938,17 @@ val_t native_device_listen(env_t *env, int ac, val_t *av)
         return VAL_FALSE;
     }
 
+    // options: {batch: samples, maxDelay: ms}
+    if (event_id == DEVICE_EVENT_DATA) {
+        if (ac > 2 && val_is_object(av + 2)) {
+            if (device_batch_setup(dev, av + 2)) {
+                return VAL_FALSE;
+            }
+        } else {
+            device_batch_release(dev->id);
+        }
+    }
+
     if (CUPKEE_OK == device_event_handle_set(dev, event_id, callback)) {
         return VAL_TRUE;
     } else {
@@ -667,6 +976,9 @@ val_t native_device_ignore(env_t *env, int ac, val_t *av)
 
         set->handles[event_id] = 0;
         shell_reference_release(shell_reference_ptr(ref_id));
+        if (event_id == DEVICE_EVENT_DATA) {
+            device_batch_release(dev->id);
+        }
 
         return VAL_TRUE;
     } else {
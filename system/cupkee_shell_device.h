@@ -30,7 +30,8 @@ SOFTWARE.
 #define DEVICE_PIN_CONF_NUM             0
 #define DEVICE_PIN_CONF_START           1
 #define DEVICE_PIN_CONF_DIR             2
-#define DEVICE_PIN_CONF_MAX             3
+#define DEVICE_PIN_CONF_DEBOUNCE        3
+#define DEVICE_PIN_CONF_MAX             4
 
 #define DEVICE_UART_CONF_BAUDRATE       0
 #define DEVICE_UART_CONF_DATABITS       1
@@ -40,7 +41,12 @@ SOFTWARE.
 
 #define DEVICE_ADC_CONF_CHANNELS        0
 #define DEVICE_ADC_CONF_INTERVAL        1
-#define DEVICE_ADC_CONF_MAX             2
+#define DEVICE_ADC_CONF_OVERSAMPLE      2
+#define DEVICE_ADC_CONF_DECIMATE        3
+#define DEVICE_ADC_CONF_DEADBAND        4
+#define DEVICE_ADC_CONF_RATE            5
+#define DEVICE_ADC_CONF_BLOCK           6
+#define DEVICE_ADC_CONF_MAX             7
 
 #define DEVICE_PWM_CONF_CHANNELS        0
 #define DEVICE_PWM_CONF_POLARITY        1
@@ -53,7 +59,8 @@ SOFTWARE.
 
 #define DEVICE_TIMER_CONF_CHANNELS      0
 #define DEVICE_TIMER_CONF_POLARITY      1
-#define DEVICE_TIMER_CONF_MAX           2
+#define DEVICE_TIMER_CONF_DEPTH         2
+#define DEVICE_TIMER_CONF_MAX           3
 
 #define DEVICE_COUNTER_CONF_CHANNELS    0
 #define DEVICE_COUNTER_CONF_POLARITY    1
@@ -63,6 +70,13 @@ SOFTWARE.
 #define DEVICE_I2C_CONF_SPEED           0
 #define DEVICE_I2C_CONF_ADDRESS         1
 
+#define DEVICE_SPI_CONF_SPEED           0
+#define DEVICE_SPI_CONF_MODE            1
+#define DEVICE_SPI_CONF_ORDER           2
+#define DEVICE_SPI_CONF_DIR             3
+#define DEVICE_SPI_CONF_SELECT          4
+#define DEVICE_SPI_CONF_MAX             5
+
 const cupkee_device_desc_t *cupkee_device_query_by_name(const char *name);
 const cupkee_device_desc_t *cupkee_device_query_by_type(uint16_t type);
 const cupkee_device_desc_t *cupkee_device_query_by_index(int i);
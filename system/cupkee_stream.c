@@ -49,12 +49,119 @@ static inline void stream_tx_request(cupkee_stream_t *s) {
     s->_write(s);
 }
 
+static inline void stream_stat_out(cupkee_stream_t *s, int n) {
+    if (s->stat && n > 0) {
+        s->stat->bytes_out += n;
+    }
+}
+
+static inline void stream_stat_peak(uint16_t *peak, void *cache) {
+    size_t len = cupkee_buffer_length(cache);
+
+    if (len > *peak) {
+        *peak = len;
+    }
+}
+
+static void stream_block(cupkee_stream_t *s, uint8_t flag)
+{
+    if (s->flags & flag) {
+        return;
+    }
+
+    s->flags |= flag;
+    if (s->stat) {
+        if (flag == CUPKEE_STREAM_FL_RX_BLOCKED) {
+            s->stat->rx_blocks++;
+            s->stat->rx_block_from = _cupkee_systicks;
+        } else {
+            s->stat->tx_blocks++;
+            s->stat->tx_block_from = _cupkee_systicks;
+        }
+    }
+}
+
+static void stream_unblock(cupkee_stream_t *s, uint8_t flag)
+{
+    if (!(s->flags & flag)) {
+        return;
+    }
+
+    s->flags &= ~flag;
+    if (s->stat) {
+        if (flag == CUPKEE_STREAM_FL_RX_BLOCKED) {
+            s->stat->rx_block_ticks += _cupkee_systicks - s->stat->rx_block_from;
+        } else {
+            s->stat->tx_block_ticks += _cupkee_systicks - s->stat->tx_block_from;
+        }
+    }
+}
+
+static void stream_stat_cached(cupkee_stream_t *s, int n, void *cache)
+{
+    cupkee_stream_t *c = s->consumer;
+
+    if (n <= 0) {
+        return;
+    }
+
+    if (s->stat) {
+        s->stat->bytes_in += n;
+        if (!c) {
+            stream_stat_peak(&s->stat->rx_peak, cache);
+        }
+    }
+    if (c && c->stat) {
+        c->stat->bytes_in += n;
+        stream_stat_peak(&c->stat->tx_peak, cache);
+    }
+}
+
+static cupkee_stream_t *stream_retain_head = NULL;
+
+// cache in use, restart the idle count
+static inline void stream_retain_touch(cupkee_stream_t *s)
+{
+    if (s->retain_wait) {
+        s->retain_stamp = _cupkee_systicks;
+    }
+}
+
+static void *stream_cache_alloc(cupkee_stream_t *s, size_t size)
+{
+    void *b = s->cache_spare;
+
+    stream_retain_touch(s);
+
+    if (b && cupkee_buffer_capacity(b) >= size) {
+        s->cache_spare = NULL;
+        return b;
+    }
+
+    b = cupkee_buffer_alloc(size);
+    if (!b && s->stat) {
+        s->stat->alloc_fails++;
+    }
+    return b;
+}
+
+// Give back a cache buffer, keep it as spare if stream retain cache
+static void stream_cache_drop(cupkee_stream_t *s, void *b)
+{
+    if (s->retain_wait && !s->cache_spare) {
+        cupkee_buffer_reset(b);
+        s->cache_spare = b;
+    } else {
+        cupkee_buffer_release(b);
+    }
+}
+
 static inline void *stream_tx_cache(cupkee_stream_t *s)
 {
     if (s->tx_buf) {
         return s->tx_buf;
     } else {
-        return (s->tx_buf = cupkee_buffer_alloc(s->tx_size_max));
+        return (s->tx_buf = stream_cache_alloc(s, s->tx_size_max));
     }
 }
 
@@ -65,16 +172,113 @@ static void *stream_rx_cache(cupkee_stream_t *s)
         if (c->tx_buf) {
             return c->tx_buf;
         } else {
-            return (c->tx_buf = cupkee_buffer_alloc(c->tx_size_max));
+            return (c->tx_buf = stream_cache_alloc(c, c->tx_size_max));
         }
     } else {
         if (s->rx_buf) {
             return s->rx_buf;
         } else {
-            return (s->rx_buf = cupkee_buffer_alloc(s->rx_size_max));
+            return (s->rx_buf = stream_cache_alloc(s, s->rx_size_max));
+        }
+    }
+
+}
+
+// Release spare and empty caches, return number of blocks released
+static int stream_cache_shrink(cupkee_stream_t *s)
+{
+    int n = 0;
+
+    if (s->cache_spare) {
+        cupkee_buffer_release(s->cache_spare);
+        s->cache_spare = NULL;
+        n++;
+    }
+    if (s->rx_buf && cupkee_buffer_is_empty(s->rx_buf)) {
+        cupkee_buffer_release(s->rx_buf);
+        s->rx_buf = NULL;
+        n++;
+    }
+    if (s->tx_buf && cupkee_buffer_is_empty(s->tx_buf)) {
+        cupkee_buffer_release(s->tx_buf);
+        s->tx_buf = NULL;
+        n++;
+    }
+    return n;
+}
+
+static int stream_reclaim(size_t n)
+{
+    cupkee_stream_t *s = stream_retain_head;
+    int released = 0;
+
+    (void) n;
+
+    while (s) {
+        released += stream_cache_shrink(s);
+        s = s->retain_next;
+    }
+    return released;
+}
+
+static void stream_retain_remove(cupkee_stream_t *s)
+{
+    cupkee_stream_t **pp = &stream_retain_head;
+
+    while (*pp) {
+        if (*pp == s) {
+            *pp = s->retain_next;
+            break;
+        }
+        pp = &(*pp)->retain_next;
+    }
+    s->retain_next = NULL;
+    s->retain_wait = 0;
+}
+
+// Hand over buffer to cache slot: take ownership if cache is empty,
+// else copy when it fits, or refuse. Never let the cache grow over max.
+static int stream_cache_adopt(cupkee_stream_t *s, void **slot, void *data, int max)
+{
+    void *cache = *slot;
+    int n = cupkee_buffer_length(data);
+
+    if (n <= 0 || n > max) {
+        return -CUPKEE_EINVAL;
+    }
+
+    if (!cache || cupkee_buffer_is_empty(cache)) {
+        if (cache) {
+            stream_cache_drop(s, cache);
         }
+        *slot = data;
+    } else
+    if ((int)cupkee_buffer_space(cache) >= n &&
+        (int)cupkee_buffer_length(cache) + n <= max) {
+        cupkee_buffer_move(cache, data, n);
+        cupkee_buffer_release(data);
+    } else {
+        return 0;
     }
+    stream_retain_touch(s);
+
+    return n;
+}
+
+static inline int stream_rx_over_high(cupkee_stream_t *s, void *cache)
+{
+    uint16_t high = s->consumer ? s->consumer->tx_high : s->rx_high;
+
+    return cupkee_buffer_is_full(cache) || cupkee_buffer_length(cache) >= high;
+}
 
+static void stream_watermark_default(cupkee_stream_t *s)
+{
+    // Full cache block, any space resume
+    s->rx_high = s->rx_size_max;
+    s->rx_low  = s->rx_size_max ? s->rx_size_max - 1 : 0;
+    s->tx_high = s->tx_size_max;
+    s->tx_low  = s->tx_size_max ? s->tx_size_max - 1 : 0;
 }
 
 static void stream_init(cupkee_stream_t *s, cupkee_event_emitter_t *emitter, uint8_t flags)
@@ -97,20 +301,108 @@ static inline void stream_data(cupkee_stream_t *s)
 
 static inline void stream_drain(cupkee_stream_t *s)
 {
-    s->flags &= ~CUPKEE_STREAM_FL_TX_BLOCKED;
+    stream_unblock(s, CUPKEE_STREAM_FL_TX_BLOCKED);
     if (s->producer) {
-        s->producer->flags &= ~CUPKEE_STREAM_FL_RX_BLOCKED;
+        stream_unblock(s->producer, CUPKEE_STREAM_FL_RX_BLOCKED);
         stream_rx_request(s->producer, s->tx_size_max);
     } else {
         stream_event_emit(s, CUPKEE_EVENT_STREAM_DRAIN);
     }
 }
 
+static inline int stream_tx_cached(cupkee_stream_t *s)
+{
+    int n = s->tx_buf ? cupkee_buffer_length(s->tx_buf) : 0;
+
+    if (s->tx_share) {
+        n += cupkee_buffer_length(s->tx_share) - s->tx_share_pos;
+    }
+    return n;
+}
+
+static void stream_flush_timeout(int drop, void *param)
+{
+    cupkee_stream_t *s = (cupkee_stream_t *)param;
+
+    if (drop) {
+        s->tx_flush_timer = NULL;
+    }
+    // wake up, or dropped by others (clearTimeout) with data still held
+    if (s->tx_hold && !s->tx_cork) {
+        s->tx_hold = 0;
+        stream_tx_request(s);
+    }
+}
+
+static void stream_tx_flush(cupkee_stream_t *s)
+{
+    s->tx_hold = 0;
+    if (s->tx_flush_timer) {
+        cupkee_timer_unregister(s->tx_flush_timer);
+    }
+    stream_tx_request(s);
+}
+
+static int stream_tx_should_hold(cupkee_stream_t *s)
+{
+    if (s->tx_cork) {
+        return 1;
+    }
+    if (!s->tx_flush_size && !s->tx_flush_wait) {
+        return 0;
+    }
+    return !s->tx_flush_size || stream_tx_cached(s) < s->tx_flush_size;
+}
+
+// Kick driver for new data, or hold it to coalesce small writes
+static void stream_tx_kick(cupkee_stream_t *s, int idle)
+{
+    if (!idle && !s->tx_hold) {
+        return;
+    }
+
+    if (!stream_tx_should_hold(s)) {
+        stream_tx_flush(s);
+        return;
+    }
+
+    s->tx_hold = 1;
+    if (s->tx_flush_wait && !s->tx_flush_timer) {
+        s->tx_flush_timer = cupkee_timer_register(s->tx_flush_wait, 0, stream_flush_timeout, s);
+    }
+}
+
+static void stream_share_release(cupkee_stream_t *s)
+{
+    cupkee_buffer_release(s->tx_share);
+    s->tx_share = NULL;
+    s->tx_share_pos = 0;
+}
+
+static int stream_share_take(cupkee_stream_t *s, size_t n, void *data)
+{
+    int cnt = cupkee_buffer_read_array(s->tx_share, s->tx_share_pos, n, 1, 0, data);
+
+    if (cnt > 0) {
+        s->tx_share_pos += cnt;
+    } else {
+        cnt = 0;
+    }
+
+    if (s->tx_share_pos >= cupkee_buffer_length(s->tx_share)) {
+        stream_share_release(s);
+    }
+    return cnt;
+}
+
 static void stream_finish(cupkee_stream_t *s)
 {
+    if (s->tx_share) {
+        return;
+    }
     if (s->tx_buf) {
         if (cupkee_buffer_is_empty(s->tx_buf)) {
-            cupkee_buffer_release(s->tx_buf);
+            stream_cache_drop(s, s->tx_buf);
             s->tx_buf = NULL;
         } else {
             return;
@@ -123,7 +415,7 @@ static void stream_end(cupkee_stream_t *s)
 {
     if (s->rx_buf) {
         if (cupkee_buffer_is_empty(s->rx_buf)) {
-            cupkee_buffer_release(s->rx_buf);
+            stream_cache_drop(s, s->rx_buf);
             s->rx_buf = NULL;
         } else {
             return;
@@ -146,6 +438,7 @@ int cupkee_stream_init_readable(
 
     s->rx_size_max = buf_max_size;
     s->_read = _read;
+    stream_watermark_default(s);
 
     return CUPKEE_OK;
 }
@@ -164,6 +457,7 @@ int cupkee_stream_init_writable(
 
     s->tx_size_max = buf_max_size;
     s->_write = _write;
+    stream_watermark_default(s);
 
     return CUPKEE_OK;
 }
@@ -186,6 +480,37 @@ int cupkee_stream_init_duplex(
     s->tx_size_max = tx_buf_max_size;
     s->_read = _read;
     s->_write = _write;
+    stream_watermark_default(s);
+
+    return CUPKEE_OK;
+}
+
+static void stream_transform_read(cupkee_stream_t *s, size_t n)
+{
+    (void) n;
+
+    // reader want more, run transform again
+    s->_write(s);
+}
+
+int cupkee_stream_init_transform(
+   cupkee_stream_t *s,
+   cupkee_event_emitter_t *emitter,
+   size_t rx_buf_max_size,
+   size_t tx_buf_max_size,
+   void (*_transform)(cupkee_stream_t *s)
+) {
+    if (!s || !_transform) {
+        return -CUPKEE_EINVAL;
+    }
+
+    stream_init(s, emitter, CUPKEE_STREAM_FL_WRITABLE | CUPKEE_STREAM_FL_READABLE | CUPKEE_STREAM_FL_TRANSFORM);
+
+    s->rx_size_max = rx_buf_max_size;
+    s->tx_size_max = tx_buf_max_size;
+    s->_read = stream_transform_read;
+    s->_write = _transform;
+    stream_watermark_default(s);
 
     return CUPKEE_OK;
 }
@@ -200,6 +525,22 @@ int cupkee_stream_deinit(cupkee_stream_t *s)
         if (s->tx_buf) {
             cupkee_buffer_release(s->tx_buf);
         }
+        if (s->tx_share) {
+            stream_share_release(s);
+        }
+        if (s->tx_flush_timer) {
+            s->tx_hold = 0;
+            cupkee_timer_unregister(s->tx_flush_timer);
+        }
+        if (s->retain_wait) {
+            stream_retain_remove(s);
+        }
+        if (s->cache_spare) {
+            cupkee_buffer_release(s->cache_spare);
+        }
+        if (s->stat) {
+            cupkee_free(s->stat);
+        }
     }
     return 0;
 }
@@ -234,6 +575,10 @@ void cupkee_stream_shutdown(cupkee_stream_t *s, uint8_t flags)
     }
     if (stream_is_writable(s) && flags & CUPKEE_STREAM_FL_WRITABLE) {
         s->flags |= CUPKEE_STREAM_FL_TX_SHUTDOWN;
+        if (s->tx_hold) {
+            s->tx_cork = 0;
+            stream_tx_flush(s);
+        }
         stream_finish(s);
     }
 }
@@ -262,6 +607,187 @@ int cupkee_stream_tx_cache_space(cupkee_stream_t *s)
     return -CUPKEE_EINVAL;
 }
 
+void cupkee_stream_cork(cupkee_stream_t *s)
+{
+    if (stream_is_writable(s) && s->tx_cork < UINT8_MAX) {
+        s->tx_cork++;
+    }
+}
+
+void cupkee_stream_uncork(cupkee_stream_t *s)
+{
+    if (stream_is_writable(s) && s->tx_cork) {
+        if (--s->tx_cork == 0 && s->tx_hold) {
+            stream_tx_kick(s, 1);
+        }
+    }
+}
+
+void cupkee_stream_flush(cupkee_stream_t *s)
+{
+    if (stream_is_writable(s) && s->tx_hold) {
+        stream_tx_flush(s);
+    }
+}
+
+int cupkee_stream_set_flush(cupkee_stream_t *s, size_t size, uint32_t wait)
+{
+    if (!stream_is_writable(s) || size > s->tx_size_max || wait > UINT16_MAX) {
+        return -CUPKEE_EINVAL;
+    }
+
+    s->tx_flush_size = size;
+    s->tx_flush_wait = wait;
+
+    // policy changed, check held data again
+    if (s->tx_hold) {
+        stream_tx_kick(s, 1);
+    }
+
+    return CUPKEE_OK;
+}
+
+int cupkee_stream_set_retain(cupkee_stream_t *s, uint32_t wait)
+{
+    if (!s || wait > UINT16_MAX) {
+        return -CUPKEE_EINVAL;
+    }
+
+    if (!wait) {
+        if (s->retain_wait) {
+            stream_retain_remove(s);
+        }
+        if (s->cache_spare) {
+            cupkee_buffer_release(s->cache_spare);
+            s->cache_spare = NULL;
+        }
+        return CUPKEE_OK;
+    }
+
+    if (!s->retain_wait) {
+        int err = cupkee_memory_reclaim_register(stream_reclaim);
+
+        if (err) {
+            return err;
+        }
+        s->retain_next = stream_retain_head;
+        stream_retain_head = s;
+    }
+    s->retain_wait = wait;
+    s->retain_stamp = _cupkee_systicks;
+
+    return CUPKEE_OK;
+}
+
+void cupkee_stream_sync(uint32_t systicks)
+{
+    cupkee_stream_t *s = stream_retain_head;
+
+    while (s) {
+        if (systicks - s->retain_stamp >= s->retain_wait) {
+            stream_cache_shrink(s);
+            s->retain_stamp = systicks;
+        }
+        s = s->retain_next;
+    }
+}
+
+int cupkee_stream_stat_enable(cupkee_stream_t *s, int enable)
+{
+    if (!s) {
+        return -CUPKEE_EINVAL;
+    }
+
+    if (!enable) {
+        if (s->stat) {
+            cupkee_free(s->stat);
+            s->stat = NULL;
+        }
+        return CUPKEE_OK;
+    }
+
+    if (!s->stat) {
+        if (!(s->stat = cupkee_malloc(sizeof(cupkee_stream_stat_t)))) {
+            return -CUPKEE_ENOMEM;
+        }
+    }
+    memset(s->stat, 0, sizeof(cupkee_stream_stat_t));
+
+    // already blocked, count from now
+    s->stat->rx_block_from = _cupkee_systicks;
+    s->stat->tx_block_from = _cupkee_systicks;
+
+    return CUPKEE_OK;
+}
+
+int cupkee_stream_stat_get(cupkee_stream_t *s, cupkee_stream_stat_t *stat)
+{
+    if (!s || !stat) {
+        return -CUPKEE_EINVAL;
+    }
+
+    if (!s->stat) {
+        return -CUPKEE_ENOTENABLED;
+    }
+
+    *stat = *s->stat;
+
+    // include the block in progress
+    if (s->flags & CUPKEE_STREAM_FL_RX_BLOCKED) {
+        stat->rx_block_ticks += _cupkee_systicks - stat->rx_block_from;
+    }
+    if (s->flags & CUPKEE_STREAM_FL_TX_BLOCKED) {
+        stat->tx_block_ticks += _cupkee_systicks - stat->tx_block_from;
+    }
+
+    return CUPKEE_OK;
+}
+
+void cupkee_stream_block(cupkee_stream_t *s, uint8_t flags)
+{
+    if (flags & CUPKEE_STREAM_FL_RX_BLOCKED) {
+        stream_block(s, CUPKEE_STREAM_FL_RX_BLOCKED);
+    }
+    if (flags & CUPKEE_STREAM_FL_TX_BLOCKED) {
+        stream_block(s, CUPKEE_STREAM_FL_TX_BLOCKED);
+    }
+}
+
+void cupkee_stream_unblock(cupkee_stream_t *s, uint8_t flags)
+{
+    if (flags & CUPKEE_STREAM_FL_RX_BLOCKED) {
+        stream_unblock(s, CUPKEE_STREAM_FL_RX_BLOCKED);
+    }
+    if (flags & CUPKEE_STREAM_FL_TX_BLOCKED) {
+        stream_unblock(s, CUPKEE_STREAM_FL_TX_BLOCKED);
+    }
+}
+
+int cupkee_stream_set_watermark(cupkee_stream_t *s, uint8_t flags, size_t high, size_t low)
+{
+    if (!s || low >= high) {
+        return -CUPKEE_EINVAL;
+    }
+
+    if (flags & CUPKEE_STREAM_FL_READABLE) {
+        if (!stream_is_readable(s) || high > s->rx_size_max) {
+            return -CUPKEE_EINVAL;
+        }
+        s->rx_high = high;
+        s->rx_low  = low;
+    }
+
+    if (flags & CUPKEE_STREAM_FL_WRITABLE) {
+        if (!stream_is_writable(s) || high > s->tx_size_max) {
+            return -CUPKEE_EINVAL;
+        }
+        s->tx_high = high;
+        s->tx_low  = low;
+    }
+
+    return CUPKEE_OK;
+}
+
 void cupkee_stream_set_error(cupkee_stream_t *s, uint8_t code)
 {
     if (s) {
@@ -283,7 +809,7 @@ int cupkee_stream_get_error(cupkee_stream_t *s)
 
 int cupkee_stream_push(cupkee_stream_t *s, size_t n, const void *data)
 {
-    int cnt = 0;
+    int empty, cnt = 0;
     void *cache;
 
     if (!stream_is_readable(s) || !n || !data) {
@@ -298,30 +824,43 @@ int cupkee_stream_push(cupkee_stream_t *s, size_t n, const void *data)
         return -CUPKEE_ENOMEM;
     }
 
-    if (s->rx_state == CUPKEE_STREAM_STATE_FLOWING && cupkee_buffer_is_empty(cache)) {
-        stream_data(s);
-    }
-
+    empty = cupkee_buffer_is_empty(cache);
     cnt = cupkee_buffer_give(cache, n, data);
-    if (cupkee_buffer_is_full(cache)) {
-        s->flags |= CUPKEE_STREAM_FL_RX_BLOCKED;
+    stream_retain_touch(s->consumer ? s->consumer : s);
+    stream_stat_cached(s, cnt, cache);
+    if (stream_rx_over_high(s, cache)) {
+        stream_block(s, CUPKEE_STREAM_FL_RX_BLOCKED);
         if (s->consumer) {
-            s->consumer->flags |= CUPKEE_STREAM_FL_TX_BLOCKED;
+            stream_block(s->consumer, CUPKEE_STREAM_FL_TX_BLOCKED);
         }
     }
 
+    // notify after data cached, consumer may take it at once
+    if (cnt > 0 && empty && s->rx_state == CUPKEE_STREAM_STATE_FLOWING) {
+        stream_data(s);
+    }
+
     return cnt;
 }
 
 int cupkee_stream_pull(cupkee_stream_t *s, size_t n, void *data)
 {
-    if (stream_is_writable(s) && s->tx_buf && n && data) {
-        int cnt = cupkee_buffer_take(s->tx_buf, n, data);
+    if (stream_is_writable(s) && (s->tx_buf || s->tx_share) && n && data) {
+        int cnt = 0;
+
+        if (s->tx_share) {
+            cnt = stream_share_take(s, n, data);
+        }
+        if (s->tx_buf && cnt < (int) n) {
+            cnt += cupkee_buffer_take(s->tx_buf, n - cnt, (uint8_t *)data + cnt);
+        }
+        stream_stat_out(s, cnt);
 
         if (s->flags & CUPKEE_STREAM_FL_TX_SHUTDOWN) {
             stream_finish(s);
         } else
-        if (cnt > 0 && (s->flags & CUPKEE_STREAM_FL_TX_BLOCKED)) {
+        if (cnt > 0 && (s->flags & CUPKEE_STREAM_FL_TX_BLOCKED) &&
+            stream_tx_cached(s) <= s->tx_low) {
             stream_drain(s);
         }
         return cnt;
@@ -384,11 +923,13 @@ int cupkee_stream_read(cupkee_stream_t *s, size_t n, void *buf)
     }
 
     cnt = cupkee_buffer_take(s->rx_buf, n, buf);
+    stream_stat_out(s, cnt);
     if (s->flags & CUPKEE_STREAM_FL_RX_SHUTDOWN) {
         stream_end(s);
     } else
-    if (cnt >0 && s->flags & CUPKEE_STREAM_FL_RX_BLOCKED) {
-        s->flags &= ~CUPKEE_STREAM_FL_RX_BLOCKED;
+    if (cnt > 0 && (s->flags & CUPKEE_STREAM_FL_RX_BLOCKED) &&
+        cupkee_buffer_length(s->rx_buf) <= s->rx_low) {
+        stream_unblock(s, CUPKEE_STREAM_FL_RX_BLOCKED);
         stream_rx_request(s, cupkee_buffer_space(s->rx_buf));
     }
     return cnt;
@@ -412,14 +953,17 @@ int cupkee_stream_write(cupkee_stream_t *s, size_t n, const void *data)
     }
 
     cached = cupkee_buffer_give(cache, n, data);
-    if (cached != (int) n) {
-        s->flags |= CUPKEE_STREAM_FL_TX_BLOCKED;
+    stream_retain_touch(s);
+    if (s->stat) {
+        s->stat->bytes_in += cached;
+        stream_stat_peak(&s->stat->tx_peak, cache);
     }
-
-    if (cached == (int) cupkee_buffer_length(cache)) {
-        stream_tx_request(s);
+    if (cached != (int) n || cupkee_buffer_length(cache) > s->tx_high) {
+        stream_block(s, CUPKEE_STREAM_FL_TX_BLOCKED);
     }
 
+    stream_tx_kick(s, cached == (int) cupkee_buffer_length(cache));
+
     return cached;
 }
 
@@ -455,13 +999,166 @@ int cupkee_stream_unpipe(cupkee_stream_t *s)
     if (s->consumer) {
         stream_event_emit(s->consumer, CUPKEE_EVENT_STREAM_UNPIPE);
         s->consumer->producer = NULL;
+        s->consumer = NULL;
 
-        if (!s->rx_buf || !cupkee_buffer_is_full(s->rx_buf)) {
-            s->flags &= ~CUPKEE_STREAM_FL_RX_BLOCKED;
+        if (!s->rx_buf || !stream_rx_over_high(s, s->rx_buf)) {
+            stream_unblock(s, CUPKEE_STREAM_FL_RX_BLOCKED);
         }
-        s->consumer = NULL;
     }
     s->rx_state = CUPKEE_STREAM_STATE_PAUSED;
 
     return 0;
 }
+
+int cupkee_stream_push_buf(cupkee_stream_t *s, void *data)
+{
+    void **slot;
+    int empty, cnt;
+
+    if (!stream_is_readable(s) || !data) {
+        return -CUPKEE_EINVAL;
+    }
+
+    if (s->flags & (CUPKEE_STREAM_FL_RX_SHUTDOWN | CUPKEE_STREAM_FL_RX_BLOCKED)) {
+        return 0;
+    }
+
+    slot = s->consumer ? &s->consumer->tx_buf : &s->rx_buf;
+    empty = !*slot || cupkee_buffer_is_empty(*slot);
+
+    if (s->consumer) {
+        cnt = stream_cache_adopt(s->consumer, slot, data, s->consumer->tx_size_max);
+    } else {
+        cnt = stream_cache_adopt(s, slot, data, s->rx_size_max);
+    }
+    if (cnt < 0) {
+        return cnt;
+    }
+    stream_stat_cached(s, cnt, *slot);
+    if (!cnt || stream_rx_over_high(s, *slot)) {
+        stream_block(s, CUPKEE_STREAM_FL_RX_BLOCKED);
+        if (s->consumer) {
+            stream_block(s->consumer, CUPKEE_STREAM_FL_TX_BLOCKED);
+        }
+    }
+
+    if (cnt && empty && s->rx_state == CUPKEE_STREAM_STATE_FLOWING) {
+        stream_data(s);
+    }
+
+    return cnt;
+}
+
+void *cupkee_stream_pull_buf(cupkee_stream_t *s)
+{
+    void *buf;
+
+    if (!stream_is_writable(s)) {
+        return NULL;
+    }
+
+    if (s->tx_share) {
+        // shared chunk is read only, give a copy
+        int n = cupkee_buffer_length(s->tx_share) - s->tx_share_pos;
+
+        if (!(buf = cupkee_buffer_alloc(n))) {
+            if (s->stat) {
+                s->stat->alloc_fails++;
+            }
+            return NULL;
+        }
+        while (s->tx_share) {
+            const uint8_t *ptr;
+            int size = cupkee_buffer_segment(s->tx_share, s->tx_share_pos, &ptr);
+
+            cupkee_buffer_give(buf, size, ptr);
+            s->tx_share_pos += size;
+            if (s->tx_share_pos >= cupkee_buffer_length(s->tx_share)) {
+                stream_share_release(s);
+            }
+        }
+    } else
+    if (s->tx_buf && !cupkee_buffer_is_empty(s->tx_buf)) {
+        buf = s->tx_buf;
+        s->tx_buf = NULL;
+    } else {
+        return NULL;
+    }
+    stream_stat_out(s, cupkee_buffer_length(buf));
+
+    if (s->flags & CUPKEE_STREAM_FL_TX_SHUTDOWN) {
+        stream_finish(s);
+    } else
+    if (s->flags & CUPKEE_STREAM_FL_TX_BLOCKED) {
+        stream_drain(s);
+    }
+
+    return buf;
+}
+
+void *cupkee_stream_read_buf(cupkee_stream_t *s)
+{
+    void *buf;
+
+    if (!stream_is_readable(s)) {
+        return NULL;
+    }
+
+    if (s->rx_state == CUPKEE_STREAM_STATE_IDLE) {
+        s->rx_state = CUPKEE_STREAM_STATE_PAUSED;
+        stream_rx_request(s, s->rx_size_max);
+    }
+
+    if (!s->rx_buf || cupkee_buffer_is_empty(s->rx_buf)) {
+        stream_rx_request(s, s->rx_size_max);
+        return NULL;
+    }
+
+    buf = s->rx_buf;
+    s->rx_buf = NULL;
+    stream_stat_out(s, cupkee_buffer_length(buf));
+
+    if (s->flags & CUPKEE_STREAM_FL_RX_SHUTDOWN) {
+        stream_end(s);
+    } else
+    if (s->flags & CUPKEE_STREAM_FL_RX_BLOCKED) {
+        stream_unblock(s, CUPKEE_STREAM_FL_RX_BLOCKED);
+        stream_rx_request(s, s->rx_size_max);
+    }
+
+    return buf;
+}
+
+int cupkee_stream_write_buf(cupkee_stream_t *s, void *data)
+{
+    int cached;
+
+    if (!stream_is_writable(s) || !data) {
+        return -CUPKEE_EINVAL;
+    }
+
+    if (s->flags & CUPKEE_STREAM_FL_TX_SHUTDOWN) {
+        return 0;
+    }
+
+    cached = stream_cache_adopt(s, &s->tx_buf, data, s->tx_size_max);
+    if (cached < 0) {
+        return cached;
+    }
+    if (!cached) {
+        stream_block(s, CUPKEE_STREAM_FL_TX_BLOCKED);
+        return 0;
+    }
+
+    if (s->stat) {
+        s->stat->bytes_in += cached;
+        stream_stat_peak(&s->stat->tx_peak, s->tx_buf);
+    }
+    if (cupkee_buffer_length(s->tx_buf) > s->tx_high) {
+        stream_block(s, CUPKEE_STREAM_FL_TX_BLOCKED);
+    }
+
+    stream_tx_kick(s, cached == (int) cupkee_buffer_length(s->tx_buf));
+
+    return cached;
+}
@@ -0,0 +1,291 @@
+/*
+MIT License
+
+This file is part of cupkee project.
+
+Copyright (c) 2017 Lixing Ding <ding.lixing@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cupkee.h>
+
+#define FRAME_ST_DATA       0
+#define FRAME_ST_DISCARD    1
+#define FRAME_ST_ESCAPE     2   // slip: ESC received
+#define FRAME_ST_ZERO       3   // cobs: zero before next code
+#define FRAME_ST_HEAD       4   // length: wait high byte
+#define FRAME_ST_HEAD_LO    5   // length: wait low byte
+
+#define SLIP_END            0xC0
+#define SLIP_ESC            0xDB
+#define SLIP_ESC_END        0xDC
+#define SLIP_ESC_ESC        0xDD
+
+static inline uint8_t frame_state_init(cupkee_frame_stream_t *f)
+{
+    return f->type == CUPKEE_FRAME_LENGTH ? FRAME_ST_HEAD : FRAME_ST_DATA;
+}
+
+static void frame_drop(cupkee_frame_stream_t *f, uint8_t err)
+{
+    if (f->frame) {
+        cupkee_buffer_reset(f->frame);
+    }
+    // skip to next delimiter, or the rest of the length
+    f->state = FRAME_ST_DISCARD;
+
+    cupkee_stream_set_error(&f->stream, err);
+}
+
+static void frame_append(cupkee_frame_stream_t *f, uint8_t d)
+{
+    if (!f->frame && !(f->frame = cupkee_buffer_alloc(f->frame_max))) {
+        frame_drop(f, CUPKEE_ENOMEM);
+        return;
+    }
+
+    if (!cupkee_buffer_push(f->frame, d)) {
+        frame_drop(f, CUPKEE_EOVERFLOW);
+    }
+}
+
+static void frame_complete(cupkee_frame_stream_t *f)
+{
+    if (f->frame && !cupkee_buffer_is_empty(f->frame)) {
+        f->ready = f->frame;
+        f->frame = NULL;
+    }
+    f->state = frame_state_init(f);
+    f->expect = 0;
+}
+
+static void frame_decode_line(cupkee_frame_stream_t *f, uint8_t d)
+{
+    if (f->state == FRAME_ST_DISCARD) {
+        if (d == '\n') {
+            f->state = FRAME_ST_DATA;
+        }
+        return;
+    }
+
+    frame_append(f, d);
+    if (d == '\n') {
+        if (f->state == FRAME_ST_DATA) {
+            frame_complete(f);
+        } else {
+            f->state = FRAME_ST_DATA;
+        }
+    }
+}
+
+static void frame_decode_slip(cupkee_frame_stream_t *f, uint8_t d)
+{
+    if (d == SLIP_END) {
+        if (f->state == FRAME_ST_DISCARD) {
+            f->state = FRAME_ST_DATA;
+        } else {
+            frame_complete(f);
+        }
+        return;
+    }
+
+    if (f->state == FRAME_ST_ESCAPE) {
+        f->state = FRAME_ST_DATA;
+        if (d == SLIP_ESC_END) {
+            d = SLIP_END;
+        } else
+        if (d == SLIP_ESC_ESC) {
+            d = SLIP_ESC;
+        }
+        frame_append(f, d);
+    } else
+    if (f->state == FRAME_ST_DATA) {
+        if (d == SLIP_ESC) {
+            f->state = FRAME_ST_ESCAPE;
+        } else {
+            frame_append(f, d);
+        }
+    }
+}
+
+static void frame_decode_cobs(cupkee_frame_stream_t *f, uint8_t d)
+{
+    if (d == 0) {
+        if (f->state != FRAME_ST_DISCARD && f->expect) {
+            // frame cut inside a block
+            frame_drop(f, CUPKEE_EINVAL);
+        }
+        frame_complete(f);
+        return;
+    }
+
+    if (f->state == FRAME_ST_DISCARD) {
+        return;
+    }
+
+    if (f->expect) {
+        f->expect--;
+        frame_append(f, d);
+    } else {
+        // code byte
+        if (f->state == FRAME_ST_ZERO) {
+            frame_append(f, 0);
+        }
+        if (f->state != FRAME_ST_DISCARD) {
+            f->state = d == 0xFF ? FRAME_ST_DATA : FRAME_ST_ZERO;
+            f->expect = d - 1;
+        }
+    }
+}
+
+static void frame_decode_length(cupkee_frame_stream_t *f, uint8_t d)
+{
+    switch (f->state) {
+    case FRAME_ST_HEAD:
+        f->expect = d << 8;
+        f->state = FRAME_ST_HEAD_LO;
+        break;
+    case FRAME_ST_HEAD_LO:
+        f->expect |= d;
+        if (f->expect == 0) {
+            f->state = FRAME_ST_HEAD;
+        } else
+        if (f->expect > f->frame_max) {
+            frame_drop(f, CUPKEE_EOVERFLOW);
+        } else {
+            f->state = FRAME_ST_DATA;
+        }
+        break;
+    case FRAME_ST_DATA:
+        frame_append(f, d);
+        if (--f->expect == 0) {
+            if (f->state == FRAME_ST_DATA) {
+                frame_complete(f);
+            } else {
+                f->state = FRAME_ST_HEAD;
+            }
+        }
+        break;
+    default:
+        // discard rest of the overflow frame
+        if (--f->expect == 0) {
+            f->state = FRAME_ST_HEAD;
+        }
+        break;
+    }
+}
+
+static int frame_deliver(cupkee_frame_stream_t *f)
+{
+    cupkee_stream_t *s = &f->stream;
+    int n;
+
+    // one frame each time for reader, consumer in pipe take it as bytes
+    if (!s->consumer && cupkee_stream_readable(s)) {
+        cupkee_stream_block(s, CUPKEE_STREAM_FL_RX_BLOCKED);
+        return 0;
+    }
+
+    n = cupkee_stream_push_buf(s, f->ready);
+    if (n > 0) {
+        f->ready = NULL;
+        return 1;
+    }
+    if (n < 0) {
+        // frame can never fit the consumer: drop it, go on with the next
+        cupkee_buffer_release(f->ready);
+        f->ready = NULL;
+        cupkee_stream_set_error(s, CUPKEE_EOVERFLOW);
+        return 1;
+    }
+    return 0;
+}
+
+static void frame_transform(cupkee_stream_t *s)
+{
+    cupkee_frame_stream_t *f = CUPKEE_CONTAINER_OF(s, cupkee_frame_stream_t, stream);
+    uint8_t d;
+
+    // pull may drain producer and call back here
+    if (f->busy) {
+        return;
+    }
+    f->busy = 1;
+
+    while (!f->ready || frame_deliver(f)) {
+        if (1 != cupkee_stream_pull(s, 1, &d)) {
+            break;
+        }
+
+        switch (f->type) {
+        case CUPKEE_FRAME_LINE:   frame_decode_line(f, d);   break;
+        case CUPKEE_FRAME_SLIP:   frame_decode_slip(f, d);   break;
+        case CUPKEE_FRAME_COBS:   frame_decode_cobs(f, d);   break;
+        default:                  frame_decode_length(f, d); break;
+        }
+    }
+
+    f->busy = 0;
+}
+
+int cupkee_frame_stream_init(
+    cupkee_frame_stream_t *f,
+    cupkee_event_emitter_t *emitter,
+    int type,
+    size_t frame_max,
+    size_t tx_buf_max_size
+) {
+    int err;
+
+    if (!f || type < 0 || type >= CUPKEE_FRAME_MAX || !frame_max || frame_max > UINT16_MAX) {
+        return -CUPKEE_EINVAL;
+    }
+
+    err = cupkee_stream_init_transform(&f->stream, emitter, frame_max, tx_buf_max_size, frame_transform);
+    if (err) {
+        return err;
+    }
+
+    f->type = type;
+    f->busy = 0;
+    f->frame_max = frame_max;
+    f->expect = 0;
+    f->frame = NULL;
+    f->ready = NULL;
+    f->state = frame_state_init(f);
+
+    return CUPKEE_OK;
+}
+
+int cupkee_frame_stream_deinit(cupkee_frame_stream_t *f)
+{
+    if (f) {
+        cupkee_stream_deinit(&f->stream);
+        if (f->frame) {
+            cupkee_buffer_release(f->frame);
+            f->frame = NULL;
+        }
+        if (f->ready) {
+            cupkee_buffer_release(f->ready);
+            f->ready = NULL;
+        }
+    }
+    return 0;
+}
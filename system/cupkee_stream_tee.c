@@ -0,0 +1,192 @@
+/*
+MIT License
+
+This file is part of cupkee project.
+
+Copyright (c) 2017 Lixing Ding <ding.lixing@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cupkee.h>
+
+static void tee_deliver(cupkee_tee_t *t)
+{
+    int i;
+
+    for (i = 0; i < t->num; i++) {
+        cupkee_stream_t *out = t->outputs[i];
+        uint8_t bit = 1 << i;
+
+        if (!(t->pending & bit)) {
+            continue;
+        }
+
+        if (!out->tx_share) {
+            int idle = !out->tx_buf || cupkee_buffer_is_empty(out->tx_buf);
+
+            out->tx_share = cupkee_mem_ref(t->chunk);
+            out->tx_share_pos = 0;
+            t->pending &= ~bit;
+
+            if (idle) {
+                out->_write(out);
+            }
+        } else
+        if (t->drop & bit) {
+            t->pending &= ~bit;
+            t->dropped += cupkee_buffer_length(t->chunk);
+        } else {
+            // slowest output hold the tee, until it drain
+            cupkee_stream_block(out, CUPKEE_STREAM_FL_TX_BLOCKED);
+        }
+    }
+}
+
+static void tee_run(cupkee_tee_t *t)
+{
+    while (1) {
+        if (t->chunk) {
+            tee_deliver(t);
+            if (t->pending) {
+                return;
+            }
+            cupkee_buffer_release(t->chunk);
+            t->chunk = NULL;
+        }
+
+        if (!t->num || !(t->chunk = cupkee_stream_pull_buf(&t->stream))) {
+            return;
+        }
+        t->pending = (1 << t->num) - 1;
+    }
+}
+
+static void tee_process(cupkee_stream_t *s)
+{
+    cupkee_tee_t *t = CUPKEE_CONTAINER_OF(s, cupkee_tee_t, stream);
+
+    // outputs may drain and call back here, run again after
+    if (t->busy) {
+        t->busy = 2;
+        return;
+    }
+
+    do {
+        t->busy = 1;
+        tee_run(t);
+    } while (t->busy == 2);
+
+    t->busy = 0;
+}
+
+static void tee_output_drain(cupkee_stream_t *s, size_t n)
+{
+    (void) n;
+
+    tee_process(s);
+}
+
+int cupkee_tee_init(cupkee_tee_t *t, cupkee_event_emitter_t *emitter, size_t buf_max_size)
+{
+    int err;
+
+    if (!t) {
+        return -CUPKEE_EINVAL;
+    }
+
+    err = cupkee_stream_init_writable(&t->stream, emitter, buf_max_size, tee_process);
+    if (err) {
+        return err;
+    }
+    // called when output drain
+    t->stream._read = tee_output_drain;
+
+    t->num = 0;
+    t->drop = 0;
+    t->pending = 0;
+    t->busy = 0;
+    t->dropped = 0;
+    t->chunk = NULL;
+
+    return CUPKEE_OK;
+}
+
+int cupkee_tee_deinit(cupkee_tee_t *t)
+{
+    if (t) {
+        while (t->num) {
+            cupkee_tee_remove(t, t->outputs[0]);
+        }
+        if (t->chunk) {
+            cupkee_buffer_release(t->chunk);
+            t->chunk = NULL;
+        }
+        cupkee_stream_deinit(&t->stream);
+    }
+    return 0;
+}
+
+int cupkee_tee_add(cupkee_tee_t *t, cupkee_stream_t *output, int drop)
+{
+    if (!t || !output || !(output->flags & CUPKEE_STREAM_FL_WRITABLE) || output->producer) {
+        return -CUPKEE_EINVAL;
+    }
+
+    if (t->num >= CUPKEE_TEE_OUTPUT_MAX) {
+        return -CUPKEE_EFULL;
+    }
+
+    // new output start from next chunk
+    if (drop) {
+        t->drop |= 1 << t->num;
+    }
+    t->outputs[t->num++] = output;
+    output->producer = &t->stream;
+
+    return CUPKEE_OK;
+}
+
+int cupkee_tee_remove(cupkee_tee_t *t, cupkee_stream_t *output)
+{
+    int i;
+
+    if (!t) {
+        return -CUPKEE_EINVAL;
+    }
+
+    for (i = 0; i < t->num; i++) {
+        if (t->outputs[i] == output) {
+            uint8_t low = (1 << i) - 1;
+
+            // compact outputs and their bits
+            t->num--;
+            memmove(t->outputs + i, t->outputs + i + 1, (t->num - i) * sizeof(cupkee_stream_t *));
+            t->drop    = (t->drop & low) | ((t->drop >> 1) & ~low);
+            t->pending = (t->pending & low) | ((t->pending >> 1) & ~low);
+            output->producer = NULL;
+
+            // removed output may be the one hold the tee
+            tee_process(&t->stream);
+            return CUPKEE_OK;
+        }
+    }
+
+    return -CUPKEE_EINVAL;
+}
@@ -0,0 +1,182 @@
+/*
+MIT License
+
+This file is part of cupkee project.
+
+Copyright (c) 2017 Lixing Ding <ding.lixing@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+ * Device poll loop benchmark
+ *
+ * BENCH_DEVICE_NUM mock devices enabled, one of them has work every
+ * BENCH_DEVICE_BUSY loops. Compare drivers polled in every loop with
+ * drivers that request poll when they need service.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "cupkee_shell_device.h"
+
+#define BENCH_DEVICE_NUM    8
+#define BENCH_DEVICE_LOOPS  (1000 * 1000)
+#define BENCH_DEVICE_BUSY   100
+
+static volatile uint32_t mock_work[BENCH_DEVICE_NUM];
+static uint8_t mock_devid[BENCH_DEVICE_NUM];
+static uint32_t mock_done;
+
+static void mock_release(int inst)
+{
+    (void) inst;
+}
+
+static void mock_reset(int inst)
+{
+    (void) inst;
+}
+
+static int mock_setup(int inst, uint8_t devid, const hw_config_t *conf)
+{
+    (void) conf;
+
+    mock_devid[inst] = devid;
+    mock_work[inst] = 0;
+    return 0;
+}
+
+static void mock_poll(int inst)
+{
+    if (mock_work[inst]) {
+        mock_work[inst] = 0;
+        mock_done++;
+    }
+}
+
+static const hw_driver_t mock_driver_poll = {
+    .release = mock_release,
+    .reset   = mock_reset,
+    .setup   = mock_setup,
+    .poll    = mock_poll,
+};
+
+static const hw_driver_t mock_driver_request = {
+    .release = mock_release,
+    .reset   = mock_reset,
+    .setup   = mock_setup,
+    .poll    = mock_poll,
+
+    .flags   = HW_DRIVER_FL_POLL_REQ
+};
+
+static const hw_driver_t *mock_driver;
+
+static const cupkee_device_desc_t mock_desc = {
+    .name = "mock",
+    .type = DEVICE_TYPE_PIN,
+};
+
+const cupkee_device_desc_t *cupkee_device_query_by_name(const char *name)
+{
+    return strcmp(name, mock_desc.name) ? NULL : &mock_desc;
+}
+
+const cupkee_device_desc_t *cupkee_device_query_by_type(uint16_t type)
+{
+    return type == mock_desc.type ? &mock_desc : NULL;
+}
+
+const hw_driver_t *hw_device_request(int type, int instance)
+{
+    (void) type;
+
+    return instance < BENCH_DEVICE_NUM ? mock_driver : NULL;
+}
+
+void hw_poll(void)
+{
+}
+
+static int bench_device_run(const char *name, const hw_driver_t *driver)
+{
+    cupkee_device_t *devs[BENCH_DEVICE_NUM];
+    cupkee_device_poll_stat_t stat;
+    uint64_t start, spend;
+    int i, err = 0;
+
+    mock_driver = driver;
+    mock_done = 0;
+
+    cupkee_memory_init(0, NULL);
+    cupkee_device_init();
+
+    for (i = 0; i < BENCH_DEVICE_NUM; i++) {
+        devs[i] = cupkee_device_request2(DEVICE_TYPE_PIN, i);
+        if (!devs[i] || cupkee_device_enable(devs[i])) {
+            printf("%-8s setup fail\n", name);
+            return -1;
+        }
+    }
+
+    start = bench_now();
+    for (i = 0; i < BENCH_DEVICE_LOOPS; i++) {
+        // device "isr"
+        if (i % BENCH_DEVICE_BUSY == 0) {
+            int inst = (i / BENCH_DEVICE_BUSY) % BENCH_DEVICE_NUM;
+
+            mock_work[inst] = 1;
+            cupkee_device_poll_request(mock_devid[inst]);
+        }
+        cupkee_device_poll();
+    }
+    spend = bench_now() - start;
+
+    cupkee_device_poll_stat(&stat);
+    if (mock_done != BENCH_DEVICE_LOOPS / BENCH_DEVICE_BUSY) {
+        err = -1;
+    }
+
+    printf("%-8s %6d %12.0f %10.3f %8u%s\n", name, BENCH_DEVICE_NUM,
+           stat.loops / (spend / 1e9), (double) stat.polls / stat.loops, mock_done,
+           err ? " (lost)" : "");
+
+    for (i = 0; i < BENCH_DEVICE_NUM; i++) {
+        cupkee_device_release(devs[i]);
+    }
+
+    return err;
+}
+
+int bench_device(void)
+{
+    int err = 0;
+
+    printf("%-8s %6s %12s %10s %8s\n", "driver", "devs", "loops/s", "polls/loop", "served");
+
+    err |= bench_device_run("poll", &mock_driver_poll);
+    err |= bench_device_run("request", &mock_driver_request);
+
+    return err;
+}
+
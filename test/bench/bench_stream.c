@@ -0,0 +1,470 @@
+/*
+MIT License
+
+This file is part of cupkee project.
+
+Copyright (c) 2017 Lixing Ding <ding.lixing@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Stream layer benchmark
+ *
+ * pipe: readable device stream piped into writable device stream
+ * echo: app write to duplex device stream, device loop tx back to rx, app read
+ *
+ * Each device side moves bytes once per tick, consumer speed limit bytes
+ * pull per tick (0: no limit). Latency is the time from a byte entering the
+ * stream (device push, or app write) to leaving it (device pull, or app read).
+ *
+ * handoff: same pipe moved by copy (push/pull) vs buffer handoff
+ * (push_buf/pull_buf), both sides in lock step.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define BENCH_BYTES     (1024 * 1024)
+#define BENCH_TICK_MAX  (BENCH_BYTES * 4)
+#define BENCH_STAMP_MAX 256
+#define BENCH_SAMPLE_MAX (BENCH_BYTES / 8)
+#define BENCH_HANDOFF_CHUNK 200
+
+enum {
+    BENCH_PIPE,
+    BENCH_ECHO
+};
+
+typedef struct bench_conf_t {
+    int      mode;
+    uint16_t chunk;
+    uint16_t cache;
+    uint16_t speed;
+} bench_conf_t;
+
+typedef struct bench_stamp_t {
+    uint32_t end;
+    uint64_t ns;
+} bench_stamp_t;
+
+static struct {
+    cupkee_event_emitter_t emitter;
+    cupkee_stream_t src;
+    cupkee_stream_t dst;
+
+    int src_want;
+    int dst_want;
+
+    uint32_t in;
+    uint32_t out;
+    uint32_t events;
+
+    int stamp_head;
+    int stamp_tail;
+    bench_stamp_t stamp[BENCH_STAMP_MAX];
+
+    int sample_cnt;
+    uint32_t sample[BENCH_SAMPLE_MAX];
+} bench;
+
+static uint32_t bench_alloc_cnt;
+static uint8_t  bench_data[512];
+
+void *__real_cupkee_malloc(size_t n);
+void *__wrap_cupkee_malloc(size_t n);
+
+void *__wrap_cupkee_malloc(size_t n)
+{
+    bench_alloc_cnt++;
+    return __real_cupkee_malloc(n);
+}
+
+static void bench_stamp_in(uint32_t end)
+{
+    int next = (bench.stamp_tail + 1) % BENCH_STAMP_MAX;
+
+    // drop sample when too many chunks in flight
+    if (next != bench.stamp_head) {
+        bench.stamp[bench.stamp_tail].end = end;
+        bench.stamp[bench.stamp_tail].ns  = bench_now();
+        bench.stamp_tail = next;
+    }
+}
+
+static void bench_stamp_out(uint32_t out)
+{
+    uint64_t now = 0;
+
+    while (bench.stamp_head != bench.stamp_tail && bench.stamp[bench.stamp_head].end <= out) {
+        if (!now) {
+            now = bench_now();
+        }
+        if (bench.sample_cnt < BENCH_SAMPLE_MAX) {
+            bench.sample[bench.sample_cnt++] = now - bench.stamp[bench.stamp_head].ns;
+        }
+        bench.stamp_head = (bench.stamp_head + 1) % BENCH_STAMP_MAX;
+    }
+}
+
+static void bench_event_handle(cupkee_event_emitter_t *emitter, uint8_t code)
+{
+    (void) emitter;
+    (void) code;
+
+    bench.events++;
+}
+
+static void bench_src_read(cupkee_stream_t *s, size_t n)
+{
+    (void) s;
+    (void) n;
+
+    bench.src_want = 1;
+}
+
+static void bench_dst_write(cupkee_stream_t *s)
+{
+    (void) s;
+
+    bench.dst_want = 1;
+}
+
+static size_t bench_limit(size_t n, size_t speed)
+{
+    return (speed && speed < n) ? speed : n;
+}
+
+static void bench_pipe_tick(const bench_conf_t *conf)
+{
+    uint8_t buf[512];
+
+    // rx device, keep pushing until stream refuse
+    if (bench.src_want && bench.in < BENCH_BYTES) {
+        size_t n = bench_limit(BENCH_BYTES - bench.in, conf->chunk);
+        int cnt = cupkee_stream_push(&bench.src, n, bench_data + bench.in % 256);
+
+        if (cnt > 0) {
+            bench.in += cnt;
+            bench_stamp_in(bench.in);
+        }
+        if (cnt < (int) n) {
+            bench.src_want = 0;
+        }
+    }
+
+    // tx device, pull at consumer speed until stream empty
+    if (bench.dst_want) {
+        int cnt = cupkee_stream_pull(&bench.dst, bench_limit(sizeof(buf), conf->speed), buf);
+
+        if (cnt > 0) {
+            bench.out += cnt;
+            bench_stamp_out(bench.out);
+        } else {
+            bench.dst_want = 0;
+        }
+    }
+}
+
+static void bench_echo_tick(const bench_conf_t *conf)
+{
+    cupkee_stream_t *s = &bench.src;
+    uint8_t buf[512];
+    int cnt;
+
+    // app side
+    if (bench.in < BENCH_BYTES) {
+        size_t n = bench_limit(BENCH_BYTES - bench.in, conf->chunk);
+
+        cnt = cupkee_stream_write(s, n, bench_data + bench.in % 256);
+        if (cnt > 0) {
+            bench.in += cnt;
+            bench_stamp_in(bench.in);
+        }
+    }
+
+    cnt = cupkee_stream_read(s, sizeof(buf), buf);
+    if (cnt > 0) {
+        bench.out += cnt;
+        bench_stamp_out(bench.out);
+    }
+
+    // loopback device, tx to rx at device speed
+    if (bench.dst_want && bench.src_want) {
+        size_t n = bench_limit(cupkee_stream_rx_cache_space(s), conf->speed);
+
+        cnt = n ? cupkee_stream_pull(s, bench_limit(n, sizeof(buf)), buf) : 0;
+        if (cnt > 0) {
+            cupkee_stream_push(s, cnt, buf);
+        } else
+        if (n) {
+            bench.dst_want = 0;
+        } else {
+            bench.src_want = 0;
+        }
+    }
+}
+
+static void bench_dispatch(void)
+{
+    cupkee_event_t e;
+
+    while (cupkee_event_take(&e)) {
+        if (e.type == EVENT_EMITTER) {
+            cupkee_event_emitter_dispatch(e.which, e.code);
+        }
+    }
+}
+
+static int bench_sample_cmp(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static uint32_t bench_percentile(int p)
+{
+    if (!bench.sample_cnt) {
+        return 0;
+    }
+    return bench.sample[(bench.sample_cnt - 1) * p / 100];
+}
+
+static int bench_setup(const bench_conf_t *conf)
+{
+    memset(&bench, 0, sizeof(bench));
+
+    cupkee_memory_init(0, NULL);
+    cupkee_event_setup();
+    cupkee_timer_init();
+
+    if (0 > cupkee_event_emitter_init(&bench.emitter, bench_event_handle)) {
+        return -1;
+    }
+
+    if (conf->mode == BENCH_PIPE) {
+        if (cupkee_stream_init_readable(&bench.src, &bench.emitter, conf->cache, bench_src_read) ||
+            cupkee_stream_init_writable(&bench.dst, &bench.emitter, conf->cache, bench_dst_write) ||
+            cupkee_stream_pipe(&bench.src, &bench.dst)) {
+            return -1;
+        }
+    } else {
+        if (cupkee_stream_init_duplex(&bench.src, &bench.emitter, conf->cache, conf->cache,
+                                      bench_src_read, bench_dst_write)) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void bench_teardown(const bench_conf_t *conf)
+{
+    if (conf->mode == BENCH_PIPE) {
+        cupkee_stream_deinit(&bench.dst);
+    }
+    cupkee_stream_deinit(&bench.src);
+    cupkee_event_emitter_deinit(&bench.emitter);
+}
+
+static int bench_run(const bench_conf_t *conf)
+{
+    uint64_t start, spend;
+    uint32_t tick = 0;
+    double sec;
+
+    if (bench_setup(conf)) {
+        printf("%-5s setup fail\n", conf->mode == BENCH_PIPE ? "pipe" : "echo");
+        return -1;
+    }
+    bench_alloc_cnt = 0;
+
+    start = bench_now();
+    while (bench.out < BENCH_BYTES && tick++ < BENCH_TICK_MAX) {
+        if (conf->mode == BENCH_PIPE) {
+            bench_pipe_tick(conf);
+        } else {
+            bench_echo_tick(conf);
+        }
+        bench_dispatch();
+    }
+    spend = bench_now() - start;
+
+    bench_teardown(conf);
+
+    qsort(bench.sample, bench.sample_cnt, sizeof(uint32_t), bench_sample_cmp);
+    sec = spend / 1e9;
+
+    printf("%-5s %6u %6u %6u %10.2f %8.4f %8.3f %8u %8u %8u%s\n",
+            conf->mode == BENCH_PIPE ? "pipe" : "echo",
+            conf->chunk, conf->cache, conf->speed,
+            bench.out / 1024.0 / 1024.0 / sec,
+            (double) bench.events / bench.out,
+            bench_alloc_cnt * 1024.0 / bench.out,
+            bench_percentile(50), bench_percentile(90), bench_percentile(99),
+            bench.out < BENCH_BYTES ? " (stalled)" : "");
+
+    return bench.out < BENCH_BYTES ? -1 : 0;
+}
+
+static int bench_handoff_init(cupkee_stream_t *reader, cupkee_stream_t *writer)
+{
+    cupkee_memory_init(0, NULL);
+    cupkee_event_setup();
+    cupkee_timer_init();
+
+    if (cupkee_stream_init_readable(reader, NULL, BENCH_HANDOFF_CHUNK, bench_src_read) ||
+        cupkee_stream_init_writable(writer, NULL, BENCH_HANDOFF_CHUNK, bench_dst_write) ||
+        cupkee_stream_pipe(reader, writer)) {
+        return -1;
+    }
+    return 0;
+}
+
+static uint32_t bench_handoff_copy(uint32_t *sum)
+{
+    cupkee_stream_t reader, writer;
+    uint8_t out[BENCH_HANDOFF_CHUNK];
+    uint32_t moved = 0;
+    int i;
+
+    if (bench_handoff_init(&reader, &writer)) {
+        return 0;
+    }
+
+    while (moved < BENCH_BYTES) {
+        int n;
+
+        cupkee_stream_push(&reader, BENCH_HANDOFF_CHUNK, bench_data);
+        n = cupkee_stream_pull(&writer, BENCH_HANDOFF_CHUNK, out);
+        if (n <= 0) {
+            break;
+        }
+        for (i = 0; i < n; i += 64) {
+            *sum += out[i];
+        }
+        moved += n;
+    }
+
+    cupkee_stream_deinit(&reader);
+    cupkee_stream_deinit(&writer);
+
+    return moved;
+}
+
+static uint32_t bench_handoff_buf(uint32_t *sum)
+{
+    cupkee_stream_t reader, writer;
+    const uint8_t *out;
+    uint32_t moved = 0;
+    int i;
+
+    if (bench_handoff_init(&reader, &writer)) {
+        return 0;
+    }
+
+    while (moved < BENCH_BYTES) {
+        void *b = cupkee_buffer_alloc(BENCH_HANDOFF_CHUNK);
+        int n;
+
+        if (!b) {
+            break;
+        }
+        // stands in for the hardware filling buffer in place
+        cupkee_buffer_give(b, BENCH_HANDOFF_CHUNK, bench_data);
+        if (cupkee_stream_push_buf(&reader, b) <= 0) {
+            cupkee_buffer_release(b);
+            break;
+        }
+
+        b = cupkee_stream_pull_buf(&writer);
+        if (!b) {
+            break;
+        }
+        n = cupkee_buffer_segment(b, 0, &out);
+        for (i = 0; i < n; i += 64) {
+            *sum += out[i];
+        }
+        moved += cupkee_buffer_length(b);
+        cupkee_buffer_release(b);
+    }
+
+    cupkee_stream_deinit(&reader);
+    cupkee_stream_deinit(&writer);
+
+    return moved;
+}
+
+static int bench_handoff(void)
+{
+    uint32_t sum_copy = 0, sum_buf = 0, moved_copy, moved_buf;
+    uint64_t t0, t1, t2;
+
+    t0 = bench_now();
+    moved_copy = bench_handoff_copy(&sum_copy);
+    t1 = bench_now();
+    moved_buf = bench_handoff_buf(&sum_buf);
+    t2 = bench_now();
+
+    printf("%-8s %10s\n", "handoff", "MB/s");
+    printf("%-8s %10.2f\n", "copy", moved_copy / 1024.0 / 1024.0 / ((t1 - t0) / 1e9));
+    printf("%-8s %10.2f%s\n", "buf", moved_buf / 1024.0 / 1024.0 / ((t2 - t1) / 1e9),
+           sum_copy != sum_buf ? " (data mismatch)" : "");
+
+    return (moved_copy < BENCH_BYTES || moved_buf < BENCH_BYTES || sum_copy != sum_buf) ? -1 : 0;
+}
+
+int bench_stream(void)
+{
+    static const uint16_t chunks[] = {8, 64, 256};
+    static const uint16_t caches[] = {32, 448};
+    static const uint16_t speeds[] = {0, 16};
+    unsigned mode, i, j, k;
+    int err = 0;
+
+    for (i = 0; i < sizeof(bench_data); i++) {
+        bench_data[i] = i;
+    }
+
+    printf("%-5s %6s %6s %6s %10s %8s %8s %8s %8s %8s\n",
+           "mode", "chunk", "cache", "speed", "MB/s", "ev/B", "alloc/KB",
+           "p50(ns)", "p90(ns)", "p99(ns)");
+
+    for (mode = BENCH_PIPE; mode <= BENCH_ECHO; mode++) {
+        for (i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+            for (j = 0; j < sizeof(caches) / sizeof(caches[0]); j++) {
+                for (k = 0; k < sizeof(speeds) / sizeof(speeds[0]); k++) {
+                    bench_conf_t conf = {mode, chunks[i], caches[j], speeds[k]};
+
+                    err |= bench_run(&conf);
+                }
+            }
+        }
+    }
+
+    printf("\n");
+    err |= bench_handoff();
+
+    return err;
+}
+
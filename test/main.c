@@ -44,6 +44,10 @@ int main(int argc, const char *argv[])
     test_sys_memory();
     test_sys_timer();
     test_sys_stream();
+    test_sys_buffer();
+    test_sys_crc();
+    test_sys_filter();
+    test_sys_device();
 
     CU_basic_set_mode(CU_BRM_VERBOSE);
     CU_basic_run_tests();
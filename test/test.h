@@ -34,6 +34,7 @@ SOFTWARE.
 #include <cupkee.h>
 
 void hw_mock_memory_reset(void);
+void hw_mock_storage_set(int bank, int offset, int n, const void *data);
 
 void TU_pre_init(void);
 void TU_pre_deinit(void);
@@ -44,6 +45,10 @@ CU_pSuite test_sys_event(void);
 CU_pSuite test_sys_memory(void);
 CU_pSuite test_sys_timer(void);
 CU_pSuite test_sys_stream(void);
+CU_pSuite test_sys_buffer(void);
+CU_pSuite test_sys_crc(void);
+CU_pSuite test_sys_filter(void);
+CU_pSuite test_sys_device(void);
 
 #endif /* __TEST_INC__ */
 
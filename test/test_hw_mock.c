@@ -66,3 +66,20 @@ void hw_mock_memory_reset(void)
 {
 }
 
+
+static char mock_storage[HW_STORAGE_BANK_CFG + 1][256];
+
+uint32_t hw_storage_size(int bank)
+{
+    return (bank >= 0 && bank <= HW_STORAGE_BANK_CFG) ? sizeof(mock_storage[0]) : 0;
+}
+
+const char *hw_storage_data_map(int bank)
+{
+    return (bank >= 0 && bank <= HW_STORAGE_BANK_CFG) ? mock_storage[bank] : NULL;
+}
+
+void hw_mock_storage_set(int bank, int offset, int n, const void *data)
+{
+    memcpy(mock_storage[bank] + offset, data, n);
+}
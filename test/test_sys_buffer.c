@@ -0,0 +1,236 @@
+/*
+MIT License
+
+This file is part of cupkee project
+
+Copyright (c) 201y Lixing Ding <ding.lixing@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+#include <cupkee.h>
+
+static int test_setup(void)
+{
+    TU_pre_init();
+
+    cupkee_memory_init(0, NULL);
+
+    return 0;
+}
+
+static int test_clean(void)
+{
+    TU_pre_deinit();
+    return 0;
+}
+
+static void test_read_array(void)
+{
+    void *b = cupkee_buffer_alloc(8);
+    uint8_t d;
+    int16_t i16[4];
+    uint16_t u16[4];
+    int32_t i32;
+
+    CU_ASSERT_FATAL(b != NULL);
+
+    // make data wrap at the end of buffer
+    CU_ASSERT(6 == cupkee_buffer_give(b, 6, "\x00\x00\x00\x00\x00\x00"));
+    CU_ASSERT(1 == cupkee_buffer_shift(b, &d));
+    CU_ASSERT(1 == cupkee_buffer_shift(b, &d));
+    CU_ASSERT(1 == cupkee_buffer_shift(b, &d));
+    CU_ASSERT(1 == cupkee_buffer_shift(b, &d));
+    CU_ASSERT(1 == cupkee_buffer_shift(b, &d));
+    CU_ASSERT(1 == cupkee_buffer_shift(b, &d));
+    CU_ASSERT(6 == cupkee_buffer_give(b, 6, "\x01\x02\xff\xfe\x10\x20"));
+
+    CU_ASSERT(3 == cupkee_buffer_read_array(b, 0, 4, 2, 0, i16));
+    CU_ASSERT(i16[0] == 0x0201 && i16[1] == -257 && i16[2] == 0x2010);
+
+    CU_ASSERT(3 == cupkee_buffer_read_array(b, 0, 3, 2, 1, u16));
+    CU_ASSERT(u16[0] == 0x0102 && u16[1] == 0xfffe && u16[2] == 0x1020);
+
+    CU_ASSERT(2 == cupkee_buffer_read_array(b, 1, 3, 2, 1, i16));
+    CU_ASSERT(i16[0] == 0x02ff && i16[1] == -496);
+
+    CU_ASSERT(1 == cupkee_buffer_read_int32_be(b, 2, &i32));
+    CU_ASSERT(i32 == (int32_t)0xfffe1020);
+    CU_ASSERT(0 == cupkee_buffer_read_int32_be(b, 3, &i32));
+    CU_ASSERT(-CUPKEE_EINVAL == cupkee_buffer_read_array(b, 7, 1, 1, 0, &d));
+
+    // read should not consume data
+    CU_ASSERT(6 == cupkee_buffer_length(b));
+
+    cupkee_buffer_release(b);
+}
+
+static void test_write_array(void)
+{
+    void *b = cupkee_buffer_alloc(8);
+    uint8_t d[8];
+    int16_t i16[3] = {0x0102, -2, 0x7f00};
+    float f[2] = {1.5, -0.25}, r[2];
+
+    CU_ASSERT_FATAL(b != NULL);
+
+    CU_ASSERT(3 == cupkee_buffer_give(b, 3, "abc"));
+    CU_ASSERT(3 == cupkee_buffer_take(b, 3, d));
+
+    // encode across the wrap point
+    CU_ASSERT(3 == cupkee_buffer_write_array(b, 0, 3, 2, 1, i16));
+    CU_ASSERT(6 == cupkee_buffer_length(b));
+    CU_ASSERT(6 == cupkee_buffer_take(b, 6, d));
+    CU_ASSERT(!memcmp(d, "\x01\x02\xff\xfe\x7f\x00", 6));
+
+    CU_ASSERT(2 == cupkee_buffer_write_array(b, 0, 2, 4, 0, f));
+    CU_ASSERT(2 == cupkee_buffer_read_array(b, 0, 2, 4, 0, r));
+    CU_ASSERT(r[0] == 1.5 && r[1] == -0.25);
+
+    CU_ASSERT(2 == cupkee_buffer_write_array(b, 0, 2, 4, 1, f));
+    CU_ASSERT(1 == cupkee_buffer_read_float_be(b, 4, r));
+    CU_ASSERT(r[0] == -0.25);
+
+    // overwrite inside, clamp by capacity
+    CU_ASSERT(1 == cupkee_buffer_write_array(b, 6, 3, 2, 0, i16));
+    CU_ASSERT(8 == cupkee_buffer_length(b));
+    CU_ASSERT(-CUPKEE_EINVAL == cupkee_buffer_write_array(b, 9, 1, 1, 0, d));
+
+    cupkee_buffer_release(b);
+}
+
+static void test_segmented(void)
+{
+    void *b = cupkee_sbuffer_alloc(48, 0);
+    uint8_t in[1024], out[1024], d;
+    int i;
+
+    CU_ASSERT_FATAL(b != NULL);
+
+    for (i = 0; i < 1024; i++) {
+        in[i] = i * 7;
+    }
+
+    // grow beyond any single memory block
+    CU_ASSERT(1000 == cupkee_sbuffer_give(b, 1000, in));
+    CU_ASSERT(1000 == cupkee_sbuffer_length(b));
+    CU_ASSERT(1 == cupkee_sbuffer_push(b, in[1000]));
+
+    CU_ASSERT(1 == cupkee_sbuffer_shift(b, &d) && d == in[0]);
+    CU_ASSERT(100 == cupkee_sbuffer_take(b, 100, out));
+    CU_ASSERT(!memcmp(out, in + 1, 100));
+
+    CU_ASSERT(23 == cupkee_sbuffer_give(b, 23, in + 1001));
+    CU_ASSERT(923 == cupkee_sbuffer_take(b, 1024, out));
+    CU_ASSERT(!memcmp(out, in + 101, 923));
+    CU_ASSERT(cupkee_sbuffer_is_empty(b));
+    CU_ASSERT(0 == cupkee_sbuffer_shift(b, &d));
+
+    cupkee_sbuffer_reset(b);
+
+    // all segments should be returned
+    for (i = 0; i < 30; i++) {
+        CU_ASSERT(48 == cupkee_sbuffer_give(b, 48, in));
+    }
+    CU_ASSERT(1440 == cupkee_sbuffer_length(b));
+    for (i = 0; i < 30; i++) {
+        CU_ASSERT(48 == cupkee_sbuffer_take(b, 48, out));
+    }
+
+    cupkee_sbuffer_release(b);
+}
+
+static void test_segmented_limit(void)
+{
+    void *b = cupkee_sbuffer_alloc(16, 40), *b2;
+    uint8_t buf[64];
+
+    CU_ASSERT_FATAL(b != NULL);
+
+    // segment bigger than largest memory block
+    CU_ASSERT(NULL == cupkee_sbuffer_alloc(0, 0));
+    CU_ASSERT(NULL == cupkee_sbuffer_alloc(512, 0));
+    CU_ASSERT(NULL == cupkee_sbuffer_alloc(UINT16_MAX, 0));
+    b2 = cupkee_sbuffer_alloc(256, 0);
+    CU_ASSERT(b2 != NULL);
+    cupkee_sbuffer_release(b2);
+
+    CU_ASSERT(40 == cupkee_sbuffer_give(b, 64, buf));
+    CU_ASSERT(cupkee_sbuffer_is_full(b));
+    CU_ASSERT(0 == cupkee_sbuffer_push(b, 1));
+    CU_ASSERT(0 == cupkee_sbuffer_space(b));
+    CU_ASSERT(40 == cupkee_sbuffer_take(b, 64, buf));
+    CU_ASSERT(40 == cupkee_sbuffer_space(b));
+
+    cupkee_sbuffer_release(b);
+}
+
+static void test_dma_ring(void)
+{
+    void *b = cupkee_buffer_alloc(16);
+    uint8_t ring[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    uint8_t out[16];
+    const uint8_t *ptr;
+
+    CU_ASSERT_FATAL(b != NULL);
+
+    // circular rx: new data between last and current dma position
+    CU_ASSERT(0 == cupkee_buffer_give_ring(b, 8, ring, 3, 3));
+    CU_ASSERT(3 == cupkee_buffer_give_ring(b, 8, ring, 0, 3));
+    CU_ASSERT(6 == cupkee_buffer_give_ring(b, 8, ring, 3, 1));
+    CU_ASSERT(9 == cupkee_buffer_take(b, 16, out));
+    CU_ASSERT(!memcmp(out, "\0\1\2\3\4\5\6\7\0", 9));
+    CU_ASSERT(-CUPKEE_EINVAL == cupkee_buffer_give_ring(b, 8, ring, 8, 0));
+
+    // stop when buffer full
+    CU_ASSERT(7 == cupkee_buffer_give_ring(b, 8, ring, 1, 0));
+    CU_ASSERT(7 == cupkee_buffer_give_ring(b, 8, ring, 4, 3));
+    CU_ASSERT(2 == cupkee_buffer_give_ring(b, 8, ring, 4, 3));
+    CU_ASSERT(cupkee_buffer_is_full(b));
+
+    // tx from buffer memory, drop after transfer done
+    CU_ASSERT(7 == cupkee_buffer_segment(b, 0, &ptr) && ptr[0] == 1);
+    CU_ASSERT(7 == cupkee_buffer_skip(b, 7));
+    CU_ASSERT(9 == cupkee_buffer_segment(b, 0, &ptr) && ptr[0] == 4);
+    CU_ASSERT(3 == cupkee_buffer_give(b, 3, ring));
+    CU_ASSERT(12 == cupkee_buffer_segment(b, 0, &ptr) && ptr[11] == 2);
+    CU_ASSERT(12 == cupkee_buffer_skip(b, 16));
+    CU_ASSERT(cupkee_buffer_is_empty(b));
+
+    cupkee_buffer_release(b);
+}
+
+CU_pSuite test_sys_buffer(void)
+{
+    CU_pSuite suite = CU_add_suite("system buffer", test_setup, test_clean);
+
+    if (suite) {
+        CU_add_test(suite, "read array ", test_read_array);
+        CU_add_test(suite, "write array", test_write_array);
+        CU_add_test(suite, "segmented  ", test_segmented);
+        CU_add_test(suite, "seg limit  ", test_segmented_limit);
+        CU_add_test(suite, "dma ring   ", test_dma_ring);
+    }
+
+    return suite;
+}
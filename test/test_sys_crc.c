@@ -0,0 +1,128 @@
+/*
+MIT License
+
+This file is part of cupkee project
+
+Copyright (c) 201y Lixing Ding <ding.lixing@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+#include <cupkee.h>
+
+static const char *check = "123456789";
+
+static int test_setup(void)
+{
+    TU_pre_init();
+
+    cupkee_memory_init(0, NULL);
+
+    return 0;
+}
+
+static int test_clean(void)
+{
+    TU_pre_deinit();
+    return 0;
+}
+
+static void test_kernel(void)
+{
+    uint8_t data[64];
+    uint32_t crc;
+    int i;
+
+    CU_ASSERT(0xf4 == cupkee_crc8(0, check, 9));
+    CU_ASSERT(0x4b37 == cupkee_crc16_modbus(0xffff, check, 9));
+    CU_ASSERT(0x29b1 == cupkee_crc16_ccitt(0xffff, check, 9));
+    CU_ASSERT(0xcbf43926 == cupkee_crc32(0, check, 9));
+
+    // crc32 on unaligned data and chunks
+    for (i = 0; i < 64; i++) {
+        data[i] = i * 13;
+    }
+    crc = cupkee_crc32(0, data + 1, 63);
+    CU_ASSERT(crc == cupkee_crc32(cupkee_crc32(0, data + 1, 10), data + 11, 53));
+    CU_ASSERT(0x29b1 == cupkee_crc16_ccitt(cupkee_crc16_ccitt(0xffff, check, 4), check + 4, 5));
+
+    for (i = 0; i < CUPKEE_CRC_MAX; i++) {
+        CU_ASSERT(cupkee_crc_update(i, cupkee_crc_init(i), check, 9) != 0);
+    }
+    CU_ASSERT(0x4b37 == cupkee_crc_update(CUPKEE_CRC16_MODBUS, cupkee_crc_init(CUPKEE_CRC16_MODBUS), check, 9));
+}
+
+static void test_buffer(void)
+{
+    void *b = cupkee_buffer_alloc(12);
+    uint8_t tmp[8];
+    uint32_t crc;
+
+    CU_ASSERT_FATAL(b != NULL);
+
+    // make data wrap at the end of buffer
+    CU_ASSERT(8 == cupkee_buffer_give(b, 8, "abcdefgh"));
+    CU_ASSERT(8 == cupkee_buffer_take(b, 8, tmp));
+    CU_ASSERT(10 == cupkee_buffer_give(b, 10, "0123456789"));
+
+    crc = cupkee_crc_init(CUPKEE_CRC32);
+    CU_ASSERT(9 == cupkee_crc_buffer(CUPKEE_CRC32, &crc, b, 1, 9));
+    CU_ASSERT(0xcbf43926 == crc);
+
+    crc = cupkee_crc_init(CUPKEE_CRC16_MODBUS);
+    CU_ASSERT(9 == cupkee_crc_buffer(CUPKEE_CRC16_MODBUS, &crc, b, 1, 20));
+    CU_ASSERT(0x4b37 == crc);
+
+    CU_ASSERT(0 > cupkee_crc_buffer(CUPKEE_CRC_MAX, &crc, b, 0, 1));
+    CU_ASSERT(0 > cupkee_crc_buffer(CUPKEE_CRC8, &crc, b, 11, 1));
+
+    cupkee_buffer_release(b);
+}
+
+static void test_storage(void)
+{
+    uint32_t crc;
+
+    hw_mock_storage_set(HW_STORAGE_BANK_APP, 100, 9, check);
+
+    crc = cupkee_crc_init(CUPKEE_CRC8);
+    CU_ASSERT(9 == cupkee_crc_storage(CUPKEE_CRC8, &crc, HW_STORAGE_BANK_APP, 100, 9));
+    CU_ASSERT(0xf4 == crc);
+
+    crc = cupkee_crc_init(CUPKEE_CRC8);
+    CU_ASSERT(6 == cupkee_crc_storage(CUPKEE_CRC8, &crc, HW_STORAGE_BANK_APP, 250, 9));
+    CU_ASSERT(0 > cupkee_crc_storage(CUPKEE_CRC8, &crc, 8, 0, 9));
+}
+
+CU_pSuite test_sys_crc(void)
+{
+    CU_pSuite suite = CU_add_suite("system crc", test_setup, test_clean);
+
+    if (suite) {
+        CU_add_test(suite, "kernel ", test_kernel);
+        CU_add_test(suite, "buffer ", test_buffer);
+        CU_add_test(suite, "storage", test_storage);
+    }
+
+    return suite;
+}
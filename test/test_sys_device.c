@@ -0,0 +1,413 @@
+/*
+MIT License
+
+This file is part of cupkee project.
+
+Copyright (c) 2017 Lixing Ding <ding.lixing@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+#include <cupkee.h>
+
+// Descriptors of shell are not linked here, test own them
+const cupkee_device_desc_t *cupkee_device_query_by_name(const char *name);
+const cupkee_device_desc_t *cupkee_device_query_by_type(uint16_t type);
+
+static const cupkee_device_desc_t test_descs[] = {
+    {.name = "dummy", .type = DEVICE_TYPE_DUMMY, .category = DEVICE_CATEGORY_MAP},
+    {.name = "spi",   .type = DEVICE_TYPE_SPI,   .category = DEVICE_CATEGORY_STREAM},
+    {.name = "uart",  .type = DEVICE_TYPE_UART,  .category = DEVICE_CATEGORY_STREAM},
+    {.name = "adc",   .type = DEVICE_TYPE_ADC,   .category = DEVICE_CATEGORY_MAP},
+};
+
+const cupkee_device_desc_t *cupkee_device_query_by_name(const char *name)
+{
+    unsigned i;
+
+    for (i = 0; i < sizeof(test_descs) / sizeof(test_descs[0]); i++) {
+        if (!strcmp(name, test_descs[i].name)) {
+            return &test_descs[i];
+        }
+    }
+    return NULL;
+}
+
+const cupkee_device_desc_t *cupkee_device_query_by_type(uint16_t type)
+{
+    unsigned i;
+
+    for (i = 0; i < sizeof(test_descs) / sizeof(test_descs[0]); i++) {
+        if (type == test_descs[i].type) {
+            return &test_descs[i];
+        }
+    }
+    return NULL;
+}
+
+// Dummy device: enough instances to fill the device table
+static uint8_t  dummy_used[APP_DEV_LIMIT];
+static uint32_t dummy_syncs[APP_DEV_LIMIT];
+static uint32_t dummy_polls[APP_DEV_LIMIT];
+
+static void dummy_release(int inst)
+{
+    dummy_used[inst] = 0;
+}
+
+static void dummy_reset(int inst)
+{
+    (void) inst;
+}
+
+static int dummy_setup(int inst, uint8_t devid, const hw_config_t *conf)
+{
+    (void) devid;
+    (void) conf;
+
+    dummy_syncs[inst] = 0;
+    dummy_polls[inst] = 0;
+    return 0;
+}
+
+static void dummy_sync(int inst, uint32_t systicks)
+{
+    (void) systicks;
+    dummy_syncs[inst]++;
+}
+
+static void dummy_poll(int inst)
+{
+    dummy_polls[inst]++;
+}
+
+static const hw_driver_t dummy_driver = {
+    .release = dummy_release,
+    .reset   = dummy_reset,
+    .setup   = dummy_setup,
+    .sync    = dummy_sync,
+    .poll    = dummy_poll,
+
+    .flags   = HW_DRIVER_FL_POLL_REQ
+};
+
+const hw_driver_t *hw_device_request(int type, int instance)
+{
+    switch (type) {
+    case DEVICE_TYPE_DUMMY:
+        if (instance >= 0 && instance < APP_DEV_LIMIT && !dummy_used[instance]) {
+            dummy_used[instance] = 1;
+            return &dummy_driver;
+        }
+        return NULL;
+    case DEVICE_TYPE_SPI:   return hw_request_spi(instance);
+    case DEVICE_TYPE_UART:  return hw_request_uart(instance);
+    case DEVICE_TYPE_ADC:   return hw_request_adc(instance);
+    default:                return NULL;
+    }
+}
+
+void hw_poll(void)
+{
+}
+
+static int test_setup(void)
+{
+    static cupkee_memory_desc_t descs[] = {
+        {64,  32},
+        {128, APP_DEV_LIMIT + 16},
+        {512, 8},
+    };
+
+    TU_pre_init();
+
+    cupkee_memory_init(3, descs);
+    cupkee_event_setup();
+    cupkee_device_init();
+
+    hw_setup_spi();
+    hw_setup_uart();
+    hw_setup_adc();
+
+    return 0;
+}
+
+static int test_clean(void)
+{
+    TU_pre_deinit();
+    return 0;
+}
+
+// Poll drivers until quiet, count events of device by code
+static void device_run(cupkee_device_t *dev, int *events)
+{
+    cupkee_event_t e;
+    int i;
+
+    for (i = 0; i < EVENT_DEVICE_MAX; i++) {
+        events[i] = 0;
+    }
+
+    for (i = 0; i < 16; i++) {
+        cupkee_device_poll();
+    }
+    while (cupkee_event_take(&e)) {
+        if (e.type == EVENT_DEVICE && e.which == cupkee_device_id(dev) && e.code < EVENT_DEVICE_MAX) {
+            events[e.code]++;
+        }
+    }
+}
+
+static void test_grow(void)
+{
+    cupkee_device_t *devs[APP_DEV_LIMIT];
+    cupkee_device_t *dev;
+    int i;
+
+    // table start with APP_DEV_MAX slots, grow when all used
+    for (i = 0; i < APP_DEV_LIMIT; i++) {
+        devs[i] = cupkee_device_request("dummy", i);
+        CU_ASSERT_FATAL(devs[i] != NULL);
+        CU_ASSERT(i == cupkee_device_id(devs[i]));
+        CU_ASSERT(devs[i] == cupkee_device_block(i));
+    }
+    CU_ASSERT(APP_DEV_LIMIT > APP_DEV_MAX);
+
+    // devices before grow still dispatched
+    for (i = 0; i < APP_DEV_LIMIT; i++) {
+        CU_ASSERT(CUPKEE_OK == cupkee_device_enable(devs[i]));
+    }
+    cupkee_device_sync(1);
+    for (i = 0; i < APP_DEV_LIMIT; i++) {
+        CU_ASSERT(1 == dummy_syncs[i]);
+    }
+
+    cupkee_device_poll_request(1);
+    cupkee_device_poll_request(APP_DEV_MAX);
+    cupkee_device_poll_request(APP_DEV_LIMIT - 1);
+    cupkee_device_poll();
+    for (i = 0; i < APP_DEV_LIMIT; i++) {
+        int polls = (i == 1 || i == APP_DEV_MAX || i == APP_DEV_LIMIT - 1);
+
+        CU_ASSERT(polls == (int)dummy_polls[i]);
+    }
+
+    // id reused after release
+    CU_ASSERT(CUPKEE_OK == cupkee_device_release(devs[APP_DEV_MAX + 1]));
+    CU_ASSERT(NULL == cupkee_device_block(APP_DEV_MAX + 1));
+    dev = cupkee_device_request2(DEVICE_TYPE_DUMMY, APP_DEV_MAX + 1);
+    CU_ASSERT_FATAL(dev != NULL);
+    CU_ASSERT(APP_DEV_MAX + 1 == cupkee_device_id(dev));
+    devs[APP_DEV_MAX + 1] = dev;
+
+    for (i = 0; i < APP_DEV_LIMIT; i++) {
+        cupkee_device_release(devs[i]);
+    }
+}
+
+static void test_spi(void)
+{
+    cupkee_device_t *dev;
+    hw_config_spi_t *conf;
+    int events[EVENT_DEVICE_MAX], times;
+    uint8_t buf[32];
+
+    dev = cupkee_device_request("spi", 0);
+    CU_ASSERT_FATAL(dev != NULL);
+    conf = &cupkee_device_config(cupkee_device_id(dev))->data.spi;
+    CU_ASSERT(-CUPKEE_EINVAL == cupkee_device_enable(dev));
+
+    conf->speed = 1000000;
+    conf->dir = DEVICE_OPT_DIR_IN;
+    conf->select = DEVICE_OPT_SELECT_AUTO;
+    CU_ASSERT(CUPKEE_OK == cupkee_device_enable(dev));
+
+    // write go out on wire, not kept when read only
+    CU_ASSERT(3 == cupkee_device_write(dev, 3, "abc"));
+    device_run(dev, events);
+    CU_ASSERT(events[EVENT_DEVICE_DRAIN] == 1 && events[EVENT_DEVICE_DATA] == 0);
+    CU_ASSERT(3 == hw_dbg_spi_data_take(0, 32, buf));
+    CU_ASSERT(!memcmp(buf, "abc", 3));
+    CU_ASSERT(0 == cupkee_device_read(dev, 32, buf));
+
+    // command and read queued together share one selection
+    hw_dbg_spi_reply_set(0, 5, (const uint8_t *)"\0\0xyz");
+    CU_ASSERT(2 == cupkee_device_write(dev, 2, "rd"));
+    CU_ASSERT(0 == cupkee_device_read_req(dev, 3));
+    device_run(dev, events);
+    CU_ASSERT(events[EVENT_DEVICE_DATA] == 1);
+    CU_ASSERT(0 == hw_dbg_spi_selected(0, &times));
+    CU_ASSERT(2 == times);
+    CU_ASSERT(5 == hw_dbg_spi_data_take(0, 32, buf));
+    CU_ASSERT(!memcmp(buf, "rd\xff\xff\xff", 5));
+    CU_ASSERT(3 == cupkee_device_read(dev, 32, buf));
+    CU_ASSERT(!memcmp(buf, "xyz", 3));
+
+    // duplex keep bytes clocked in by write, MISO loop back MOSI
+    CU_ASSERT(CUPKEE_OK == cupkee_device_disable(dev));
+    conf->dir = DEVICE_OPT_DIR_DUAL;
+    CU_ASSERT(CUPKEE_OK == cupkee_device_enable(dev));
+    hw_dbg_spi_reply_set(0, 0, buf);
+    CU_ASSERT(4 == cupkee_device_write(dev, 4, "1234"));
+    device_run(dev, events);
+    CU_ASSERT(4 == cupkee_device_read(dev, 32, buf));
+    CU_ASSERT(!memcmp(buf, "1234", 4));
+
+    CU_ASSERT(CUPKEE_OK == cupkee_device_release(dev));
+}
+
+static void test_uart(void)
+{
+    cupkee_device_t *dev;
+    int events[EVENT_DEVICE_MAX];
+    uint8_t buf[32];
+
+    dev = cupkee_device_request("uart", 0);
+    CU_ASSERT_FATAL(dev != NULL);
+    CU_ASSERT(CUPKEE_OK == cupkee_device_enable(dev));
+
+    // rx ring wrap around
+    hw_dbg_uart_data_give(0, "0123456789");
+    device_run(dev, events);
+    CU_ASSERT(events[EVENT_DEVICE_DATA] == 1 && events[EVENT_DEVICE_ERR] == 0);
+    CU_ASSERT(10 == cupkee_device_read(dev, 32, buf));
+    hw_dbg_uart_data_give(0, "abcdefghij");
+    device_run(dev, events);
+    CU_ASSERT(10 == cupkee_device_read(dev, 32, buf));
+    CU_ASSERT(!memcmp(buf, "abcdefghij", 10));
+
+    // dma lap the ring before poll: overwritten bytes dropped, error report
+    hw_dbg_uart_data_give(0, "0123456789");
+    hw_dbg_uart_data_give(0, "abcdefghij");
+    device_run(dev, events);
+    CU_ASSERT(events[EVENT_DEVICE_ERR] == 1 && events[EVENT_DEVICE_DATA] == 0);
+    CU_ASSERT(0 == cupkee_device_read(dev, 32, buf));
+
+    // exactly one ring, position look unchanged
+    hw_dbg_uart_data_give(0, "0123456789abcdef");
+    device_run(dev, events);
+    CU_ASSERT(events[EVENT_DEVICE_ERR] == 1);
+    CU_ASSERT(0 == cupkee_device_read(dev, 32, buf));
+
+    hw_dbg_uart_data_give(0, "xyz");
+    device_run(dev, events);
+    CU_ASSERT(events[EVENT_DEVICE_ERR] == 0);
+    CU_ASSERT(3 == cupkee_device_read(dev, 32, buf));
+    CU_ASSERT(!memcmp(buf, "xyz", 3));
+
+    // tx from buffer, drain when dma done
+    CU_ASSERT(5 == cupkee_device_write(dev, 5, "hello"));
+    device_run(dev, events);
+    CU_ASSERT(events[EVENT_DEVICE_DRAIN] == 0);
+    CU_ASSERT(0 == hw_dbg_uart_data_take(0, 32));
+    hw_dbg_uart_send_state(0, 1);
+    device_run(dev, events);
+    CU_ASSERT(events[EVENT_DEVICE_DRAIN] == 1);
+    CU_ASSERT(5 == hw_dbg_uart_data_take(0, 32));
+
+    CU_ASSERT(CUPKEE_OK == cupkee_device_release(dev));
+}
+
+static void test_adc_block(void)
+{
+    cupkee_device_t *dev;
+    hw_config_adc_t *conf;
+    int events[EVENT_DEVICE_MAX], i;
+    uint16_t samples[8];
+
+    dev = cupkee_device_request("adc", 0);
+    CU_ASSERT_FATAL(dev != NULL);
+    conf = &cupkee_device_config(cupkee_device_id(dev))->data.adc;
+    conf->chn_num = 2;
+    conf->rate = 100;
+    conf->block = 2;
+    CU_ASSERT(CUPKEE_OK == cupkee_device_enable(dev));
+
+    hw_dbg_adc_wave_set(0, 0, HW_DBG_WAVE_SAW, 400, 4, 0);
+    hw_dbg_adc_wave_set(0, 1, HW_DBG_WAVE_SQUARE, 1000, 2, 7);
+
+    // half ring one block
+    hw_dbg_adc_scan(0, 1);
+    device_run(dev, events);
+    CU_ASSERT(events[EVENT_DEVICE_DATA] == 0);
+    hw_dbg_adc_scan(0, 1);
+    device_run(dev, events);
+    CU_ASSERT(events[EVENT_DEVICE_DATA] == 1);
+    CU_ASSERT(8 == cupkee_device_read(dev, sizeof(samples), samples));
+    CU_ASSERT(samples[0] == 0   && samples[1] == 1007);
+    CU_ASSERT(samples[2] == 100 && samples[3] == 7);
+
+    hw_dbg_adc_scan(0, 2);
+    device_run(dev, events);
+    CU_ASSERT(events[EVENT_DEVICE_DATA] == 1);
+    CU_ASSERT(8 == cupkee_device_read(dev, sizeof(samples), samples));
+    CU_ASSERT(samples[0] == 200 && samples[2] == 300);
+
+    // both halves done before poll: older one overwritten and skipped
+    hw_dbg_adc_scan(0, 4);
+    device_run(dev, events);
+    CU_ASSERT(events[EVENT_DEVICE_ERR] == 1 && events[EVENT_DEVICE_DATA] == 1);
+    CU_ASSERT(8 == cupkee_device_read(dev, sizeof(samples), samples));
+    CU_ASSERT(samples[0] == 200 && samples[2] == 300);
+
+    // reader too slow, block dropped
+    for (i = 0; i < 3; i++) {
+        hw_dbg_adc_scan(0, 2);
+        device_run(dev, events);
+    }
+    CU_ASSERT(events[EVENT_DEVICE_ERR] == 1 && events[EVENT_DEVICE_DATA] == 0);
+    CU_ASSERT(16 == cupkee_device_read(dev, sizeof(samples), samples));
+    CU_ASSERT(0 == cupkee_device_read(dev, sizeof(samples), samples));
+
+    // no room for a whole block after a partial read, nothing appended
+    for (i = 0; i < 2; i++) {
+        hw_dbg_adc_scan(0, 2);
+        device_run(dev, events);
+    }
+    CU_ASSERT(4 == cupkee_device_read(dev, 4, samples));
+    hw_dbg_adc_scan(0, 2);
+    device_run(dev, events);
+    CU_ASSERT(events[EVENT_DEVICE_ERR] == 1 && events[EVENT_DEVICE_DATA] == 0);
+    CU_ASSERT(12 == cupkee_device_read(dev, sizeof(samples), samples));
+    hw_dbg_adc_scan(0, 2);
+    device_run(dev, events);
+    CU_ASSERT(8 == cupkee_device_read(dev, sizeof(samples), samples));
+    CU_ASSERT(samples[1] == 7 || samples[1] == 1007);
+    CU_ASSERT(samples[3] == 7 || samples[3] == 1007);
+
+    CU_ASSERT(CUPKEE_OK == cupkee_device_release(dev));
+}
+
+CU_pSuite test_sys_device(void)
+{
+    CU_pSuite suite = CU_add_suite("system device", test_setup, test_clean);
+
+    if (suite) {
+        CU_add_test(suite, "grow       ", test_grow);
+        CU_add_test(suite, "spi        ", test_spi);
+        CU_add_test(suite, "uart dma   ", test_uart);
+        CU_add_test(suite, "adc block  ", test_adc_block);
+    }
+
+    return suite;
+}
@@ -0,0 +1,124 @@
+/*
+MIT License
+
+This file is part of cupkee project.
+
+Copyright (c) 2017 Lixing Ding <ding.lixing@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+#include <cupkee.h>
+
+static int test_setup(void)
+{
+    TU_pre_init();
+
+    return 0;
+}
+
+static int test_clean(void)
+{
+    TU_pre_deinit();
+    return 0;
+}
+
+static void test_bypass(void)
+{
+    cupkee_filter_t f;
+
+    CU_ASSERT(-CUPKEE_EINVAL == cupkee_filter_init(&f, CUPKEE_FILTER_OVERSAMPLE_MAX + 1, 0, 0));
+    CU_ASSERT(CUPKEE_OK == cupkee_filter_init(&f, 0, 0, 0));
+
+    // report first sample and every change
+    CU_ASSERT(1 == cupkee_filter_push(&f, 100) && 100 == cupkee_filter_value(&f));
+    CU_ASSERT(0 == cupkee_filter_push(&f, 100));
+    CU_ASSERT(1 == cupkee_filter_push(&f, 101) && 101 == cupkee_filter_value(&f));
+}
+
+static void test_oversample(void)
+{
+    cupkee_filter_t f;
+    int i, n = 0;
+
+    CU_ASSERT(CUPKEE_OK == cupkee_filter_init(&f, 2, 0, 0));
+
+    // 16 samples pre result, 2 more bits
+    for (i = 0; i < 15; i++) {
+        CU_ASSERT(0 == cupkee_filter_push(&f, i & 1 ? 1001 : 1000));
+    }
+    CU_ASSERT(1 == cupkee_filter_push(&f, 1001));
+    CU_ASSERT(4002 == cupkee_filter_value(&f));
+
+    // full scale not overflow
+    CU_ASSERT(CUPKEE_OK == cupkee_filter_init(&f, CUPKEE_FILTER_OVERSAMPLE_MAX, 0, 0));
+    for (i = 0; i < 256; i++) {
+        n += cupkee_filter_push(&f, 0xfff);
+    }
+    CU_ASSERT(1 == n && 0xfff0 == cupkee_filter_value(&f));
+}
+
+static void test_decimate(void)
+{
+    cupkee_filter_t f;
+    int i, n = 0;
+
+    CU_ASSERT(CUPKEE_OK == cupkee_filter_init(&f, 1, 10, 0));
+
+    // 4 samples oversampled, then average of 10 results
+    for (i = 0; i < 40; i++) {
+        n += cupkee_filter_push(&f, i < 20 ? 100 : 200);
+    }
+    CU_ASSERT(1 == n && 300 == cupkee_filter_value(&f));
+}
+
+static void test_deadband(void)
+{
+    cupkee_filter_t f;
+    int i, n = 0;
+
+    CU_ASSERT(CUPKEE_OK == cupkee_filter_init(&f, 0, 0, 5));
+
+    // noise inside deadband not reported
+    for (i = 0; i < 1000; i++) {
+        n += cupkee_filter_push(&f, 2000 + ((i * 7) % 11 - 5) / 2);
+    }
+    CU_ASSERT(1 == n);
+    CU_ASSERT(1 == cupkee_filter_push(&f, cupkee_filter_value(&f) + 6));
+    CU_ASSERT(0 == cupkee_filter_push(&f, cupkee_filter_value(&f) - 5));
+    CU_ASSERT(1 == cupkee_filter_push(&f, cupkee_filter_value(&f) - 6));
+}
+
+CU_pSuite test_sys_filter(void)
+{
+    CU_pSuite suite = CU_add_suite("system filter", test_setup, test_clean);
+
+    if (suite) {
+        CU_add_test(suite, "bypass     ", test_bypass);
+        CU_add_test(suite, "oversample ", test_oversample);
+        CU_add_test(suite, "decimate   ", test_decimate);
+        CU_add_test(suite, "deadband   ", test_deadband);
+    }
+
+    return suite;
+}
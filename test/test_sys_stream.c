@@ -45,6 +45,7 @@ static int test_setup(void)
 
     cupkee_memory_init(2, descs);
     cupkee_event_setup();
+    cupkee_timer_init();
 
     return 0;
 }
@@ -674,6 +675,511 @@ static void test_unpipe(void)
     cupkee_stream_deinit(&writer);
 }
 
+static void test_watermark(void)
+{
+    cupkee_stream_t stream;
+    uint8_t buf[32];
+
+    implement_load_trigger_cnt = 0;
+    implement_data = 1;
+
+    CU_ASSERT(0 == cupkee_stream_init_readable(&stream, NULL, 32, read_implement_trigger));
+    CU_ASSERT(-CUPKEE_EINVAL == cupkee_stream_set_watermark(&stream, CUPKEE_STREAM_FL_READABLE, 8, 8));
+    CU_ASSERT(-CUPKEE_EINVAL == cupkee_stream_set_watermark(&stream, CUPKEE_STREAM_FL_READABLE, 33, 8));
+    CU_ASSERT(-CUPKEE_EINVAL == cupkee_stream_set_watermark(&stream, CUPKEE_STREAM_FL_WRITABLE, 24, 8));
+    CU_ASSERT(0 == cupkee_stream_set_watermark(&stream, CUPKEE_STREAM_FL_READABLE, 24, 8));
+
+    CU_ASSERT(0 == cupkee_stream_read(&stream, 1, buf));
+    CU_ASSERT(implement_load_trigger_cnt == 1);
+
+    // block when reach high mark
+    CU_ASSERT(24 == read_implement_load(&stream, 24));
+    CU_ASSERT(stream.flags & CUPKEE_STREAM_FL_RX_BLOCKED);
+    CU_ASSERT(0 == cupkee_stream_push(&stream, 1, buf));
+
+    // no request until drop to low mark
+    implement_load_trigger_cnt = 0;
+    CU_ASSERT(10 == cupkee_stream_read(&stream, 10, buf));
+    CU_ASSERT(stream.flags & CUPKEE_STREAM_FL_RX_BLOCKED);
+    CU_ASSERT(5 == cupkee_stream_read(&stream, 5, buf));
+    CU_ASSERT(implement_load_trigger_cnt == 0);
+    CU_ASSERT(1 == cupkee_stream_read(&stream, 1, buf));
+    CU_ASSERT(!(stream.flags & CUPKEE_STREAM_FL_RX_BLOCKED));
+    CU_ASSERT(implement_load_trigger_cnt == 1);
+
+    cupkee_stream_deinit(&stream);
+
+    CU_ASSERT(0 == cupkee_stream_init_writable(&stream, NULL, 32, write_implement_trigger));
+    CU_ASSERT(0 == cupkee_stream_set_watermark(&stream, CUPKEE_STREAM_FL_WRITABLE, 16, 4));
+
+    // accept all, but blocked over high mark
+    CU_ASSERT(20 == cupkee_stream_write(&stream, 20, "01234567890123456789"));
+    CU_ASSERT(stream.flags & CUPKEE_STREAM_FL_TX_BLOCKED);
+
+    CU_ASSERT(10 == write_implement_consume(&stream, 10));
+    CU_ASSERT(stream.flags & CUPKEE_STREAM_FL_TX_BLOCKED);
+    CU_ASSERT(6 == write_implement_consume(&stream, 6));
+    CU_ASSERT(!(stream.flags & CUPKEE_STREAM_FL_TX_BLOCKED));
+
+    cupkee_stream_deinit(&stream);
+}
+
+static void test_cork(void)
+{
+    cupkee_stream_t stream;
+
+    implement_send_trigger_cnt = 0;
+    _cupkee_systicks = 0;
+
+    CU_ASSERT(0 == cupkee_stream_init_writable(&stream, NULL, 32, write_implement_trigger));
+
+    // hold request until uncorked
+    cupkee_stream_cork(&stream);
+    cupkee_stream_cork(&stream);
+    CU_ASSERT(4 == cupkee_stream_write(&stream, 4, "0123"));
+    CU_ASSERT(4 == cupkee_stream_write(&stream, 4, "4567"));
+    CU_ASSERT(implement_send_trigger_cnt == 0);
+    cupkee_stream_uncork(&stream);
+    CU_ASSERT(implement_send_trigger_cnt == 0);
+    cupkee_stream_uncork(&stream);
+    CU_ASSERT(implement_send_trigger_cnt == 1);
+    CU_ASSERT(8 == write_implement_consume(&stream, 8));
+
+    // flush when size reached
+    CU_ASSERT(-CUPKEE_EINVAL == cupkee_stream_set_flush(&stream, 33, 0));
+    CU_ASSERT(0 == cupkee_stream_set_flush(&stream, 8, 0));
+    CU_ASSERT(4 == cupkee_stream_write(&stream, 4, "0123"));
+    CU_ASSERT(implement_send_trigger_cnt == 1);
+    CU_ASSERT(4 == cupkee_stream_write(&stream, 4, "4567"));
+    CU_ASSERT(implement_send_trigger_cnt == 2);
+    CU_ASSERT(8 == write_implement_consume(&stream, 8));
+
+    // flush when wait timeout
+    CU_ASSERT(0 == cupkee_stream_set_flush(&stream, 8, 10));
+    CU_ASSERT(2 == cupkee_stream_write(&stream, 2, "01"));
+    CU_ASSERT(stream.tx_flush_timer != NULL);
+    while (_cupkee_systicks < 9) {
+        cupkee_timer_sync(++_cupkee_systicks);
+    }
+    CU_ASSERT(implement_send_trigger_cnt == 2);
+    while (_cupkee_systicks < 12) {
+        cupkee_timer_sync(++_cupkee_systicks);
+    }
+    CU_ASSERT(implement_send_trigger_cnt == 3);
+    CU_ASSERT(stream.tx_flush_timer == NULL);
+    CU_ASSERT(2 == write_implement_consume(&stream, 2));
+
+    // explicit flush stop the timer
+    CU_ASSERT(2 == cupkee_stream_write(&stream, 2, "01"));
+    CU_ASSERT(stream.tx_flush_timer != NULL);
+    cupkee_stream_flush(&stream);
+    CU_ASSERT(implement_send_trigger_cnt == 4);
+    CU_ASSERT(stream.tx_flush_timer == NULL);
+    CU_ASSERT(2 == write_implement_consume(&stream, 2));
+
+    // timer cleared by others: flush held data
+    CU_ASSERT(2 == cupkee_stream_write(&stream, 2, "01"));
+    CU_ASSERT(stream.tx_flush_timer != NULL);
+    CU_ASSERT(1 == cupkee_timer_clear_all());
+    CU_ASSERT(implement_send_trigger_cnt == 5);
+    CU_ASSERT(stream.tx_flush_timer == NULL);
+    CU_ASSERT(2 == write_implement_consume(&stream, 2));
+
+    // shutdown flush held data
+    cupkee_stream_cork(&stream);
+    CU_ASSERT(2 == cupkee_stream_write(&stream, 2, "01"));
+    cupkee_stream_shutdown(&stream, CUPKEE_STREAM_FL_WRITABLE);
+    CU_ASSERT(implement_send_trigger_cnt == 6);
+
+    cupkee_stream_deinit(&stream);
+    cupkee_timer_sync(++_cupkee_systicks);
+}
+
+static void *buf_create(int cap, int n, uint8_t d)
+{
+    void *b = cupkee_buffer_alloc(cap);
+
+    while (b && n--) {
+        cupkee_buffer_push(b, d);
+    }
+    return b;
+}
+
+static void test_retain(void)
+{
+    cupkee_stream_t stream;
+    void *a, *b, *c, *hold[16];
+    uint8_t buf[8];
+    int i;
+
+    implement_load_trigger_cnt = 0;
+    implement_data = 1;
+    _cupkee_systicks = 0;
+
+    CU_ASSERT(0 == cupkee_stream_init_readable(&stream, NULL, 32, read_implement_trigger));
+    CU_ASSERT(-CUPKEE_EINVAL == cupkee_stream_set_retain(&stream, 0x10000));
+    CU_ASSERT(0 == cupkee_stream_set_retain(&stream, 10));
+
+    CU_ASSERT(0 == cupkee_stream_read(&stream, 1, buf));
+    CU_ASSERT(4 == read_implement_load(&stream, 4));
+    CU_ASSERT(NULL != (a = cupkee_stream_read_buf(&stream)));
+
+    // empty cache replaced by handed in buffer is kept as spare
+    b = buf_create(32, 2, 2);
+    c = buf_create(32, 2, 3);
+    CU_ASSERT(2 == cupkee_stream_push_buf(&stream, b));
+    CU_ASSERT(2 == cupkee_stream_read(&stream, 2, buf));
+    CU_ASSERT(2 == cupkee_stream_push_buf(&stream, c));
+    CU_ASSERT(stream.cache_spare == b);
+    CU_ASSERT(c == cupkee_stream_read_buf(&stream));
+
+    // and reused by next push
+    CU_ASSERT(1 == cupkee_stream_push(&stream, 1, buf));
+    CU_ASSERT(stream.rx_buf == b);
+    CU_ASSERT(stream.cache_spare == NULL);
+    CU_ASSERT(1 == cupkee_stream_read(&stream, 1, buf));
+
+    // kept while data keeps flowing, though empty at each sync
+    for (i = 1; i <= 4; i++) {
+        _cupkee_systicks = i * 8;
+        CU_ASSERT(1 == cupkee_stream_push(&stream, 1, buf));
+        CU_ASSERT(1 == cupkee_stream_read(&stream, 1, buf));
+        cupkee_stream_sync(_cupkee_systicks + 4);
+        CU_ASSERT(stream.rx_buf == b);
+    }
+
+    // empty cache released after idle timeout
+    cupkee_stream_sync(_cupkee_systicks + 5);
+    CU_ASSERT(stream.rx_buf != NULL);
+    cupkee_stream_sync(_cupkee_systicks + 10);
+    CU_ASSERT(stream.rx_buf == NULL);
+
+    // released on pool pressure
+    CU_ASSERT(1 == cupkee_stream_push(&stream, 1, buf));
+    CU_ASSERT(1 == cupkee_stream_read(&stream, 1, buf));
+    CU_ASSERT(stream.rx_buf != NULL);
+    for (i = 0; i < 16; i++) {
+        hold[i] = cupkee_buffer_alloc(32);
+    }
+    CU_ASSERT(stream.rx_buf == NULL);
+    for (i = 0; i < 16; i++) {
+        if (hold[i]) {
+            cupkee_buffer_release(hold[i]);
+        }
+    }
+
+    cupkee_buffer_release(a);
+    cupkee_buffer_release(c);
+    cupkee_stream_deinit(&stream);
+}
+
+static void test_stat(void)
+{
+    cupkee_stream_t stream;
+    cupkee_stream_stat_t st;
+    uint8_t buf[32];
+
+    implement_send_trigger_cnt = 0;
+    _cupkee_systicks = 100;
+
+    CU_ASSERT(0 == cupkee_stream_init_writable(&stream, NULL, 16, write_implement_trigger));
+    CU_ASSERT(-CUPKEE_ENOTENABLED == cupkee_stream_stat_get(&stream, &st));
+    CU_ASSERT(0 == cupkee_stream_stat_enable(&stream, 1));
+
+    CU_ASSERT(10 == cupkee_stream_write(&stream, 10, "0123456789"));
+    CU_ASSERT(6 == cupkee_stream_write(&stream, 10, "0123456789"));
+    CU_ASSERT(stream.flags & CUPKEE_STREAM_FL_TX_BLOCKED);
+
+    _cupkee_systicks += 5;
+    CU_ASSERT(0 == cupkee_stream_stat_get(&stream, &st));
+    CU_ASSERT(st.bytes_in == 16);
+    CU_ASSERT(st.tx_blocks == 1);
+    CU_ASSERT(st.tx_block_ticks == 5);
+    CU_ASSERT(st.tx_peak == 16);
+
+    _cupkee_systicks += 3;
+    CU_ASSERT(16 == cupkee_stream_pull(&stream, 32, buf));
+    CU_ASSERT(!(stream.flags & CUPKEE_STREAM_FL_TX_BLOCKED));
+
+    _cupkee_systicks += 10;
+    CU_ASSERT(0 == cupkee_stream_stat_get(&stream, &st));
+    CU_ASSERT(st.bytes_out == 16);
+    CU_ASSERT(st.tx_blocks == 1);
+    CU_ASSERT(st.tx_block_ticks == 8);
+    CU_ASSERT(st.alloc_fails == 0);
+
+    // reset by enable again
+    CU_ASSERT(0 == cupkee_stream_stat_enable(&stream, 1));
+    CU_ASSERT(0 == cupkee_stream_stat_get(&stream, &st));
+    CU_ASSERT(st.bytes_in == 0 && st.bytes_out == 0 && st.tx_blocks == 0);
+
+    CU_ASSERT(0 == cupkee_stream_stat_enable(&stream, 0));
+    CU_ASSERT(stream.stat == NULL);
+
+    cupkee_stream_deinit(&stream);
+
+    // rx side
+    implement_load_trigger_cnt = 0;
+    implement_data = 1;
+    CU_ASSERT(0 == cupkee_stream_init_readable(&stream, NULL, 16, read_implement_trigger));
+    CU_ASSERT(0 == cupkee_stream_stat_enable(&stream, 1));
+    CU_ASSERT(0 == cupkee_stream_read(&stream, 1, buf));
+    CU_ASSERT(16 == read_implement_load(&stream, 32));
+    CU_ASSERT(8 == cupkee_stream_read(&stream, 8, buf));
+    CU_ASSERT(8 == cupkee_stream_read(&stream, 8, buf));
+
+    CU_ASSERT(0 == cupkee_stream_stat_get(&stream, &st));
+    CU_ASSERT(st.bytes_in == 16);
+    CU_ASSERT(st.bytes_out == 16);
+    CU_ASSERT(st.rx_blocks == 1);
+    CU_ASSERT(st.rx_peak == 16);
+
+    cupkee_stream_deinit(&stream);
+}
+
+static void test_read_buf(void)
+{
+    cupkee_stream_t stream;
+    void *b1, *b2;
+    uint8_t buf[40];
+
+    implement_load_trigger_cnt = 0;
+
+    CU_ASSERT(0 == cupkee_stream_init_readable(&stream, NULL, 40, read_implement_trigger));
+    CU_ASSERT(NULL == cupkee_stream_read_buf(&stream));
+    CU_ASSERT(implement_load_trigger_cnt == 2);
+
+    // cache is empty: take the buffer
+    b1 = buf_create(40, 10, 1);
+    CU_ASSERT(10 == cupkee_stream_push_buf(&stream, b1));
+    CU_ASSERT(stream.rx_buf == b1);
+
+    // cache has data: copy in, release the buffer
+    b2 = buf_create(10, 10, 2);
+    CU_ASSERT(10 == cupkee_stream_push_buf(&stream, b2));
+    CU_ASSERT(stream.rx_buf == b1);
+    CU_ASSERT(20 == cupkee_stream_readable(&stream));
+
+    // empty or over max size: invalid, buffer stay with caller
+    b2 = buf_create(10, 0, 3);
+    CU_ASSERT(-CUPKEE_EINVAL == cupkee_stream_push_buf(&stream, b2));
+    cupkee_buffer_release(b2);
+    b2 = buf_create(50, 50, 3);
+    CU_ASSERT(-CUPKEE_EINVAL == cupkee_stream_push_buf(&stream, b2));
+    CU_ASSERT(stream.rx_buf == b1);
+    CU_ASSERT(20 == cupkee_stream_readable(&stream));
+    cupkee_buffer_release(b2);
+
+    // would grow cache over max size: refuse and block
+    b2 = buf_create(30, 30, 3);
+    CU_ASSERT(0 == cupkee_stream_push_buf(&stream, b2));
+    CU_ASSERT(stream.flags & CUPKEE_STREAM_FL_RX_BLOCKED);
+    CU_ASSERT(0 == cupkee_stream_push_buf(&stream, b2));
+
+    CU_ASSERT(b1 == cupkee_stream_read_buf(&stream));
+    CU_ASSERT(!(stream.flags & CUPKEE_STREAM_FL_RX_BLOCKED));
+    CU_ASSERT(20 == cupkee_buffer_take(b1, 40, buf));
+    CU_ASSERT(buf[9] == 1 && buf[10] == 2);
+    cupkee_buffer_release(b1);
+
+    CU_ASSERT(30 == cupkee_stream_push_buf(&stream, b2));
+    CU_ASSERT(20 == cupkee_stream_read(&stream, 20, buf));
+    CU_ASSERT(10 == cupkee_stream_readable(&stream));
+
+    cupkee_stream_deinit(&stream);
+}
+
+static void test_write_buf(void)
+{
+    cupkee_stream_t stream;
+    void *b1, *b2;
+
+    implement_send_trigger_cnt = 0;
+
+    CU_ASSERT(0 == cupkee_stream_init_writable(&stream, NULL, 40, write_implement_trigger));
+    CU_ASSERT(NULL == cupkee_stream_pull_buf(&stream));
+
+    b1 = buf_create(60, 30, 1);
+    CU_ASSERT(30 == cupkee_stream_write_buf(&stream, b1));
+    CU_ASSERT(implement_send_trigger_cnt == 1);
+
+    // cache has space, but not under max size
+    b2 = buf_create(30, 30, 2);
+    CU_ASSERT(0 == cupkee_stream_write_buf(&stream, b2));
+    CU_ASSERT(stream.flags & CUPKEE_STREAM_FL_TX_BLOCKED);
+    CU_ASSERT(30 == cupkee_buffer_length(b1));
+    cupkee_buffer_release(b2);
+    cupkee_stream_unblock(&stream, CUPKEE_STREAM_FL_TX_BLOCKED);
+
+    b2 = buf_create(10, 10, 2);
+    CU_ASSERT(10 == cupkee_stream_write_buf(&stream, b2));
+    CU_ASSERT(implement_send_trigger_cnt == 1);
+
+    // empty or over max size: invalid
+    b2 = buf_create(50, 0, 3);
+    CU_ASSERT(-CUPKEE_EINVAL == cupkee_stream_write_buf(&stream, b2));
+    cupkee_buffer_release(b2);
+    b2 = buf_create(50, 50, 3);
+    CU_ASSERT(-CUPKEE_EINVAL == cupkee_stream_write_buf(&stream, b2));
+    cupkee_buffer_release(b2);
+
+    b2 = buf_create(30, 30, 3);
+    CU_ASSERT(0 == cupkee_stream_write_buf(&stream, b2));
+    CU_ASSERT(stream.flags & CUPKEE_STREAM_FL_TX_BLOCKED);
+
+    CU_ASSERT(b1 == cupkee_stream_pull_buf(&stream));
+    CU_ASSERT(40 == cupkee_buffer_length(b1));
+    CU_ASSERT(!(stream.flags & CUPKEE_STREAM_FL_TX_BLOCKED));
+    cupkee_buffer_release(b1);
+
+    CU_ASSERT(30 == cupkee_stream_write_buf(&stream, b2));
+    CU_ASSERT(implement_send_trigger_cnt == 2);
+
+    cupkee_stream_shutdown(&stream, CUPKEE_STREAM_FL_WRITABLE);
+    CU_ASSERT(0 == cupkee_stream_write_buf(&stream, b2));
+    CU_ASSERT(b2 == cupkee_stream_pull_buf(&stream));
+    cupkee_buffer_release(b2);
+
+    cupkee_stream_deinit(&stream);
+}
+
+static void test_frame_line(void)
+{
+    cupkee_stream_t reader;
+    cupkee_frame_stream_t f;
+    char buf[32];
+
+    CU_ASSERT(0 == cupkee_stream_init_readable(&reader, NULL, 64, read_implement_idle));
+    CU_ASSERT(0 == cupkee_frame_stream_init(&f, NULL, CUPKEE_FRAME_LINE, 32, 64));
+    CU_ASSERT(f.stream.flags & CUPKEE_STREAM_FL_TRANSFORM);
+    CU_ASSERT(0 == cupkee_stream_pipe(&reader, &f.stream));
+
+    CU_ASSERT(8 == cupkee_stream_push(&reader, 8, "ab\ncd\nef"));
+
+    // one frame each read
+    CU_ASSERT(3 == cupkee_stream_read(&f.stream, 32, buf));
+    CU_ASSERT(!memcmp(buf, "ab\n", 3));
+    CU_ASSERT(3 == cupkee_stream_read(&f.stream, 32, buf));
+    CU_ASSERT(!memcmp(buf, "cd\n", 3));
+    CU_ASSERT(0 == cupkee_stream_read(&f.stream, 32, buf));
+
+    CU_ASSERT(2 == cupkee_stream_push(&reader, 2, "g\n"));
+    CU_ASSERT(4 == cupkee_stream_read(&f.stream, 32, buf));
+    CU_ASSERT(!memcmp(buf, "efg\n", 4));
+
+    cupkee_stream_deinit(&reader);
+    cupkee_frame_stream_deinit(&f);
+}
+
+static void test_frame_decode(void)
+{
+    cupkee_frame_stream_t f;
+    uint8_t buf[32];
+
+    // SLIP
+    CU_ASSERT(0 == cupkee_frame_stream_init(&f, NULL, CUPKEE_FRAME_SLIP, 16, 64));
+    CU_ASSERT(9 == cupkee_stream_write(&f.stream, 9, "\xc0\x01\xdb\xdc\x02\xdb\xdd\xc0\x03"));
+    CU_ASSERT(4 == cupkee_stream_read(&f.stream, 32, buf));
+    CU_ASSERT(!memcmp(buf, "\x01\xc0\x02\xdb", 4));
+    CU_ASSERT(0 == cupkee_stream_read(&f.stream, 32, buf));
+    CU_ASSERT(1 == cupkee_stream_write(&f.stream, 1, "\xc0"));
+    CU_ASSERT(1 == cupkee_stream_read(&f.stream, 32, buf));
+    CU_ASSERT(buf[0] == 3);
+    cupkee_frame_stream_deinit(&f);
+
+    // COBS
+    CU_ASSERT(0 == cupkee_frame_stream_init(&f, NULL, CUPKEE_FRAME_COBS, 16, 64));
+    CU_ASSERT(11 == cupkee_stream_write(&f.stream, 11, "\x03\x11\x22\x02\x33\x00\x01\x01\x00\x02\x00"));
+    CU_ASSERT(4 == cupkee_stream_read(&f.stream, 32, buf));
+    CU_ASSERT(!memcmp(buf, "\x11\x22\x00\x33", 4));
+    CU_ASSERT(1 == cupkee_stream_read(&f.stream, 32, buf));
+    CU_ASSERT(buf[0] == 0);
+    // third frame is broken: dropped
+    CU_ASSERT(0 == cupkee_stream_read(&f.stream, 32, buf));
+    CU_ASSERT(-CUPKEE_EINVAL == cupkee_stream_get_error(&f.stream));
+    cupkee_frame_stream_deinit(&f);
+
+    // Length prefix
+    CU_ASSERT(0 == cupkee_frame_stream_init(&f, NULL, CUPKEE_FRAME_LENGTH, 4, 64));
+    CU_ASSERT(16 == cupkee_stream_write(&f.stream, 16, "\x00\x02" "ab" "\x00\x05" "vwxyz" "\x00\x03" "cde"));
+    CU_ASSERT(2 == cupkee_stream_read(&f.stream, 32, buf));
+    CU_ASSERT(!memcmp(buf, "ab", 2));
+    CU_ASSERT(-CUPKEE_EOVERFLOW == cupkee_stream_get_error(&f.stream));
+    CU_ASSERT(3 == cupkee_stream_read(&f.stream, 32, buf));
+    CU_ASSERT(!memcmp(buf, "cde", 3));
+    cupkee_frame_stream_deinit(&f);
+}
+
+static void test_tee(void)
+{
+    cupkee_stream_t reader, w1, w2, w3;
+    cupkee_tee_t tee;
+    char buf[32];
+
+    implement_send_trigger_cnt = 0;
+
+    CU_ASSERT(0 == cupkee_stream_init_readable(&reader, NULL, 64, read_implement_idle));
+    CU_ASSERT(0 == cupkee_stream_init_writable(&w1, NULL, 64, write_implement_trigger));
+    CU_ASSERT(0 == cupkee_stream_init_writable(&w2, NULL, 64, write_implement_trigger));
+    CU_ASSERT(0 == cupkee_stream_init_writable(&w3, NULL, 64, write_implement_trigger));
+    CU_ASSERT(0 == cupkee_tee_init(&tee, NULL, 64));
+
+    CU_ASSERT(0 == cupkee_tee_add(&tee, &w1, 0));
+    CU_ASSERT(0 == cupkee_tee_add(&tee, &w2, 0));
+    CU_ASSERT(0 == cupkee_tee_add(&tee, &w3, 1));
+    CU_ASSERT(0 > cupkee_tee_add(&tee, &w3, 0));
+    CU_ASSERT(0 == cupkee_stream_pipe(&reader, &tee.stream));
+
+    // same chunk shared by all outputs
+    CU_ASSERT(10 == cupkee_stream_push(&reader, 10, "0123456789"));
+    CU_ASSERT(implement_send_trigger_cnt == 3);
+    CU_ASSERT(w1.tx_share && w1.tx_share == w2.tx_share && w2.tx_share == w3.tx_share);
+    CU_ASSERT(4 == cupkee_stream_pull(&w1, 4, buf));
+    CU_ASSERT(6 == cupkee_stream_pull(&w1, 32, buf + 4));
+    CU_ASSERT(!memcmp(buf, "0123456789", 10));
+    CU_ASSERT(w1.tx_share == NULL && w2.tx_share != NULL);
+
+    // w2 is slow: hold the chunk, w3 drop it
+    CU_ASSERT(5 == cupkee_stream_push(&reader, 5, "abcde"));
+    CU_ASSERT(w1.tx_share != NULL);
+    CU_ASSERT(tee.pending == 2);
+    CU_ASSERT(tee.dropped == 5);
+    CU_ASSERT(3 == cupkee_stream_push(&reader, 3, "fgh"));
+
+    // w3 keep the first chunk
+    CU_ASSERT(10 == cupkee_stream_pull(&w3, 32, buf));
+    CU_ASSERT(!memcmp(buf, "0123456789", 10));
+
+    // w2 drain, the tee go on
+    CU_ASSERT(10 == cupkee_stream_pull(&w2, 32, buf));
+    CU_ASSERT(!memcmp(buf, "0123456789", 10));
+    CU_ASSERT(5 == cupkee_stream_pull(&w2, 32, buf));
+    CU_ASSERT(!memcmp(buf, "abcde", 5));
+    CU_ASSERT(5 == cupkee_stream_pull(&w1, 32, buf));
+    CU_ASSERT(!memcmp(buf, "abcde", 5));
+
+    CU_ASSERT(3 == cupkee_stream_pull(&w1, 32, buf));
+    CU_ASSERT(!memcmp(buf, "fgh", 3));
+    CU_ASSERT(3 == cupkee_stream_pull(&w2, 32, buf));
+    CU_ASSERT(!memcmp(buf, "fgh", 3));
+    CU_ASSERT(3 == cupkee_stream_pull(&w3, 32, buf));
+    CU_ASSERT(!memcmp(buf, "fgh", 3));
+    CU_ASSERT(tee.chunk == NULL);
+
+    // removed output do not hold the tee
+    CU_ASSERT(0 == cupkee_tee_remove(&tee, &w1));
+    CU_ASSERT(w1.producer == NULL);
+    CU_ASSERT(2 == cupkee_stream_push(&reader, 2, "ij"));
+    CU_ASSERT(w1.tx_share == NULL);
+    CU_ASSERT(2 == cupkee_stream_pull(&w2, 32, buf));
+
+    cupkee_stream_deinit(&reader);
+    cupkee_tee_deinit(&tee);
+    cupkee_stream_deinit(&w1);
+    cupkee_stream_deinit(&w2);
+    cupkee_stream_deinit(&w3);
+}
+
 CU_pSuite test_sys_stream(void)
 {
     CU_pSuite suite = CU_add_suite("system stream", test_setup, test_clean);
@@ -699,6 +1205,18 @@ CU_pSuite test_sys_stream(void)
 
         CU_add_test(suite, "pipe             ", test_pipe);
         CU_add_test(suite, "unpipe           ", test_unpipe);
+
+        CU_add_test(suite, "watermark        ", test_watermark);
+        CU_add_test(suite, "cork             ", test_cork);
+        CU_add_test(suite, "retain           ", test_retain);
+        CU_add_test(suite, "stat             ", test_stat);
+
+        CU_add_test(suite, "read buf         ", test_read_buf);
+        CU_add_test(suite, "write buf        ", test_write_buf);
+
+        CU_add_test(suite, "frame line       ", test_frame_line);
+        CU_add_test(suite, "frame decode     ", test_frame_decode);
+        CU_add_test(suite, "tee              ", test_tee);
     }
 
     return suite;